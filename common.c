@@ -29,6 +29,9 @@
 #include <unistd.h>	/* For STDOUT_FILENO, among others */
 #include <sys/ioctl.h>
 #include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/inotify.h>
+#include <fcntl.h>
 #include <dirent.h>
 #include <ctype.h>
 #include <limits.h>
@@ -75,6 +78,21 @@ char sc_normal[MAX_SGR_LEN] = C_NORMAL;
  */
 char persistent_name_type[MAX_FILE_LEN];
 
+#ifndef SOURCE_SADC
+/* Caches of /dev/disk/by-* and /dev/mapper directories contents */
+static int name_cache_ifd = -1;	/* inotify descriptor used to detect changes */
+static struct name_cache persist_cache = {.wd = -1};
+static struct name_cache devmap_cache = {.wd = -1};
+/* Device names indexed by major and minor numbers */
+static struct devname_ent *devname_cache[DEVNAME_CACHE_SIZE];
+static int devname_wd = -1;		/* Watch descriptor on /dev/block */
+static unsigned int devname_gen = 0;	/* Changes when devices come and go */
+#endif
+
+#ifdef TEST
+extern unsigned int __root_gen;
+#endif
+
 /*
  ***************************************************************************
  * Print sysstat version number, environment variables and exit.
@@ -460,6 +478,64 @@ void check_overflow(unsigned int val1, unsigned int val2,
 	}
 }
 
+/*
+ ***************************************************************************
+ * Read the whole contents of a file into a buffer. The buffer is enlarged
+ * as needed and reused from one call to the next. The file is kept open
+ * and read again from its beginning with pread() at each call.
+ * The contents are terminated with a NUL character followed by at least
+ * FILE_BUF_PAD - 1 other NUL characters so that a word can be read at any
+ * position before the terminating NUL.
+ *
+ * IN:
+ * @file	Name of the file.
+ * @fb		File buffer structure (@fd set to -1 on first call).
+ *
+ * RETURNS:
+ * Number of bytes read, or -1 if the file couldn't be read.
+ ***************************************************************************
+ */
+ssize_t read_file_buf(char *file, struct file_buf *fb)
+{
+	ssize_t n;
+	size_t len = 0;
+
+	if ((fb->fd < 0) && ((fb->fd = open(file, O_RDONLY | O_CLOEXEC)) < 0))
+		return -1;
+
+	do {
+		if (len + FILE_BUF_PAD >= fb->size) {
+			/* Make room for more data */
+			fb->size = fb->size ? fb->size * 2 : FILE_BUF_INIT_SIZE;
+			SREALLOC(fb->buf, char, fb->size);
+		}
+
+		n = pread(fb->fd, fb->buf + len, fb->size - len - FILE_BUF_PAD, len);
+		if (n < 0) {
+			if (errno == EINTR) {
+				/* Interrupted by a signal: Read again (loop ends when n == 0) */
+				n = 1;
+				continue;
+			}
+			close(fb->fd);
+			fb->fd = -1;
+			return -1;
+		}
+		len += n;
+	}
+	while (n > 0);
+
+	memset(fb->buf + len, 0, FILE_BUF_PAD);
+
+#ifdef TEST
+	/* In test mode, the file may be another one at next call */
+	close(fb->fd);
+	fb->fd = -1;
+#endif
+
+	return len;
+}
+
 #ifndef SOURCE_SADC
 /*
  ***************************************************************************
@@ -899,69 +975,305 @@ char *get_persistent_name_path(char *name)
 
 /*
  ***************************************************************************
- * Get files from persistent type name directory.
+ * Compute the bucket number of a name in a name cache (FNV-1a hash).
+ *
+ * IN:
+ * @name	Name to hash.
  *
  * RETURNS:
- * List of files in the persistent type name directory in alphabetical order.
+ * Bucket number.
  ***************************************************************************
 */
-char **get_persistent_names(void)
+unsigned int hash_cached_name(const char *name)
 {
-	int n, i, k = 0;
-	char *dir;
-	char **files = NULL;
+	unsigned int hash = 2166136261U;
+
+	while (*name) {
+		hash = (hash ^ (unsigned char) *name++) * 16777619U;
+	}
+
+	return hash % NAME_CACHE_SIZE;
+}
+
+/*
+ ***************************************************************************
+ * Read pending inotify events and invalidate the caches whose directory
+ * has changed. Events are checked at most once per second.
+ * In test mode, no inotify watch is set, and all the caches are invalidated
+ * each time the test root directory is switched.
+ ***************************************************************************
+*/
+void check_name_caches(void)
+{
+	static time_t last_check = 0;
+	char buf[4096] __attribute__ ((aligned(__alignof__(struct inotify_event))));
+	struct inotify_event *ev;
+	struct timespec ts;
+	ssize_t len;
+	char *ptr;
+#ifdef TEST
+	static unsigned int root_gen = 0;
+
+	if (root_gen != __root_gen) {
+		root_gen = __root_gen;
+		persist_cache.valid = devmap_cache.valid = FALSE;
+		devname_gen++;
+	}
+#endif
+
+	if (name_cache_ifd < 0)
+		return;
+
+	clock_gettime(CLOCK_MONOTONIC_COARSE, &ts);
+	if (ts.tv_sec == last_check)
+		return;
+	last_check = ts.tv_sec;
+
+	while ((len = read(name_cache_ifd, buf, sizeof(buf))) > 0) {
+
+		for (ptr = buf; ptr < buf + len; ptr += sizeof(struct inotify_event) + ev->len) {
+			ev = (struct inotify_event *) ptr;
+
+			if (ev->mask & IN_Q_OVERFLOW) {
+				/* Events have been lost */
+				persist_cache.valid = devmap_cache.valid = FALSE;
+				devname_gen++;
+				continue;
+			}
+			if (ev->wd == devname_wd) {
+				/* A block device has been added or removed */
+				devname_gen++;
+				if (ev->mask & IN_IGNORED) {
+					devname_wd = -1;
+				}
+			}
+			if (ev->wd == persist_cache.wd) {
+				persist_cache.valid = FALSE;
+				if (ev->mask & IN_IGNORED) {
+					/* Directory has been removed */
+					persist_cache.wd = -1;
+				}
+			}
+			if (ev->wd == devmap_cache.wd) {
+				devmap_cache.valid = FALSE;
+				if (ev->mask & IN_IGNORED) {
+					devmap_cache.wd = -1;
+				}
+			}
+		}
+	}
+}
+
+/*
+ ***************************************************************************
+ * Free the entries of a name cache.
+ *
+ * IN:
+ * @nc		Name cache.
+ ***************************************************************************
+*/
+void free_name_cache(struct name_cache *nc)
+{
+	struct name_ent *ne;
+
+	while (nc->list != NULL) {
+		ne = nc->list;
+		nc->list = ne->lnext;
+		free(ne);
+	}
+	memset(nc->by_key, 0, sizeof(nc->by_key));
+	memset(nc->by_dev, 0, sizeof(nc->by_dev));
+	nc->valid = FALSE;
+}
+
+/*
+ ***************************************************************************
+ * Add an entry to a name cache.
+ *
+ * IN:
+ * @nc		Name cache.
+ * @key		Key used to look the entry up.
+ * @name	Name associated with the key (may be NULL).
+ * @major	Major number of the device (used only if @has_dev is TRUE).
+ * @minor	Minor number of the device.
+ * @has_dev	TRUE if the entry can also be looked up by major/minor.
+ ***************************************************************************
+*/
+void add_name_cache_entry(struct name_cache *nc, char *key, char *name,
+			  unsigned int major, unsigned int minor, int has_dev)
+{
+	struct name_ent *ne;
+	size_t klen = strlen(key) + 1, nlen = name ? strlen(name) + 1 : 0;
+	unsigned int h;
+
+	if ((ne = (struct name_ent *) malloc(sizeof(struct name_ent) + klen + nlen)) == NULL) {
+		perror("malloc");
+		exit(4);
+	}
+	ne->key = (char *) (ne + 1);
+	memcpy(ne->key, key, klen);
+	if (name) {
+		ne->name = ne->key + klen;
+		memcpy(ne->name, name, nlen);
+	}
+	else {
+		ne->name = NULL;
+	}
+	ne->major = major;
+	ne->minor = minor;
+
+	ne->lnext = nc->list;
+	nc->list = ne;
+
+	h = hash_cached_name(key);
+	ne->knext = nc->by_key[h];
+	nc->by_key[h] = ne;
+
+	if (has_dev) {
+		h = (major * 31 + minor) % NAME_CACHE_SIZE;
+		ne->dnext = nc->by_dev[h];
+		nc->by_dev[h] = ne;
+	}
+	else {
+		ne->dnext = NULL;
+	}
+}
+
+/*
+ ***************************************************************************
+ * Look for an entry in a name cache using its key.
+ *
+ * IN:
+ * @nc		Name cache.
+ * @key		Key of the entry.
+ *
+ * RETURNS:
+ * Pointer on the entry, or NULL if not found.
+ ***************************************************************************
+*/
+struct name_ent *lookup_name_cache(struct name_cache *nc, char *key)
+{
+	struct name_ent *ne;
+
+	for (ne = nc->by_key[hash_cached_name(key)]; ne != NULL; ne = ne->knext) {
+		if (!strcmp(ne->key, key))
+			return ne;
+	}
+
+	return NULL;
+}
+
+/*
+ ***************************************************************************
+ * Get the cache of the entries of a directory, building it again if the
+ * directory has changed (or if another directory is now requested).
+ * For a persistent type name directory (/dev/disk/by-*), entries are
+ * indexed by the pretty name they point at, keeping the first one in
+ * alphabetical order. For the device mapper directory (/dev/mapper),
+ * entries are indexed by their registered name and by their major/minor
+ * numbers.
+ *
+ * IN:
+ * @nc		Name cache.
+ * @dir		Directory whose entries are to be cached.
+ * @devmap	TRUE if @dir is the device mapper directory.
+ *
+ * RETURNS:
+ * Pointer on the name cache, or NULL if the directory cannot be read.
+ ***************************************************************************
+*/
+struct name_cache *get_name_cache(struct name_cache *nc, char *dir, int devmap)
+{
+	int i, n;
+	ssize_t r;
+	char link[PATH_MAX], target[PATH_MAX], *name;
 	struct dirent **namelist;
+	struct stat aux;
 
-	/* Get directory name for selected persistent type */
-	dir = get_persistent_type_dir(persistent_name_type);
-	if (!dir)
-		return (NULL);
+	check_name_caches();
 
-	n = scandir(dir, &namelist, NULL, alphasort);
-	if (n < 0)
-		return (NULL);
+	if (nc->valid && !strcmp(nc->dir, dir))
+		return nc;
 
-	/* If directory is empty, it contains 2 entries: "." and ".." */
-	if (n <= 2)
-		/* Free list and return NULL */
-		goto free_list;
+	free_name_cache(nc);
+	if (strcmp(nc->dir, dir) && (nc->wd >= 0)) {
+		/* Another directory is now cached */
+		inotify_rm_watch(name_cache_ifd, nc->wd);
+		nc->wd = -1;
+	}
+	strncpy(nc->dir, dir, sizeof(nc->dir) - 1);
+	nc->dir[sizeof(nc->dir) - 1] = '\0';
 
-	/* Ignore the "." and "..", but keep place for one last NULL. */
-	files = (char **) calloc(n - 1, sizeof(char *));
-	if (!files)
-		goto free_list;
+#ifndef TEST
+	if (name_cache_ifd < 0) {
+		name_cache_ifd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+	}
+	if ((name_cache_ifd >= 0) && (nc->wd < 0)) {
+		/* Watch directory before reading it so that no change is missed */
+		nc->wd = inotify_add_watch(name_cache_ifd, dir,
+					   IN_CREATE | IN_DELETE | IN_MOVED_FROM | IN_MOVED_TO |
+					   IN_ATTRIB | IN_DELETE_SELF | IN_MOVE_SELF);
+	}
+#endif
+
+	/* Read entries in alphabetical order */
+	if ((n = scandir(dir, &namelist, NULL, alphasort)) < 0)
+		return NULL;
 
-	/*
-	 * i is for traversing namelist, k is for files.
-	 * i != k because we are ignoring "." and ".." entries.
-	 */
 	for (i = 0; i < n; i++) {
 		/* Ignore "." and ".." */
 		if (!strcmp(".", namelist[i]->d_name) ||
 		    !strcmp("..", namelist[i]->d_name))
 			continue;
 
-		files[k] = (char *) calloc(strlen(namelist[i]->d_name) + 1, sizeof(char));
-		if (!files[k])
-			continue;
+		snprintf(link, sizeof(link), "%s/%s", dir, namelist[i]->d_name);
+		link[sizeof(link) - 1] = '\0';
+
+		/* Entries are usually symlinks: Read them (ignore dangling ones)... */
+		r = access(link, F_OK) ? -1 : readlink(link, target, sizeof(target));
+		if ((r > 0) && (r < sizeof(target))) {
+			target[r] = '\0';
+			/* ... and get the name of the device they point at */
+			name = basename(target);
+			if (name[0] == '\0') {
+				name = NULL;
+			}
+		}
+		else {
+			name = NULL;
+		}
 
-		strcpy(files[k++], namelist[i]->d_name);
+		if (devmap) {
+			if (__stat(link, &aux) == 0) {
+				add_name_cache_entry(nc, namelist[i]->d_name, name,
+						     __major(aux.st_rdev), __minor(aux.st_rdev), TRUE);
+			}
+			else {
+				add_name_cache_entry(nc, namelist[i]->d_name, name, 0, 0, FALSE);
+			}
+		}
+		else if (name && !lookup_name_cache(nc, name)) {
+			/* Index persistent name by the pretty name it points at */
+			add_name_cache_entry(nc, name, namelist[i]->d_name, 0, 0, FALSE);
+		}
 	}
-	files[k] = NULL;
-
-free_list:
 
 	for (i = 0; i < n; i++) {
 		free(namelist[i]);
 	}
 	free(namelist);
 
-	return (files);
+	nc->valid = TRUE;
+	nc->gen++;
+
+	return nc;
 }
 
 /*
  ***************************************************************************
  * Get persistent name from pretty name.
+ * The contents of the persistent type name directory are cached, and read
+ * again only when the directory has changed.
  *
  * IN:
  * @pretty	Pretty name (e.g. sda, sda1, ..).
@@ -972,57 +1284,202 @@ free_list:
 */
 char *get_persistent_name_from_pretty(char *pretty)
 {
-	int i = -1;
-	ssize_t r;
-	char *link, *name;
-	char **persist_names;
-	char target[PATH_MAX];
+	char *dir;
+	struct name_cache *nc;
+	struct name_ent *ne;
 	static char persist_name[FILENAME_MAX];
 
-	persist_name[0] = '\0';
+	/* Get directory name for selected persistent type */
+	if ((dir = get_persistent_type_dir(persistent_name_type)) == NULL)
+		return (NULL);
 
-	/* Get list of files from persistent type name directory */
-	persist_names = get_persistent_names();
-	if (!persist_names)
+	if (((nc = get_name_cache(&persist_cache, dir, FALSE)) == NULL) ||
+	    ((ne = lookup_name_cache(nc, pretty)) == NULL))
 		return (NULL);
 
-	while (persist_names[++i]) {
+	strncpy(persist_name, ne->name, sizeof(persist_name));
+	persist_name[sizeof(persist_name) - 1] = '\0';
 
-		/* Get absolute path for current persistent name */
-		link = get_persistent_name_path(persist_names[i]);
-		if (!link)
-			continue;
+	return persist_name;
+}
 
-		/* Persistent name is usually a symlink: Read it... */
-		r = readlink(link, target, PATH_MAX);
-		if ((r <= 0) || (r >= PATH_MAX))
-			continue;
+/*
+ ***************************************************************************
+ * Get the entry used to cache the names of a device, creating it if
+ * necessary.
+ *
+ * IN:
+ * @major	Device major number.
+ * @minor	Device minor number.
+ *
+ * RETURNS:
+ * Pointer on the device entry.
+ ***************************************************************************
+*/
+struct devname_ent *get_devname_ent(unsigned int major, unsigned int minor)
+{
+	struct devname_ent *de, **bucket;
 
-		target[r] = '\0';
+	bucket = &devname_cache[(major * 31 + minor) % DEVNAME_CACHE_SIZE];
 
-		/* ... and get device pretty name it points at */
-		name = basename(target);
-		if (!name || (name[0] == '\0'))
-			continue;
+	for (de = *bucket; de != NULL; de = de->hnext) {
+		if ((de->major == major) && (de->minor == minor))
+			return de;
+	}
 
-		if (!strncmp(name, pretty, FILENAME_MAX)) {
-			/* We have found pretty name for current persistent one */
-			strncpy(persist_name, persist_names[i], sizeof(persist_name));
-			persist_name[sizeof(persist_name) - 1] = '\0';
-			break;
-		}
+	if ((de = (struct devname_ent *) calloc(1, sizeof(struct devname_ent))) == NULL) {
+		perror("malloc");
+		exit(4);
 	}
+	de->major = major;
+	de->minor = minor;
+	de->hnext = *bucket;
+	*bucket = de;
 
-	i = -1;
-	while (persist_names[++i]) {
-		free (persist_names[i]);
+	return de;
+}
+
+/*
+ ***************************************************************************
+ * Get current generation of device names. It changes each time a block
+ * device is added or removed, as seen in /dev/block. If this directory
+ * cannot be watched, it changes every second so that device names are
+ * still looked up again from time to time.
+ *
+ * RETURNS:
+ * Generation of device names.
+ ***************************************************************************
+*/
+unsigned int get_devname_gen(void)
+{
+#ifndef TEST
+	static time_t last_try = 0;
+	struct timespec ts;
+
+	if (devname_wd < 0) {
+		clock_gettime(CLOCK_MONOTONIC_COARSE, &ts);
+		if (ts.tv_sec != last_try) {
+			last_try = ts.tv_sec;
+			if (name_cache_ifd < 0) {
+				name_cache_ifd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+			}
+			if (name_cache_ifd >= 0) {
+				devname_wd = inotify_add_watch(name_cache_ifd, DEV_BLOCK,
+							       IN_CREATE | IN_DELETE |
+							       IN_MOVED_FROM | IN_MOVED_TO |
+							       IN_DELETE_SELF | IN_MOVE_SELF);
+			}
+			/* Names found before the watch was set may be outdated */
+			devname_gen++;
+		}
 	}
-	free (persist_names);
+#endif
+	check_name_caches();
+
+	return devname_gen;
+}
+
+/*
+ ***************************************************************************
+ * Get persistent name of a device from its major and minor numbers.
+ * The result is saved and used again as long as the persistent type name
+ * directory has not changed.
+ *
+ * IN:
+ * @major	Device major number.
+ * @minor	Device minor number.
+ *
+ * RETURNS:
+ * Persistent name, or NULL if not found.
+ ***************************************************************************
+*/
+char *get_persistent_name_from_devnr(unsigned int major, unsigned int minor)
+{
+	char *dir;
+	struct devname_ent *de;
+	struct name_cache *nc;
+	struct name_ent *ne;
 
-	if (!strlen(persist_name))
+	de = get_devname_ent(major, minor);
+
+	check_name_caches();
+	if (de->has_persist && persist_cache.valid && (de->persist_gen == persist_cache.gen))
+		return de->persist;
+
+	/* Get directory name for selected persistent type */
+	if (((dir = get_persistent_type_dir(persistent_name_type)) == NULL) ||
+	    ((nc = get_name_cache(&persist_cache, dir, FALSE)) == NULL))
 		return (NULL);
 
-	return persist_name;
+	/* Entry remains valid until the cache is built again */
+	ne = lookup_name_cache(nc, get_devname(major, minor));
+	de->persist = (ne != NULL) ? ne->name : NULL;
+	de->persist_gen = nc->gen;
+	de->has_persist = TRUE;
+
+	return de->persist;
+}
+
+/*
+ ***************************************************************************
+ * Get device mapper name (e.g. "dm-0") from its registered name (e.g.
+ * "virtualhd-home"). The registered name is a symlink pointing at its device
+ * mapper name in the /dev/mapper directory, whose contents are cached.
+ *
+ * IN:
+ * @registered_name	Registered name of the device (e.g. "virtualhd-home").
+ *
+ * RETURNS:
+ * Device mapper name (e.g. "dm-0"), or NULL if not found.
+ ***************************************************************************
+ */
+char *get_dm_name_from_registered_name(char *registered_name)
+{
+	struct name_cache *nc;
+	struct name_ent *ne;
+
+	if (((nc = get_name_cache(&devmap_cache, DEVMAP_DIR, TRUE)) == NULL) ||
+	    ((ne = lookup_name_cache(nc, registered_name)) == NULL))
+		return (NULL);
+
+	return ne->name;
+}
+
+/*
+ ***************************************************************************
+ * Get the registered name of a device mapper device (e.g. "virtualhd-home")
+ * from its major and minor numbers, using the cached contents of the
+ * /dev/mapper directory.
+ *
+ * IN:
+ * @major	Device major number.
+ * @minor	Device minor number.
+ *
+ * OUT:
+ * @name	Registered name of the device, or NULL if not found.
+ *
+ * RETURNS:
+ * 0 on success, or -1 if /dev/mapper directory cannot be read.
+ ***************************************************************************
+ */
+int get_registered_name_from_devnr(unsigned int major, unsigned int minor, char **name)
+{
+	struct name_cache *nc;
+	struct name_ent *ne;
+
+	*name = NULL;
+
+	if ((nc = get_name_cache(&devmap_cache, DEVMAP_DIR, TRUE)) == NULL)
+		return -1;
+
+	for (ne = nc->by_dev[(major * 31 + minor) % NAME_CACHE_SIZE]; ne != NULL; ne = ne->dnext) {
+		if ((ne->major == major) && (ne->minor == minor)) {
+			*name = ne->key;
+			break;
+		}
+	}
+
+	return 0;
 }
 
 /*
@@ -1108,24 +1565,41 @@ char *get_devname_from_sysfs(unsigned int major, unsigned int minor)
  *
  * RETURNS:
  * The name of the device, which may be the real name (as it appears in /dev)
- * or a string with the following format devM-n.
+ * or a string with the following format devM-n. The name is saved and used
+ * again as long as no block device has been added or removed.
  ***************************************************************************
  */
 char *get_devname(unsigned int major, unsigned int minor)
 {
-	static char buf[32];
+	char buf[32];
 	char *name;
+	unsigned int gen;
+	struct devname_ent *de;
+
+	/* Has the name of this device already been found? */
+	de = get_devname_ent(major, minor);
+	gen = get_devname_gen();
+	if (de->pretty[0] && (de->pretty_gen == gen))
+		return (de->pretty);
 
 	name = get_devname_from_sysfs(major, minor);
-	if (name != NULL)
-		return (name);
+	if (name == NULL) {
+		name = ioc_name(major, minor);
+		if ((name == NULL) || !strcmp(name, K_NODEV)) {
+			snprintf(buf, sizeof(buf), "dev%u-%u", major, minor);
+			name = buf;
+		}
+	}
 
-	name = ioc_name(major, minor);
-	if ((name != NULL) && strcmp(name, K_NODEV))
-		return (name);
+	if (strcmp(de->pretty, name)) {
+		strncpy(de->pretty, name, sizeof(de->pretty) - 1);
+		de->pretty[sizeof(de->pretty) - 1] = '\0';
+		/* Persistent name has been found for another device */
+		de->has_persist = FALSE;
+	}
+	de->pretty_gen = gen;
 
-	snprintf(buf, sizeof(buf), "dev%u-%u", major, minor);
-	return (buf);
+	return (de->pretty);
 }
 
 /*
@@ -1156,7 +1630,7 @@ char *get_device_name(unsigned int major, unsigned int minor, unsigned long long
 	static char sid[64], dname[MAX_NAME_LEN];
 
 	if (disp_persist_name) {
-		persist_dev_name = get_persistent_name_from_pretty(get_devname(major, minor));
+		persist_dev_name = get_persistent_name_from_devnr(major, minor);
 	}
 
 	if (persist_dev_name) {
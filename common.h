@@ -13,6 +13,7 @@
 #include <sched.h>	/* For __CPU_SETSIZE */
 #include <limits.h>
 #include <stdlib.h>
+#include <sys/types.h>	/* For ssize_t */
 #include "systest.h"
 
 #ifdef HAVE_SYS_SYSMACROS_H
@@ -90,6 +91,7 @@ enum {
 #define DEVICES			PRE "/proc/devices"
 #define DEV_DISK_BY		PRE "/dev/disk/by"
 #define DEV_DISK_BY_ID		PRE "/dev/disk/by-id"
+#define DEV_BLOCK		PRE "/dev/block"
 
 #define MAX_FILE_LEN		512
 #define MAX_PF_NAME		1024
@@ -277,6 +279,87 @@ struct ext_disk_stats {
 	double arqsz;
 };
 
+/*
+ ***************************************************************************
+ * Buffer used to read the whole contents of a file (see read_file_buf())
+ ***************************************************************************
+ */
+
+/* Initial size of the buffer */
+#define FILE_BUF_INIT_SIZE	65536
+/* Number of NUL characters written at the end of the contents */
+#define FILE_BUF_PAD		8
+
+struct file_buf {
+	int fd;
+	size_t size;
+	char *buf;
+};
+
+/*
+ ***************************************************************************
+ * Structures used to cache the contents of the persistent type name and
+ * device mapper directories (/dev/disk/by-* and /dev/mapper)
+ ***************************************************************************
+ */
+
+/* Number of buckets in the hash tables of a name cache */
+#define NAME_CACHE_SIZE	256
+
+struct name_ent {
+	/* Next entry with same key hash value */
+	struct name_ent *knext;
+	/* Next entry with same major/minor hash value */
+	struct name_ent *dnext;
+	/* Next entry in list of all entries */
+	struct name_ent *lnext;
+	unsigned int major;
+	unsigned int minor;
+	/* Pretty name for a persistent name, registered name for a device mapper */
+	char *key;
+	/* Persistent name, or device mapper name (e.g. "dm-0"). May be NULL */
+	char *name;
+};
+
+struct name_cache {
+	/* Directory whose contents are cached */
+	char dir[MAX_FILE_LEN];
+	/* inotify watch descriptor for this directory */
+	int wd;
+	/* TRUE if the cache is up to date */
+	int valid;
+	/* Incremented each time the cache is built again */
+	unsigned int gen;
+	struct name_ent *list;
+	struct name_ent *by_key[NAME_CACHE_SIZE];
+	struct name_ent *by_dev[NAME_CACHE_SIZE];
+};
+
+/*
+ ***************************************************************************
+ * Structures used to cache device names by major and minor numbers
+ ***************************************************************************
+ */
+
+/* Number of buckets in the device names hash table */
+#define DEVNAME_CACHE_SIZE	256
+
+struct devname_ent {
+	struct devname_ent *hnext;
+	unsigned int major;
+	unsigned int minor;
+	/* Real name (from sysfs or ioconf) or devM-n name. Empty if not found yet */
+	char pretty[MAX_NAME_LEN];
+	/* Generation of device names @pretty has been found in */
+	unsigned int pretty_gen;
+	/* Persistent name (NULL if none) */
+	char *persist;
+	/* Generation of the persistent names cache @persist comes from */
+	unsigned int persist_gen;
+	/* TRUE if @persist has been looked up */
+	int has_persist;
+};
+
 /*
  ***************************************************************************
  * Functions prototypes
@@ -306,6 +389,8 @@ int check_dir
 	(char *);
 void check_overflow
 	(unsigned int, unsigned int, unsigned int);
+ssize_t read_file_buf
+	(char *, struct file_buf *);
 
 #ifndef SOURCE_SADC
 int count_bits
@@ -335,8 +420,32 @@ unsigned int get_devmap_major
 	(void);
 unsigned long long get_interval
 	(unsigned long long, unsigned long long);
+void add_name_cache_entry
+	(struct name_cache *, char *, char *, unsigned int, unsigned int, int);
+void check_name_caches
+	(void);
+void free_name_cache
+	(struct name_cache *);
+char *get_dm_name_from_registered_name
+	(char *);
+char *get_devname
+	(unsigned int, unsigned int);
+struct devname_ent *get_devname_ent
+	(unsigned int, unsigned int);
+unsigned int get_devname_gen
+	(void);
+struct name_cache *get_name_cache
+	(struct name_cache *, char *, int);
+char *get_persistent_name_from_devnr
+	(unsigned int, unsigned int);
 char *get_persistent_name_from_pretty
 	(char *);
+int get_registered_name_from_devnr
+	(unsigned int, unsigned int, char **);
+unsigned int hash_cached_name
+	(const char *);
+struct name_ent *lookup_name_cache
+	(struct name_cache *, char *);
 char *get_persistent_type_dir
 	(char *);
 char *get_pretty_name_from_persistent
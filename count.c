@@ -27,7 +27,6 @@
 #include <ctype.h>
 #include <sys/types.h>
 #include <sys/stat.h>
-#include <sys/statvfs.h>
 #include <unistd.h>
 
 #include "common.h"
@@ -430,73 +429,33 @@ __nr_t get_usb_nr(void)
  ***************************************************************************
  * Find number of filesystems in /etc/mtab. Pseudo-filesystems are ignored.
  *
+ * IN:
+ * @fs_filter	Filesystems to collect (NULL or empty to count all of them).
+ *
  * RETURNS:
  * Number of filesystems.
  ***************************************************************************
  */
-__nr_t get_filesystem_nr(void)
+__nr_t get_filesystem_nr(struct glob_filter *fs_filter)
 {
-	FILE *fp;
-	char line[512], fs_name[MAX_FS_LEN], mountp[256], type[128];
-	char *pos = 0, *pos2 = 0;
+	struct fs_mount *mnt;
+	int i, nr;
 	__nr_t fs = 0;
-	int skip, skip_next = 0;
-	struct statvfs buf;
-
-	if ((fp = fopen(MTAB, "r")) == NULL)
-		/* File non-existent */
-		return 0;
-
-	/* Get current filesystem */
-	while (fgets(line, sizeof(line), fp) != NULL) {
-		/*
-		 * Ignore line if the preceding line did not contain '\n'.
-		 * (Some very long lines may be found for instance when
-		 * overlay2 filesystem with docker is used).
-		 */
-		skip = skip_next;
-		skip_next = (strchr(line, '\n') == NULL);
-		if (skip)
-			continue;
-
-		if (line[0] == '/') {
-			/* Find field separator position */
-			pos = strchr(line, ' ');
-			if (pos == NULL)
-				continue;
 
-			/*
-			 * Find second field separator position,
-			 * read filesystem type,
-			 * if filesystem type is autofs, skip it
-			*/
-			pos2 = strchr(pos + 1, ' ');
-			if (pos2 == NULL)
-				continue;
-
-			sscanf(pos2 + 1, "%127s", type);
-			if (strcmp(type, "autofs") == 0)
-				continue;
+	nr = read_mount_list(&mnt, fs_filter);
 
-			/* Read filesystem name and mount point */
-			sscanf(line, "%127s", fs_name);
-			sscanf(pos + 1, "%255s", mountp);
-
-			/* Replace octal codes */
-			oct2chr(mountp);
-
-			/* Check that total size is not zero */
-			if (__statvfs(mountp, &buf) < 0)
-				continue;
+	/*
+	 * Check that total size is not zero.
+	 * Don't block on unresponsive filesystems (e.g. hung NFS mounts).
+	 */
+	statvfs_mounts(mnt, nr);
 
-			if (buf.f_blocks) {
-				fs++;
-			}
+	for (i = 0; i < nr; i++) {
+		if (!mnt[i].rc && mnt[i].usage.f_blocks) {
+			fs++;
 		}
 	}
 
-	fclose(fp);
-
 	return fs;
 }
 
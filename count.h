@@ -32,7 +32,7 @@ __nr_t get_freq_nr
 __nr_t get_usb_nr
 	(void);
 __nr_t get_filesystem_nr
-	(void);
+	(struct glob_filter *);
 __nr_t get_fchost_nr
 	(void);
 __nr_t get_bat_nr
@@ -41,8 +41,17 @@
 #endif
 
 static unsigned int ioc_parsed = 0;
-static struct ioc_entry *ioconf[MAX_BLKDEV + 1];
-static unsigned int ioc_refnr[MAX_BLKDEV + 1];
+/* Entries read from a user supplied ioconf file */
+static struct ioc_entry *ioc_file[MAX_BLKDEV + 1];
+static unsigned int ioc_file_refnr[MAX_BLKDEV + 1];
+/* Entries in use: Either those read from file or the built-in ones */
+static struct ioc_entry **ioconf = ioc_file;
+static unsigned int *ioc_refnr = ioc_file_refnr;
+/*
+ * Names already generated by ioc_name(), indexed by major number
+ * then by minor number (in blocks of IOC_NAMES_BLK minors).
+ */
+static char ***ioc_names[MAX_BLKDEV + 1];
 
 /*
  ***************************************************************************
@@ -128,13 +137,18 @@ char *ioc_ito26(unsigned int n)
 	return (ioc_conv(26, 1, "zabcdefghijklmnopqrstuvwxy", n));
 }
 
+/* Built-in table generated from sysstat.ioconf file at build time */
+#include "ioconf_tab.h"
+
 /*
  ***************************************************************************
  * ioc_init() - internalize the ioconf file
  *
  * given:    void
  * does:     parses IOCONF into ioconf, an array of ioc_entry *
- *           Only entries having lines in IOCONF will have valid pointers
+ *           Only entries having lines in IOCONF will have valid pointers.
+ *           If no ioconf file exists, use the built-in table generated
+ *           from sysstat.ioconf at build time instead.
  * return:   1 on success
  *           0 on failure
  ***************************************************************************
@@ -153,8 +167,14 @@ int ioc_init(void)
 	char ioconf_name[64];
 
 	if ((fp = fopen(IOCONF, "r")) == NULL) {
-		if ((fp = fopen(LOCAL_IOCONF, "r")) == NULL)
-			return 0;
+		if ((fp = fopen(LOCAL_IOCONF, "r")) == NULL) {
+			/* No user supplied file: Use built-in table */
+			ioconf = ioc_builtin;
+			ioc_refnr = ioc_builtin_refnr;
+			ioc_parsed = 1;
+
+			return (IOC_BUILTIN_NR);
+		}
 		strncpy(ioconf_name, LOCAL_IOCONF, sizeof(ioconf_name));
 	}
 	else {
@@ -163,7 +183,7 @@ int ioc_init(void)
 	ioconf_name[sizeof(ioconf_name) - 1] = '\0';
 
 	/* Init ioc_refnr array */
-	memset(ioc_refnr, 0, sizeof(ioc_refnr));
+	memset(ioc_file_refnr, 0, sizeof(ioc_file_refnr));
 
 	while (fgets(buf, sizeof(buf) - 1, fp)) {
 
@@ -373,32 +393,21 @@ free_and_return:
 
 /*
  ***************************************************************************
- *  ioc_name() - Generate a name from a maj,min pair
+ *  ioc_make_name() - Generate a name from a maj,min pair
  *
  * IN:
  * @major	Device major number.
  * @minor	Device minor number.
  *
- * RETURNS:
- * Returns NULL if major or minor are out of range
- * otherwise returns a pointer to a static string containing
- * the generated name.
+ * OUT:
+ * @name	Generated name (buffer of IOC_DEVLEN bytes).
  ***************************************************************************
  */
-
-char *ioc_name(unsigned int major, unsigned int minor)
+static void ioc_make_name(unsigned int major, unsigned int minor, char *name)
 {
-	static char name[IOC_DEVLEN];
 	struct ioc_entry *p;
 	int base, offset;
 
-	if ((major > MAX_BLKDEV) || (minor > IOC_MAXMINOR)) {
-		return (NULL);
-	}
-
-	if (!ioc_parsed && !ioc_init())
-		return (NULL);
-
 	p = ioconf[major];
 
 	/* Invalid major or minor numbers? */
@@ -408,14 +417,14 @@ char *ioc_name(unsigned int major, unsigned int minor)
 		 * that have no minors over 128.
 		 */
 		strcpy(name, K_NODEV);
-		return (name);
+		return;
 	}
 
 	/* Is this an extension record? */
 	if (p->blkp->ext && (p->blkp->ext_minor == minor)) {
-		strncpy(name, p->blkp->ext_name, sizeof(name));
-		name[sizeof(name) - 1] = '\0';
-		return (name);
+		strncpy(name, p->blkp->ext_name, IOC_DEVLEN);
+		name[IOC_DEVLEN - 1] = '\0';
+		return;
 	}
 
 	/* OK.  we're doing an actual device name... */
@@ -450,9 +459,68 @@ char *ioc_name(unsigned int major, unsigned int minor)
 		 */
 		sprintf(name + strlen(name), p->blkp->pfmt, minor % p->blkp->pcount);
 	}
-	return (name);
 }
 
+/*
+ ***************************************************************************
+ *  ioc_name() - Generate a name from a maj,min pair
+ *  A name is generated only once: It is then saved and found again using
+ *  major and minor numbers as indexes.
+ *
+ * IN:
+ * @major	Device major number.
+ * @minor	Device minor number.
+ *
+ * RETURNS:
+ * Returns NULL if major or minor are out of range
+ * otherwise returns a pointer to a string containing
+ * the generated name.
+ ***************************************************************************
+ */
+char *ioc_name(unsigned int major, unsigned int minor)
+{
+	char name[IOC_DEVLEN];
+	char **blk;
+
+	if ((major > MAX_BLKDEV) || (minor > IOC_MAXMINOR)) {
+		return (NULL);
+	}
+
+	if (ioc_names[major] != NULL) {
+		blk = ioc_names[major][minor / IOC_NAMES_BLK];
+		if ((blk != NULL) && (blk[minor % IOC_NAMES_BLK] != NULL))
+			/* Name already generated */
+			return (blk[minor % IOC_NAMES_BLK]);
+	}
+
+	if (!ioc_parsed && !ioc_init())
+		return (NULL);
+
+	ioc_make_name(major, minor, name);
+
+	/* Save generated name */
+	if ((ioc_names[major] == NULL) &&
+	    ((ioc_names[major] = (char ***) calloc((IOC_MAXMINOR / IOC_NAMES_BLK) + 1,
+						   sizeof(char **))) == NULL)) {
+		perror("malloc");
+		exit(4);
+	}
+	blk = ioc_names[major][minor / IOC_NAMES_BLK];
+	if ((blk == NULL) &&
+	    ((blk = ioc_names[major][minor / IOC_NAMES_BLK] =
+			(char **) calloc(IOC_NAMES_BLK, sizeof(char *))) == NULL)) {
+		perror("malloc");
+		exit(4);
+	}
+	if ((blk[minor % IOC_NAMES_BLK] = strdup(name)) == NULL) {
+		perror("strdup");
+		exit(4);
+	}
+
+	return (blk[minor % IOC_NAMES_BLK]);
+}
+
+
 /*
  ***************************************************************************
  * Transform device mapper name: Get the user assigned name of the logical
@@ -468,40 +536,19 @@ char *ioc_name(unsigned int major, unsigned int minor)
  */
 char *transform_devmapname(unsigned int major, unsigned int minor)
 {
-	DIR *dm_dir;
-	struct dirent *dp;
-	char filen[MAX_FILE_LEN];
-	char *dm_name = NULL;
+	char *dm_name;
 	static char name[MAX_NAME_LEN];
-	struct stat aux;
-	unsigned int dm_major, dm_minor;
 
-	if ((dm_dir = opendir(DEVMAP_DIR)) == NULL) {
+	/* Contents of DEVMAP_DIR are cached and read again only when it has changed */
+	if (get_registered_name_from_devnr(major, minor, &dm_name) < 0) {
 		fprintf(stderr, _("Cannot open %s: %s\n"), DEVMAP_DIR, strerror(errno));
 		exit(4);
 	}
+	if (dm_name == NULL)
+		return (NULL);
 
-	while ((dp = readdir(dm_dir)) != NULL) {
-		/* For each file in DEVMAP_DIR */
-
-		snprintf(filen, sizeof(filen), "%s/%s", DEVMAP_DIR, dp->d_name);
-		filen[sizeof(filen) - 1] = '\0';
-
-		if (__stat(filen, &aux) == 0) {
-			/* Get its minor and major numbers */
-
-			dm_major = __major(aux.st_rdev);
-			dm_minor = __minor(aux.st_rdev);
-
-			if ((dm_minor == minor) && (dm_major == major)) {
-				strncpy(name, dp->d_name, sizeof(name));
-				name[sizeof(name) - 1] = '\0';
-				dm_name = name;
-				break;
-			}
-		}
-	}
-	closedir(dm_dir);
+	strncpy(name, dm_name, sizeof(name));
+	name[sizeof(name) - 1] = '\0';
 
-	return dm_name;
+	return name;
 }
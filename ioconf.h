@@ -16,6 +16,8 @@
 #define IOC_LINESIZ	256
 #define IOC_FMTLEN	16
 #define IOC_XFMTLEN	(IOC_FMTLEN + IOC_NAMELEN + 3)
+/* Number of minors in each block of names saved by ioc_name() */
+#define IOC_NAMES_BLK	256
 
 #ifndef MINORBITS
 #define MINORBITS	20
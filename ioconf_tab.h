@@ -0,0 +1,307 @@
+/*
+ * ioconf_tab.h: Built-in ioconf table.
+ * Generated from sysstat.ioconf by mkioconf.awk. Do not edit.
+ */
+
+#define IOC_BUILTIN_NR	32
+
+static struct blk_config ioc_builtin_blk[] = {
+	{.name = "ram", .cfmt = "ram", .dfmt = "%s", .pfmt = "%d",
+	 .ctrl_explicit = 0, .dcount = 256, .pcount = 1, .desc = "RAM", .cconv = ioc_ito10,
+	 .ext_name = "initrd", .ext = 1, .ext_minor = 250},
+	{.name = "fd", .cfmt = "fd", .dfmt = "%s", .pfmt = "%d",
+	 .ctrl_explicit = 0, .dcount = 4, .pcount = 1, .desc = "Floppy", .cconv = ioc_ito10},
+	{.name = "hd", .cfmt = "hd", .dfmt = "%s", .pfmt = "%d",
+	 .ctrl_explicit = 0, .dcount = 2, .pcount = 64, .desc = "IDE", .cconv = ioc_ito26},
+	{.name = "loop", .cfmt = "loop", .dfmt = "%s", .pfmt = "%d",
+	 .ctrl_explicit = 0, .dcount = 256, .pcount = 1, .desc = "Loop", .cconv = ioc_ito10},
+	{.name = "sd", .cfmt = "sd", .dfmt = "%s", .pfmt = "%d",
+	 .ctrl_explicit = 0, .dcount = 16, .pcount = 16, .desc = "SCSI", .cconv = ioc_ito26},
+	{.name = "md", .cfmt = "md", .dfmt = "%s", .pfmt = "%d",
+	 .ctrl_explicit = 0, .dcount = 256, .pcount = 1, .desc = "Metadisk", .cconv = ioc_ito10},
+	{.name = "scd", .cfmt = "scd", .dfmt = "%s", .pfmt = "%d",
+	 .ctrl_explicit = 0, .dcount = 256, .pcount = 1, .desc = "CDROM", .cconv = ioc_ito10},
+	{.name = "xd", .cfmt = "xd", .dfmt = "%s", .pfmt = "%d",
+	 .ctrl_explicit = 0, .dcount = 2, .pcount = 64, .desc = "8-bit", .cconv = ioc_ito26},
+	{.name = "double", .cfmt = "double", .dfmt = "%s", .pfmt = "%d",
+	 .ctrl_explicit = 0, .dcount = 256, .pcount = 1, .desc = "Compressed", .cconv = ioc_ito10},
+	{.name = "mfm", .cfmt = "mfm", .dfmt = "%s", .pfmt = "%d",
+	 .ctrl_explicit = 0, .dcount = 2, .pcount = 64, .desc = "Acorn", .cconv = ioc_ito26},
+	{.name = "ed", .cfmt = "ed", .dfmt = "%s", .pfmt = "%d",
+	 .ctrl_explicit = 0, .dcount = 2, .pcount = 64, .desc = "MCA", .cconv = ioc_ito26},
+	{.name = "nb", .cfmt = "nb", .dfmt = "%s", .pfmt = "%d",
+	 .ctrl_explicit = 0, .dcount = 256, .pcount = 1, .desc = "Network", .cconv = ioc_ito10},
+	{.name = "ftl", .cfmt = "ftl", .dfmt = "%s", .pfmt = "%d",
+	 .ctrl_explicit = 0, .dcount = 16, .pcount = 16, .desc = "Flash", .cconv = ioc_ito26},
+	{.name = "pd", .cfmt = "pd", .dfmt = "%s", .pfmt = "%d",
+	 .ctrl_explicit = 0, .dcount = 4, .pcount = 16, .desc = "Parallel", .cconv = ioc_ito26},
+	{.name = "pf", .cfmt = "pf", .dfmt = "%s", .pfmt = "%d",
+	 .ctrl_explicit = 0, .dcount = 256, .pcount = 1, .desc = "Parallel", .cconv = ioc_ito10},
+	{.name = "rd", .cfmt = "rd/c%d", .dfmt = "d%s", .pfmt = "p%d",
+	 .ctrl_explicit = 1, .dcount = 32, .pcount = 8, .desc = "Mylex", .cconv = ioc_ito10},
+	{.name = "lvm", .cfmt = "lvm", .dfmt = "%s", .pfmt = "%d",
+	 .ctrl_explicit = 0, .dcount = 256, .pcount = 1, .desc = "Logical", .cconv = ioc_ito10},
+	{.name = "ida/", .cfmt = "ida/c%d", .dfmt = "d%s", .pfmt = "p%d",
+	 .ctrl_explicit = 1, .dcount = 16, .pcount = 16, .desc = "Compaq", .cconv = ioc_ito10},
+	{.name = "i2o/hd", .cfmt = "i2o/hd", .dfmt = "%s", .pfmt = "%d",
+	 .ctrl_explicit = 0, .dcount = 16, .pcount = 16, .desc = "I2O", .cconv = ioc_ito26},
+	{.name = "dasd", .cfmt = "dasd", .dfmt = "%s", .pfmt = "%d",
+	 .ctrl_explicit = 0, .dcount = 64, .pcount = 4, .desc = "IBM", .cconv = ioc_ito26},
+	{.name = "ubd", .cfmt = "ubd", .dfmt = "%s", .pfmt = "%d",
+	 .ctrl_explicit = 0, .dcount = 256, .pcount = 1, .desc = "User-mode", .cconv = ioc_ito10},
+	{.name = "amiraid/ar", .cfmt = "amiraid/ar", .dfmt = "%s", .pfmt = "p%d",
+	 .ctrl_explicit = 0, .dcount = 16, .pcount = 16, .desc = "AMI", .cconv = ioc_ito10},
+	{.name = "cciss", .cfmt = "cciss/c%d", .dfmt = "d%s", .pfmt = "p%d",
+	 .ctrl_explicit = 1, .dcount = 16, .pcount = 16, .desc = "HP", .cconv = ioc_ito10},
+	{.name = "iseries/vd", .cfmt = "iseries/vd", .dfmt = "%s", .pfmt = "%d",
+	 .ctrl_explicit = 0, .dcount = 32, .pcount = 8, .desc = "IBM", .cconv = ioc_ito26},
+	{.name = "emcpower", .cfmt = "emcpower", .dfmt = "%s", .pfmt = "%d",
+	 .ctrl_explicit = 0, .dcount = 16, .pcount = 16, .desc = "EMC", .cconv = ioc_ito26},
+	{.name = "carmel/", .cfmt = "carmel/", .dfmt = "%s", .pfmt = "p%d",
+	 .ctrl_explicit = 0, .dcount = 8, .pcount = 32, .desc = "Carmel", .cconv = ioc_ito10},
+	{.name = "ub", .cfmt = "ub", .dfmt = "%s", .pfmt = "p%d",
+	 .ctrl_explicit = 0, .dcount = 32, .pcount = 8, .desc = "USB", .cconv = ioc_ito26},
+	{.name = "xvd", .cfmt = "xvd", .dfmt = "%s", .pfmt = "p%d",
+	 .ctrl_explicit = 0, .dcount = 16, .pcount = 16, .desc = "Xen", .cconv = ioc_ito26},
+	{.name = "emcpower", .cfmt = "emcpower", .dfmt = "%s", .pfmt = "%d",
+	 .ctrl_explicit = 0, .dcount = 16, .pcount = 16, .desc = "EMC", .cconv = ioc_ito26},
+	{.name = "rfd", .cfmt = "rfd", .dfmt = "%s", .pfmt = "%d",
+	 .ctrl_explicit = 0, .dcount = 16, .pcount = 16, .desc = "Resident", .cconv = ioc_ito26},
+	{.name = "ssfdc", .cfmt = "ssfdc", .dfmt = "%s", .pfmt = "%d",
+	 .ctrl_explicit = 0, .dcount = 8, .pcount = 8, .desc = "SSFDC", .cconv = ioc_ito26},
+	{.name = "blockrom", .cfmt = "blockrom", .dfmt = "%s", .pfmt = "%d",
+	 .ctrl_explicit = 0, .dcount = 256, .pcount = 1, .desc = "ROM/Flash", .cconv = ioc_ito10},
+};
+
+static struct ioc_entry ioc_builtin_ent[] = {
+	{.live = 1, .ctrlno = 0, .basemajor = 1, .desc = NULL, .blkp = &ioc_builtin_blk[0]},
+	{.live = 1, .ctrlno = 0, .basemajor = 2, .desc = NULL, .blkp = &ioc_builtin_blk[1]},
+	{.live = 1, .ctrlno = 0, .basemajor = 3, .desc = NULL, .blkp = &ioc_builtin_blk[2]},
+	{.live = 0, .ctrlno = 1, .basemajor = 3, .desc = ioc_builtin_blk[2].desc, .blkp = &ioc_builtin_blk[2]},
+	{.live = 0, .ctrlno = 2, .basemajor = 3, .desc = ioc_builtin_blk[2].desc, .blkp = &ioc_builtin_blk[2]},
+	{.live = 0, .ctrlno = 3, .basemajor = 3, .desc = ioc_builtin_blk[2].desc, .blkp = &ioc_builtin_blk[2]},
+	{.live = 0, .ctrlno = 4, .basemajor = 3, .desc = ioc_builtin_blk[2].desc, .blkp = &ioc_builtin_blk[2]},
+	{.live = 0, .ctrlno = 5, .basemajor = 3, .desc = ioc_builtin_blk[2].desc, .blkp = &ioc_builtin_blk[2]},
+	{.live = 0, .ctrlno = 6, .basemajor = 3, .desc = ioc_builtin_blk[2].desc, .blkp = &ioc_builtin_blk[2]},
+	{.live = 0, .ctrlno = 7, .basemajor = 3, .desc = ioc_builtin_blk[2].desc, .blkp = &ioc_builtin_blk[2]},
+	{.live = 0, .ctrlno = 8, .basemajor = 3, .desc = ioc_builtin_blk[2].desc, .blkp = &ioc_builtin_blk[2]},
+	{.live = 0, .ctrlno = 9, .basemajor = 3, .desc = ioc_builtin_blk[2].desc, .blkp = &ioc_builtin_blk[2]},
+	{.live = 1, .ctrlno = 0, .basemajor = 7, .desc = NULL, .blkp = &ioc_builtin_blk[3]},
+	{.live = 1, .ctrlno = 0, .basemajor = 8, .desc = NULL, .blkp = &ioc_builtin_blk[4]},
+	{.live = 0, .ctrlno = 1, .basemajor = 8, .desc = ioc_builtin_blk[4].desc, .blkp = &ioc_builtin_blk[4]},
+	{.live = 0, .ctrlno = 2, .basemajor = 8, .desc = ioc_builtin_blk[4].desc, .blkp = &ioc_builtin_blk[4]},
+	{.live = 0, .ctrlno = 3, .basemajor = 8, .desc = ioc_builtin_blk[4].desc, .blkp = &ioc_builtin_blk[4]},
+	{.live = 0, .ctrlno = 4, .basemajor = 8, .desc = ioc_builtin_blk[4].desc, .blkp = &ioc_builtin_blk[4]},
+	{.live = 0, .ctrlno = 5, .basemajor = 8, .desc = ioc_builtin_blk[4].desc, .blkp = &ioc_builtin_blk[4]},
+	{.live = 0, .ctrlno = 6, .basemajor = 8, .desc = ioc_builtin_blk[4].desc, .blkp = &ioc_builtin_blk[4]},
+	{.live = 0, .ctrlno = 7, .basemajor = 8, .desc = ioc_builtin_blk[4].desc, .blkp = &ioc_builtin_blk[4]},
+	{.live = 0, .ctrlno = 8, .basemajor = 8, .desc = ioc_builtin_blk[4].desc, .blkp = &ioc_builtin_blk[4]},
+	{.live = 0, .ctrlno = 9, .basemajor = 8, .desc = ioc_builtin_blk[4].desc, .blkp = &ioc_builtin_blk[4]},
+	{.live = 0, .ctrlno = 10, .basemajor = 8, .desc = ioc_builtin_blk[4].desc, .blkp = &ioc_builtin_blk[4]},
+	{.live = 0, .ctrlno = 11, .basemajor = 8, .desc = ioc_builtin_blk[4].desc, .blkp = &ioc_builtin_blk[4]},
+	{.live = 0, .ctrlno = 12, .basemajor = 8, .desc = ioc_builtin_blk[4].desc, .blkp = &ioc_builtin_blk[4]},
+	{.live = 0, .ctrlno = 13, .basemajor = 8, .desc = ioc_builtin_blk[4].desc, .blkp = &ioc_builtin_blk[4]},
+	{.live = 0, .ctrlno = 14, .basemajor = 8, .desc = ioc_builtin_blk[4].desc, .blkp = &ioc_builtin_blk[4]},
+	{.live = 0, .ctrlno = 15, .basemajor = 8, .desc = ioc_builtin_blk[4].desc, .blkp = &ioc_builtin_blk[4]},
+	{.live = 1, .ctrlno = 0, .basemajor = 9, .desc = NULL, .blkp = &ioc_builtin_blk[5]},
+	{.live = 1, .ctrlno = 0, .basemajor = 11, .desc = NULL, .blkp = &ioc_builtin_blk[6]},
+	{.live = 1, .ctrlno = 0, .basemajor = 13, .desc = NULL, .blkp = &ioc_builtin_blk[7]},
+	{.live = 1, .ctrlno = 0, .basemajor = 19, .desc = NULL, .blkp = &ioc_builtin_blk[8]},
+	{.live = 1, .ctrlno = 0, .basemajor = 21, .desc = NULL, .blkp = &ioc_builtin_blk[9]},
+	{.live = 1, .ctrlno = 0, .basemajor = 36, .desc = NULL, .blkp = &ioc_builtin_blk[10]},
+	{.live = 1, .ctrlno = 0, .basemajor = 43, .desc = NULL, .blkp = &ioc_builtin_blk[11]},
+	{.live = 1, .ctrlno = 0, .basemajor = 44, .desc = NULL, .blkp = &ioc_builtin_blk[12]},
+	{.live = 1, .ctrlno = 0, .basemajor = 45, .desc = NULL, .blkp = &ioc_builtin_blk[13]},
+	{.live = 1, .ctrlno = 0, .basemajor = 47, .desc = NULL, .blkp = &ioc_builtin_blk[14]},
+	{.live = 1, .ctrlno = 0, .basemajor = 48, .desc = NULL, .blkp = &ioc_builtin_blk[15]},
+	{.live = 0, .ctrlno = 1, .basemajor = 48, .desc = ioc_builtin_blk[15].desc, .blkp = &ioc_builtin_blk[15]},
+	{.live = 0, .ctrlno = 2, .basemajor = 48, .desc = ioc_builtin_blk[15].desc, .blkp = &ioc_builtin_blk[15]},
+	{.live = 0, .ctrlno = 3, .basemajor = 48, .desc = ioc_builtin_blk[15].desc, .blkp = &ioc_builtin_blk[15]},
+	{.live = 0, .ctrlno = 4, .basemajor = 48, .desc = ioc_builtin_blk[15].desc, .blkp = &ioc_builtin_blk[15]},
+	{.live = 0, .ctrlno = 5, .basemajor = 48, .desc = ioc_builtin_blk[15].desc, .blkp = &ioc_builtin_blk[15]},
+	{.live = 0, .ctrlno = 6, .basemajor = 48, .desc = ioc_builtin_blk[15].desc, .blkp = &ioc_builtin_blk[15]},
+	{.live = 0, .ctrlno = 7, .basemajor = 48, .desc = ioc_builtin_blk[15].desc, .blkp = &ioc_builtin_blk[15]},
+	{.live = 0, .ctrlno = 8, .basemajor = 48, .desc = ioc_builtin_blk[15].desc, .blkp = &ioc_builtin_blk[15]},
+	{.live = 0, .ctrlno = 9, .basemajor = 48, .desc = ioc_builtin_blk[15].desc, .blkp = &ioc_builtin_blk[15]},
+	{.live = 0, .ctrlno = 10, .basemajor = 48, .desc = ioc_builtin_blk[15].desc, .blkp = &ioc_builtin_blk[15]},
+	{.live = 0, .ctrlno = 11, .basemajor = 48, .desc = ioc_builtin_blk[15].desc, .blkp = &ioc_builtin_blk[15]},
+	{.live = 0, .ctrlno = 12, .basemajor = 48, .desc = ioc_builtin_blk[15].desc, .blkp = &ioc_builtin_blk[15]},
+	{.live = 0, .ctrlno = 13, .basemajor = 48, .desc = ioc_builtin_blk[15].desc, .blkp = &ioc_builtin_blk[15]},
+	{.live = 0, .ctrlno = 14, .basemajor = 48, .desc = ioc_builtin_blk[15].desc, .blkp = &ioc_builtin_blk[15]},
+	{.live = 0, .ctrlno = 15, .basemajor = 48, .desc = ioc_builtin_blk[15].desc, .blkp = &ioc_builtin_blk[15]},
+	{.live = 1, .ctrlno = 0, .basemajor = 58, .desc = NULL, .blkp = &ioc_builtin_blk[16]},
+	{.live = 1, .ctrlno = 0, .basemajor = 72, .desc = NULL, .blkp = &ioc_builtin_blk[17]},
+	{.live = 0, .ctrlno = 1, .basemajor = 72, .desc = ioc_builtin_blk[17].desc, .blkp = &ioc_builtin_blk[17]},
+	{.live = 0, .ctrlno = 2, .basemajor = 72, .desc = ioc_builtin_blk[17].desc, .blkp = &ioc_builtin_blk[17]},
+	{.live = 0, .ctrlno = 3, .basemajor = 72, .desc = ioc_builtin_blk[17].desc, .blkp = &ioc_builtin_blk[17]},
+	{.live = 0, .ctrlno = 4, .basemajor = 72, .desc = ioc_builtin_blk[17].desc, .blkp = &ioc_builtin_blk[17]},
+	{.live = 0, .ctrlno = 5, .basemajor = 72, .desc = ioc_builtin_blk[17].desc, .blkp = &ioc_builtin_blk[17]},
+	{.live = 0, .ctrlno = 6, .basemajor = 72, .desc = ioc_builtin_blk[17].desc, .blkp = &ioc_builtin_blk[17]},
+	{.live = 0, .ctrlno = 7, .basemajor = 72, .desc = ioc_builtin_blk[17].desc, .blkp = &ioc_builtin_blk[17]},
+	{.live = 1, .ctrlno = 0, .basemajor = 80, .desc = NULL, .blkp = &ioc_builtin_blk[18]},
+	{.live = 0, .ctrlno = 1, .basemajor = 80, .desc = ioc_builtin_blk[18].desc, .blkp = &ioc_builtin_blk[18]},
+	{.live = 0, .ctrlno = 2, .basemajor = 80, .desc = ioc_builtin_blk[18].desc, .blkp = &ioc_builtin_blk[18]},
+	{.live = 0, .ctrlno = 3, .basemajor = 80, .desc = ioc_builtin_blk[18].desc, .blkp = &ioc_builtin_blk[18]},
+	{.live = 0, .ctrlno = 4, .basemajor = 80, .desc = ioc_builtin_blk[18].desc, .blkp = &ioc_builtin_blk[18]},
+	{.live = 0, .ctrlno = 5, .basemajor = 80, .desc = ioc_builtin_blk[18].desc, .blkp = &ioc_builtin_blk[18]},
+	{.live = 0, .ctrlno = 6, .basemajor = 80, .desc = ioc_builtin_blk[18].desc, .blkp = &ioc_builtin_blk[18]},
+	{.live = 0, .ctrlno = 7, .basemajor = 80, .desc = ioc_builtin_blk[18].desc, .blkp = &ioc_builtin_blk[18]},
+	{.live = 1, .ctrlno = 0, .basemajor = 94, .desc = NULL, .blkp = &ioc_builtin_blk[19]},
+	{.live = 1, .ctrlno = 0, .basemajor = 98, .desc = NULL, .blkp = &ioc_builtin_blk[20]},
+	{.live = 1, .ctrlno = 0, .basemajor = 101, .desc = NULL, .blkp = &ioc_builtin_blk[21]},
+	{.live = 1, .ctrlno = 0, .basemajor = 104, .desc = NULL, .blkp = &ioc_builtin_blk[22]},
+	{.live = 0, .ctrlno = 1, .basemajor = 104, .desc = ioc_builtin_blk[22].desc, .blkp = &ioc_builtin_blk[22]},
+	{.live = 0, .ctrlno = 2, .basemajor = 104, .desc = ioc_builtin_blk[22].desc, .blkp = &ioc_builtin_blk[22]},
+	{.live = 0, .ctrlno = 3, .basemajor = 104, .desc = ioc_builtin_blk[22].desc, .blkp = &ioc_builtin_blk[22]},
+	{.live = 0, .ctrlno = 4, .basemajor = 104, .desc = ioc_builtin_blk[22].desc, .blkp = &ioc_builtin_blk[22]},
+	{.live = 0, .ctrlno = 5, .basemajor = 104, .desc = ioc_builtin_blk[22].desc, .blkp = &ioc_builtin_blk[22]},
+	{.live = 0, .ctrlno = 6, .basemajor = 104, .desc = ioc_builtin_blk[22].desc, .blkp = &ioc_builtin_blk[22]},
+	{.live = 0, .ctrlno = 7, .basemajor = 104, .desc = ioc_builtin_blk[22].desc, .blkp = &ioc_builtin_blk[22]},
+	{.live = 1, .ctrlno = 0, .basemajor = 112, .desc = NULL, .blkp = &ioc_builtin_blk[23]},
+	{.live = 1, .ctrlno = 0, .basemajor = 120, .desc = NULL, .blkp = &ioc_builtin_blk[24]},
+	{.live = 1, .ctrlno = 0, .basemajor = 160, .desc = NULL, .blkp = &ioc_builtin_blk[25]},
+	{.live = 0, .ctrlno = 1, .basemajor = 160, .desc = ioc_builtin_blk[25].desc, .blkp = &ioc_builtin_blk[25]},
+	{.live = 1, .ctrlno = 0, .basemajor = 180, .desc = NULL, .blkp = &ioc_builtin_blk[26]},
+	{.live = 1, .ctrlno = 0, .basemajor = 202, .desc = NULL, .blkp = &ioc_builtin_blk[27]},
+	{.live = 1, .ctrlno = 0, .basemajor = 232, .desc = NULL, .blkp = &ioc_builtin_blk[28]},
+	{.live = 0, .ctrlno = 1, .basemajor = 232, .desc = ioc_builtin_blk[28].desc, .blkp = &ioc_builtin_blk[28]},
+	{.live = 0, .ctrlno = 2, .basemajor = 232, .desc = ioc_builtin_blk[28].desc, .blkp = &ioc_builtin_blk[28]},
+	{.live = 0, .ctrlno = 3, .basemajor = 232, .desc = ioc_builtin_blk[28].desc, .blkp = &ioc_builtin_blk[28]},
+	{.live = 0, .ctrlno = 4, .basemajor = 232, .desc = ioc_builtin_blk[28].desc, .blkp = &ioc_builtin_blk[28]},
+	{.live = 0, .ctrlno = 5, .basemajor = 232, .desc = ioc_builtin_blk[28].desc, .blkp = &ioc_builtin_blk[28]},
+	{.live = 0, .ctrlno = 6, .basemajor = 232, .desc = ioc_builtin_blk[28].desc, .blkp = &ioc_builtin_blk[28]},
+	{.live = 0, .ctrlno = 7, .basemajor = 232, .desc = ioc_builtin_blk[28].desc, .blkp = &ioc_builtin_blk[28]},
+	{.live = 0, .ctrlno = 8, .basemajor = 232, .desc = ioc_builtin_blk[28].desc, .blkp = &ioc_builtin_blk[28]},
+	{.live = 0, .ctrlno = 9, .basemajor = 232, .desc = ioc_builtin_blk[28].desc, .blkp = &ioc_builtin_blk[28]},
+	{.live = 0, .ctrlno = 10, .basemajor = 232, .desc = ioc_builtin_blk[28].desc, .blkp = &ioc_builtin_blk[28]},
+	{.live = 0, .ctrlno = 11, .basemajor = 232, .desc = ioc_builtin_blk[28].desc, .blkp = &ioc_builtin_blk[28]},
+	{.live = 0, .ctrlno = 12, .basemajor = 232, .desc = ioc_builtin_blk[28].desc, .blkp = &ioc_builtin_blk[28]},
+	{.live = 0, .ctrlno = 13, .basemajor = 232, .desc = ioc_builtin_blk[28].desc, .blkp = &ioc_builtin_blk[28]},
+	{.live = 0, .ctrlno = 14, .basemajor = 232, .desc = ioc_builtin_blk[28].desc, .blkp = &ioc_builtin_blk[28]},
+	{.live = 0, .ctrlno = 15, .basemajor = 232, .desc = ioc_builtin_blk[28].desc, .blkp = &ioc_builtin_blk[28]},
+	{.live = 1, .ctrlno = 0, .basemajor = 256, .desc = NULL, .blkp = &ioc_builtin_blk[29]},
+	{.live = 1, .ctrlno = 0, .basemajor = 257, .desc = NULL, .blkp = &ioc_builtin_blk[30]},
+	{.live = 1, .ctrlno = 0, .basemajor = 258, .desc = NULL, .blkp = &ioc_builtin_blk[31]},
+};
+
+static struct ioc_entry *ioc_builtin[MAX_BLKDEV + 1] = {
+	[1] = &ioc_builtin_ent[0],
+	[2] = &ioc_builtin_ent[1],
+	[3] = &ioc_builtin_ent[2],
+	[7] = &ioc_builtin_ent[12],
+	[8] = &ioc_builtin_ent[13],
+	[9] = &ioc_builtin_ent[29],
+	[11] = &ioc_builtin_ent[30],
+	[13] = &ioc_builtin_ent[31],
+	[19] = &ioc_builtin_ent[32],
+	[21] = &ioc_builtin_ent[33],
+	[22] = &ioc_builtin_ent[3],
+	[33] = &ioc_builtin_ent[4],
+	[34] = &ioc_builtin_ent[5],
+	[36] = &ioc_builtin_ent[34],
+	[43] = &ioc_builtin_ent[35],
+	[44] = &ioc_builtin_ent[36],
+	[45] = &ioc_builtin_ent[37],
+	[47] = &ioc_builtin_ent[38],
+	[48] = &ioc_builtin_ent[39],
+	[49] = &ioc_builtin_ent[40],
+	[50] = &ioc_builtin_ent[41],
+	[51] = &ioc_builtin_ent[42],
+	[52] = &ioc_builtin_ent[43],
+	[53] = &ioc_builtin_ent[44],
+	[54] = &ioc_builtin_ent[45],
+	[55] = &ioc_builtin_ent[46],
+	[56] = &ioc_builtin_ent[6],
+	[57] = &ioc_builtin_ent[7],
+	[58] = &ioc_builtin_ent[55],
+	[65] = &ioc_builtin_ent[14],
+	[66] = &ioc_builtin_ent[15],
+	[67] = &ioc_builtin_ent[16],
+	[68] = &ioc_builtin_ent[17],
+	[69] = &ioc_builtin_ent[18],
+	[70] = &ioc_builtin_ent[19],
+	[71] = &ioc_builtin_ent[20],
+	[72] = &ioc_builtin_ent[56],
+	[73] = &ioc_builtin_ent[57],
+	[74] = &ioc_builtin_ent[58],
+	[75] = &ioc_builtin_ent[59],
+	[76] = &ioc_builtin_ent[60],
+	[77] = &ioc_builtin_ent[61],
+	[78] = &ioc_builtin_ent[62],
+	[79] = &ioc_builtin_ent[63],
+	[80] = &ioc_builtin_ent[64],
+	[81] = &ioc_builtin_ent[65],
+	[82] = &ioc_builtin_ent[66],
+	[83] = &ioc_builtin_ent[67],
+	[84] = &ioc_builtin_ent[68],
+	[85] = &ioc_builtin_ent[69],
+	[86] = &ioc_builtin_ent[70],
+	[87] = &ioc_builtin_ent[71],
+	[88] = &ioc_builtin_ent[8],
+	[89] = &ioc_builtin_ent[9],
+	[90] = &ioc_builtin_ent[10],
+	[91] = &ioc_builtin_ent[11],
+	[94] = &ioc_builtin_ent[72],
+	[98] = &ioc_builtin_ent[73],
+	[101] = &ioc_builtin_ent[74],
+	[104] = &ioc_builtin_ent[75],
+	[105] = &ioc_builtin_ent[76],
+	[106] = &ioc_builtin_ent[77],
+	[107] = &ioc_builtin_ent[78],
+	[108] = &ioc_builtin_ent[79],
+	[109] = &ioc_builtin_ent[80],
+	[110] = &ioc_builtin_ent[81],
+	[111] = &ioc_builtin_ent[82],
+	[112] = &ioc_builtin_ent[83],
+	[120] = &ioc_builtin_ent[84],
+	[128] = &ioc_builtin_ent[21],
+	[129] = &ioc_builtin_ent[22],
+	[130] = &ioc_builtin_ent[23],
+	[131] = &ioc_builtin_ent[24],
+	[132] = &ioc_builtin_ent[25],
+	[133] = &ioc_builtin_ent[26],
+	[134] = &ioc_builtin_ent[27],
+	[135] = &ioc_builtin_ent[28],
+	[136] = &ioc_builtin_ent[47],
+	[137] = &ioc_builtin_ent[48],
+	[138] = &ioc_builtin_ent[49],
+	[139] = &ioc_builtin_ent[50],
+	[140] = &ioc_builtin_ent[51],
+	[141] = &ioc_builtin_ent[52],
+	[142] = &ioc_builtin_ent[53],
+	[143] = &ioc_builtin_ent[54],
+	[160] = &ioc_builtin_ent[85],
+	[161] = &ioc_builtin_ent[86],
+	[180] = &ioc_builtin_ent[87],
+	[202] = &ioc_builtin_ent[88],
+	[232] = &ioc_builtin_ent[89],
+	[233] = &ioc_builtin_ent[90],
+	[234] = &ioc_builtin_ent[91],
+	[235] = &ioc_builtin_ent[92],
+	[236] = &ioc_builtin_ent[93],
+	[237] = &ioc_builtin_ent[94],
+	[238] = &ioc_builtin_ent[95],
+	[239] = &ioc_builtin_ent[96],
+	[240] = &ioc_builtin_ent[97],
+	[241] = &ioc_builtin_ent[98],
+	[242] = &ioc_builtin_ent[99],
+	[243] = &ioc_builtin_ent[100],
+	[244] = &ioc_builtin_ent[101],
+	[245] = &ioc_builtin_ent[102],
+	[246] = &ioc_builtin_ent[103],
+	[247] = &ioc_builtin_ent[104],
+	[256] = &ioc_builtin_ent[105],
+	[257] = &ioc_builtin_ent[106],
+	[258] = &ioc_builtin_ent[107],
+};
+
+static unsigned int ioc_builtin_refnr[MAX_BLKDEV + 1] = {
+	[3] = 9,
+	[8] = 15,
+	[48] = 15,
+	[72] = 7,
+	[80] = 7,
+	[104] = 7,
+	[160] = 1,
+	[232] = 15,
+};
@@ -32,6 +32,7 @@
 #include <sys/types.h>
 #include <sys/stat.h>
 #include <sys/utsname.h>
+#include <sys/resource.h>
 #include <libgen.h>
 
 #include "version.h"
@@ -61,6 +62,8 @@ struct stats_cpu *st_cpu[2];
 unsigned long long uptime_cs[2] = {0, 0};
 unsigned long long tot_jiffies[2] = {0, 0};
 struct io_device *dev_list = NULL;
+struct io_device *dev_hash[DEV_HASH_SIZE];	/* Devices in dev_list, indexed by name */
+struct io_device *dev_last = NULL;		/* Last device in dev_list */
 
 /* Number of decimal places */
 int dplaces_nr = -1;
@@ -73,6 +76,10 @@ long interval = 0;
 char timestamp[TIMESTAMP_LEN];
 char alt_dir[MAX_FILE_LEN];
 
+/* Number of stat file descriptors kept open, and max number allowed */
+int stat_fd_nr = 0;
+int stat_fd_max = 0;
+
 struct sigaction alrm_act, int_act;
 int sigint_caught = 0;
 
@@ -125,44 +132,6 @@ void set_disk_output_unit(void)
 	}
 }
 
-/*
- ***************************************************************************
- * Get device mapper name (e.g. "dm-0") from its registered name (e.g.
- * "virtualhd-home").
- *
- * IN:
- * @name	Registered name of the device (e.g. "virtualhd-home").
- *
- * RETURNS:
- * Name of the device mapper name (e.g. "dm-0").
- ***************************************************************************
- */
-char *get_dm_name_from_registered_name(char *registered_name)
-{
-	int n;
-	char filen[PATH_MAX];
-	char target[PATH_MAX];
-
-	/*
-	 * The registered device name is a symlink pointing at its device mapper name
-	 * in the /dev/mapper directory.
-	 */
-	n = snprintf(filen, sizeof(filen), "%s/%s", DEVMAP_DIR, registered_name);
-	if ((n >= sizeof(filen)) || access(filen, F_OK)) {
-		return (NULL);
-	}
-
-	/* Read symlink */
-	n = readlink(filen, target, PATH_MAX);
-	if ((n <= 0) || (n >= PATH_MAX))
-		return (NULL);
-
-	target[n] = '\0';
-
-	/* ... and get device mapper name it points at */
-	return basename(target);
-}
-
 /*
  ***************************************************************************
  * SIGALRM signal handler. No need to reset the handler here.
@@ -265,13 +234,37 @@ int get_major_minor_nr(char filename[], int *major, int *minor)
 	return 0;
 }
 
+/*
+ ***************************************************************************
+ * Compute the bucket number of a device in the hash table (FNV-1a hash).
+ *
+ * IN:
+ * @name	Device name.
+ *
+ * RETURNS:
+ * Bucket number in dev_hash[] array.
+ ***************************************************************************
+ */
+unsigned int hash_device_name(const char *name)
+{
+	unsigned int hash = 2166136261U;
+
+	while (*name) {
+		hash = (hash ^ (unsigned char) *name++) * 16777619U;
+	}
+
+	return hash % DEV_HASH_SIZE;
+}
+
 /*
  ***************************************************************************
  * Check if a device is present in the list, and add it if requested.
  * Also look for its type (device or partition) and save it.
+ * Devices are found using the dev_hash[] table, which indexes all the
+ * devices in dev_list.
  *
  * IN:
- * @dlist	Address of pointer on the start of the linked list.
+ * @dlist	Address of pointer on the start of the linked list (dev_list).
  * @name	Device name.
  * @dtype	T_PART_DEV (=2) if the device and all its partitions should
  *		also be read (option -p used), T_GROUP (=3) if it's a group
@@ -293,15 +286,15 @@ struct io_device *add_list_device(struct io_device **dlist, char *name, int dtyp
 {
 	struct io_device *d, *ds;
 	int i, maj_nr, min_nr;
+	unsigned int h;
 
 	if (strnlen(name, MAX_NAME_LEN) == MAX_NAME_LEN)
 		/* Device name is too long */
 		return NULL;
 
-	while (*dlist != NULL) {
-
-		d = *dlist;
-		if ((i = strcmp(d->name, name)) == 0) {
+	/* Look for the device in the hash table */
+	for (d = dev_hash[hash_device_name(name)]; d != NULL; d = d->hnext) {
+		if (!strcmp(d->name, name)) {
 			/* Device found in list */
 			if ((dtype == T_PART_DEV) && (d->dev_tp == T_DEV)) {
 				d->dev_tp = dtype;
@@ -309,16 +302,22 @@ struct io_device *add_list_device(struct io_device **dlist, char *name, int dtyp
 			d->exist = TRUE;
 			return d;
 		}
-		if (!GROUP_DEFINED(flags) && !DISPLAY_EVERYTHING(flags) && (i > 0))
-			/*
-			 * If no group defined and we don't use /proc/diskstats,
-			 * insert current device in alphabetical order.
-			 * NB: Using /proc/diskstats ("iostat -p ALL") is a bit better than
-			 * using alphabetical order because sda10 comes after sda9...
-			 */
-			break;
+	}
 
-		dlist = &(d->next);
+	if (!GROUP_DEFINED(flags) && !DISPLAY_EVERYTHING(flags)) {
+		/*
+		 * If no group defined and we don't use /proc/diskstats,
+		 * insert current device in alphabetical order.
+		 * NB: Using /proc/diskstats ("iostat -p ALL") is a bit better than
+		 * using alphabetical order because sda10 comes after sda9...
+		 */
+		while ((*dlist != NULL) && (strcmp((*dlist)->name, name) < 0)) {
+			dlist = &((*dlist)->next);
+		}
+	}
+	else if (dev_last != NULL) {
+		/* Append device to the end of the list */
+		dlist = &(dev_last->next);
 	}
 
 	/* Device not found */
@@ -360,7 +359,16 @@ struct io_device *add_list_device(struct io_device **dlist, char *name, int dtyp
 	}
 	d->name[MAX_NAME_LEN - 1] = '\0';
 	d->exist = TRUE;
+	d->stat_fd[SYS_FD] = d->stat_fd[ALT_FD] = -1;
 	d->next = ds;
+	if (ds == NULL) {
+		dev_last = d;
+	}
+
+	/* Index device by the name saved in list */
+	h = hash_device_name(d->name);
+	d->hnext = dev_hash[h];
+	dev_hash[h] = d;
 
 	if (dtype == T_GROUP) {
 		d->dev_tp = dtype;
@@ -401,36 +409,144 @@ struct io_device *add_list_device(struct io_device **dlist, char *name, int dtyp
 	return d;
 }
 
+/*
+ ***************************************************************************
+ * Close stat file descriptors kept open until no more than @max are left.
+ *
+ * IN:
+ * @max		Max number of descriptors that may be kept open.
+ ***************************************************************************
+ */
+void shrink_stat_fds(int max)
+{
+	struct io_device *d;
+	int i;
+
+	for (d = dev_list; (d != NULL) && (stat_fd_nr > max); d = d->next) {
+		for (i = SYS_FD; i <= ALT_FD; i++) {
+			if (d->stat_fd[i] >= 0) {
+				close(d->stat_fd[i]);
+				d->stat_fd[i] = -1;
+				stat_fd_nr--;
+			}
+		}
+	}
+}
+
+/*
+ ***************************************************************************
+ * Set the max number of stat file descriptors that may be kept open. This
+ * is the limit on the number of files the process may open, minus
+ * @STAT_FD_RESERVE descriptors left available for the other files.
+ ***************************************************************************
+ */
+void init_stat_fd_max(void)
+{
+	struct rlimit rlim;
+
+	if (getrlimit(RLIMIT_NOFILE, &rlim) < 0) {
+		/* Don't keep any descriptors open */
+		stat_fd_max = 0;
+	}
+	else if ((rlim.rlim_cur == RLIM_INFINITY) || (rlim.rlim_cur > INT_MAX)) {
+		stat_fd_max = INT_MAX - STAT_FD_RESERVE;
+	}
+	else if (rlim.rlim_cur > STAT_FD_RESERVE) {
+		stat_fd_max = (int) rlim.rlim_cur - STAT_FD_RESERVE;
+	}
+	else {
+		/* Very low limit: Keep at most half of the descriptors */
+		stat_fd_max = (int) rlim.rlim_cur / 2;
+	}
+}
+
 /*
  ***************************************************************************
  * Read sysfs stat for current block device or partition.
+ * If a descriptor is given, it is kept open on the stat file, and the file
+ * is read again with pread() at next sample instead of being reopened.
+ * No more than @stat_fd_max descriptors are kept open. If we run out of
+ * descriptors, some of those kept open are closed and the file is read
+ * again the usual way: The device is not considered as removed.
+ * In test mode, a descriptor is closed once the test root directory has
+ * been switched, since it still refers to the file of the previous one.
  *
  * IN:
  * @filename	File name where stats will be read.
  * @ios		Structure where stats will be saved.
+ * @dfd		Address of the descriptor kept open on the stat file (or -1
+ *		if none), or NULL if the file should not be kept open.
  *
  * OUT:
  * @ios		Structure where stats have been saved.
+ * @dfd		Descriptor kept open on the stat file, or -1.
  *
  * RETURNS:
  * 0 on success, -1 otherwise.
  ***************************************************************************
  */
-int read_sysfs_file_stat_work(char *filename, struct io_stats *ios)
+int read_sysfs_file_stat_work(char *filename, struct io_stats *ios, int *dfd)
 {
-	FILE *fp;
 	struct io_stats sdev;
-	int i;
+	int i, fd;
+	ssize_t sz = -1;
+	char line[512];
 	unsigned int ios_pgr, tot_ticks, rq_ticks, wr_ticks, dc_ticks, fl_ticks;
 	unsigned long rd_ios, rd_merges_or_rd_sec, wr_ios, wr_merges;
 	unsigned long rd_sec_or_wr_ios, wr_sec, rd_ticks_or_wr_sec;
 	unsigned long dc_ios, dc_merges, dc_sec, fl_ios;
+#ifdef TEST
+	struct stat st1, st2;
 
-	/* Try to read given stat file */
-	if ((fp = fopen(filename, "r")) == NULL)
-		return -1;
+	if (dfd && (*dfd >= 0) &&
+	    ((fstat(*dfd, &st1) < 0) || (stat(filename, &st2) < 0) ||
+	     (st1.st_dev != st2.st_dev) || (st1.st_ino != st2.st_ino))) {
+		/* File is no longer the same: Open it again */
+		close(*dfd);
+		*dfd = -1;
+		stat_fd_nr--;
+	}
+#endif
+
+	if (dfd && (*dfd >= 0)) {
+		/* Read stat file again using the descriptor kept open */
+		if ((sz = pread(*dfd, line, sizeof(line) - 1, 0)) <= 0) {
+			/* Device has probably been removed: Try to open its file again */
+			close(*dfd);
+			*dfd = -1;
+			stat_fd_nr--;
+		}
+	}
 
-	i = fscanf(fp, "%lu %lu %lu %lu %lu %lu %lu %u %u %u %u %lu %lu %lu %u %lu %u",
+	if (sz <= 0) {
+		/* Try to read given stat file */
+		if ((fd = open(filename, O_RDONLY)) < 0) {
+			if (((errno != EMFILE) && (errno != ENFILE)) || !stat_fd_nr)
+				return -1;
+
+			/* Too many open files: Keep fewer descriptors open and try again */
+			stat_fd_max = stat_fd_nr / 2;
+			shrink_stat_fds(stat_fd_max);
+			if ((fd = open(filename, O_RDONLY)) < 0)
+				return -1;
+		}
+
+		sz = read(fd, line, sizeof(line) - 1);
+		if (dfd && (sz > 0) && (stat_fd_nr < stat_fd_max)) {
+			/* Keep the descriptor for next samples */
+			*dfd = fd;
+			stat_fd_nr++;
+		}
+		else {
+			close(fd);
+		}
+
+		if (sz <= 0)
+			return -1;
+	}
+	line[sz] = '\0';
+
+	i = sscanf(line, "%lu %lu %lu %lu %lu %lu %lu %u %u %u %u %lu %lu %lu %u %lu %u",
 		   &rd_ios, &rd_merges_or_rd_sec, &rd_sec_or_wr_ios, &rd_ticks_or_wr_sec,
 		   &wr_ios, &wr_merges, &wr_sec, &wr_ticks, &ios_pgr, &tot_ticks, &rq_ticks,
 		   &dc_ios, &dc_merges, &dc_sec, &dc_ticks,
@@ -476,8 +592,6 @@ int read_sysfs_file_stat_work(char *filename, struct io_stats *ios)
 
 	*ios = sdev;
 
-	fclose(fp);
-
 	return 0;
 }
 
@@ -489,15 +603,18 @@ int read_sysfs_file_stat_work(char *filename, struct io_stats *ios)
  * IN:
  * @devname	Device name for which stats have to be read.
  * @ios		Structure where stats will be saved.
+ * @dfd		Descriptors kept open on the stat file in /sys and in the
+ *		alternate directory (or -1 if none).
  *
  * OUT:
  * @ios		Structure where stats have been saved.
+ * @dfd		Descriptors kept open on the stat files, or -1.
  *
  * RETURNS:
  * 0 on success, -1 otherwise.
  ***************************************************************************
  */
-int read_sysfs_file_stat(char *devname, struct io_stats *ios)
+int read_sysfs_file_stat(char *devname, struct io_stats *ios, int dfd[])
 {
 	int rc = 0;
 	char dfile[MAX_PF_NAME];
@@ -508,7 +625,7 @@ int read_sysfs_file_stat(char *devname, struct io_stats *ios)
 			 SLASH_SYS, __BLOCK, devname, S_STAT);
 		dfile[sizeof(dfile) - 1] = '\0';
 
-		rc = read_sysfs_file_stat_work(dfile, ios);
+		rc = read_sysfs_file_stat_work(dfile, ios, &dfd[SYS_FD]);
 	}
 
 	if (alt_dir[0] && (!USE_ALL_DIR(flags) || (USE_ALL_DIR(flags) && (rc < 0)))) {
@@ -517,7 +634,7 @@ int read_sysfs_file_stat(char *devname, struct io_stats *ios)
 			 alt_dir, __BLOCK, devname, S_STAT);
 		dfile[sizeof(dfile) - 1] = '\0';
 
-		rc = read_sysfs_file_stat_work(dfile, ios);
+		rc = read_sysfs_file_stat_work(dfile, ios, &dfd[ALT_FD]);
 	}
 
 	return rc;
@@ -561,7 +678,7 @@ int read_sysfs_device_part_stat_work(int curr, char *dname, char *sysdev)
 		filename[sizeof(filename) - 1] = '\0';
 
 		/* Read current partition stats */
-		if (read_sysfs_file_stat_work(filename, &sdev) < 0)
+		if (read_sysfs_file_stat_work(filename, &sdev, NULL) < 0)
 			continue;
 
 		d = add_list_device(&dev_list, drd->d_name, 0, UKWN_MAJ_NR, 0);
@@ -640,7 +757,7 @@ int read_sysfs_all_devices_stat_work(int curr, char *sysblock)
 		dfile[sizeof(dfile) - 1] = '\0';
 
 		/* Read current whole device stats */
-		if (read_sysfs_file_stat_work(dfile, &sdev) < 0)
+		if (read_sysfs_file_stat_work(dfile, &sdev, NULL) < 0)
 			continue;
 
 		d = add_list_device(&dev_list, drd->d_name, 0, UKWN_MAJ_NR, 0);
@@ -696,12 +813,13 @@ int read_sysfs_all_devices_stat(int curr)
  * @curr	Index in array for current sample statistics.
  * @d		Device structure.
  * @sysdev	sysfs directory.
+ * @fdi		Index of the descriptor to use in device's stat_fd[] array.
  *
  * RETURNS:
  * 0 on success, and -1 otherwise.
  ***************************************************************************
  */
-int read_sysfs_part_stat_work(int curr, struct io_device *d, char *sysdev)
+int read_sysfs_part_stat_work(int curr, struct io_device *d, char *sysdev, int fdi)
 {
 	char dfile[MAX_PF_NAME];
 
@@ -710,7 +828,7 @@ int read_sysfs_part_stat_work(int curr, struct io_device *d, char *sysdev)
 		 sysdev, __DEV_BLOCK, d->major, d->minor, S_STAT);
 	dfile[sizeof(dfile) - 1] = '\0';
 
-	return read_sysfs_file_stat_work(dfile, d->dev_stats[curr]);
+	return read_sysfs_file_stat_work(dfile, d->dev_stats[curr], &(d->stat_fd[fdi]));
 }
 
 /*
@@ -732,12 +850,12 @@ int read_sysfs_part_stat(int curr, struct io_device *d)
 
 	if (!alt_dir[0] || USE_ALL_DIR(flags)) {
 		/* Read partition stats from /sys */
-		rc = read_sysfs_part_stat_work(curr, d, SLASH_SYS);
+		rc = read_sysfs_part_stat_work(curr, d, SLASH_SYS, SYS_FD);
 	}
 
 	if (alt_dir[0] && (!USE_ALL_DIR(flags) || (USE_ALL_DIR(flags) && (rc < 0)))) {
 		/* Read partition stats from an alternate /sys directory */
-		rc = read_sysfs_part_stat_work(curr, d, alt_dir);
+		rc = read_sysfs_part_stat_work(curr, d, alt_dir, ALT_FD);
 	}
 
 	return rc;
@@ -773,7 +891,8 @@ void read_sysfs_dlist_stat(int curr)
 
 		else if ((dlist->dev_tp == T_PART_DEV) || (dlist->dev_tp == T_DEV)) {
 			/* Read stats for current whole device using /sys/block/ directory */
-			if (read_sysfs_file_stat(dlist->name, dlist->dev_stats[curr]) == 0) {
+			if (read_sysfs_file_stat(dlist->name, dlist->dev_stats[curr],
+						 dlist->stat_fd) == 0) {
 				dlist->exist = TRUE;
 			}
 
@@ -2108,6 +2227,7 @@ int main(int argc, char **argv)
 #endif
 
 	alt_dir[0] = '\0';
+	init_stat_fd_max();
 
 	/* Process args... */
 	while (opt < argc) {
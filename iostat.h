@@ -126,10 +126,31 @@ struct io_device {
 	/* major and minor numbers (not set for T_GROUP "devices") */
 	int major;
 	int minor;
+	/*
+	 * Descriptors kept open on the stat file of the device, or -1:
+	 * [SYS_FD] for the file in /sys, [ALT_FD] for the file in the
+	 * alternate directory entered with --alt-dir.
+	 */
+	int stat_fd[2];
 	struct io_stats *dev_stats[2];
 	struct io_device *next;
+	/* Next device in the same bucket of the hash table */
+	struct io_device *hnext;
 };
 
+/* Number of buckets of the hash table used to find devices by name */
+#define DEV_HASH_SIZE	1024
+
+/* Index in stat_fd[] array of io_device structure */
+#define SYS_FD	0
+#define ALT_FD	1
+
+/*
+ * Number of descriptors left available for other files when computing
+ * the max number of stat file descriptors kept open from RLIMIT_NOFILE.
+ */
+#define STAT_FD_RESERVE	64
+
 struct ext_io_stats {
 	/* r_await */
 	double r_await;
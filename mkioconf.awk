@@ -0,0 +1,226 @@
+#
+# mkioconf.awk: Generate the built-in ioconf table (ioconf_tab.h) from
+# sysstat.ioconf configuration file.
+# (C) 2024 by Sebastien GODARD (sysstat <at> orange.fr)
+#
+# Records are interpreted exactly as ioc_init() (in ioconf.c) would do at
+# runtime, so that the generated table and the parsed file give the same
+# device names.
+#
+# Usage: awk -f mkioconf.awk sysstat.ioconf > ioconf_tab.h
+#
+
+function is_uint(s)
+{
+	return (s ~ /^[0-9]+$/)
+}
+
+# Equivalent of sscanf "%s": first whitespace delimited word, truncated
+function first_word(s, len)
+{
+	sub(/^[ \t]+/, "", s)
+	sub(/[ \t\r].*$/, "", s)
+	return substr(s, 1, len)
+}
+
+# Remove the first @n colon separated fields from @s
+function skip_fields(s, n,	i)
+{
+	for (i = 0; i < n; i++) {
+		s = substr(s, index(s, ":") + 1)
+	}
+	return s
+}
+
+function cstr(s)
+{
+	gsub(/\\/, "\\\\", s)
+	gsub(/"/, "\\\"", s)
+	return "\"" s "\""
+}
+
+BEGIN {
+	FS = ":"
+	# Must be consistent with MAX_BLKDEV in ioconf.h
+	if (max_blkdev == "")
+		max_blkdev = 511
+	blk_nr = 0
+	ent_nr = 0
+	count = 0
+}
+
+/^#/ || /^$/ {
+	next
+}
+
+{
+	line = $0
+	sub(/\r$/, "", line)
+}
+
+# Indirect record: major:indirect:ctrlno[:desc]
+NF >= 3 && is_uint($1) && is_uint($2) && is_uint($3) {
+	major = $1 + 0
+	indirect = $2 + 0
+
+	if (indirect == 0)
+		# Conventional usage for unsupported device
+		next
+	if (indirect > max_blkdev) {
+		printf("%s: Indirect major #%u out of range\n", FILENAME, indirect) > "/dev/stderr"
+		next
+	}
+	if (major > max_blkdev) {
+		printf("%s: Major #%u out of range\n", FILENAME, major) > "/dev/stderr"
+		next
+	}
+	if (!(indirect in ioconf)) {
+		printf("%s: Indirect record '%u:%u:%u:...' references not yet seen major %u\n",
+		       FILENAME, major, indirect, $3, major) > "/dev/stderr"
+		next
+	}
+
+	desc = ""
+	if (NF >= 4) {
+		desc = first_word(skip_fields(line, 3), 63)
+	}
+
+	e = ent_nr++
+	ent_live[e] = 0
+	ent_ctrlno[e] = $3 + 0
+	ent_base[e] = indirect
+	ent_blk[e] = ent_blk[ioconf[indirect]]
+	# Use description of the referent if none is given
+	ent_desc[e] = (desc == "") ? "ioc_builtin_blk[" ent_blk[e] "].desc" : cstr(desc)
+	refnr[indirect]++
+	ioconf[major] = e
+	next
+}
+
+# Full record: major:name:cfmt:ctrlno:dfmt:dcount:pfmt:pcount:desc
+{
+	if ((NF < 9) || !is_uint($1) || ($2 == "") || ($3 == "") || !is_uint($4) ||
+	    ($5 == "") || !is_uint($6) || ($7 == "") || !is_uint($8) ||
+	    (first_word($9, 63) == "")) {
+		printf("%s: Malformed record: %s\n", FILENAME, line) > "/dev/stderr"
+		next
+	}
+
+	major = $1 + 0
+	if ((major == 0) || (major >= max_blkdev)) {
+		printf("%s: major #%u out of range\n", FILENAME, major) > "/dev/stderr"
+		next
+	}
+
+	desc = first_word(skip_fields(line, 8), 63)
+
+	if (substr($3, 1, 1) == "x") {
+		# Exception record: Decorate the base major with it
+		if (!(major in ioconf)) {
+			printf("%s: type 'x' record for major #%u must follow the base record - ignored\n",
+			       FILENAME, major) > "/dev/stderr"
+			next
+		}
+		b = ent_blk[ioconf[major]]
+		if (blk_ext[b]) {
+			printf("%s: duplicate 'x' record for major #%u - ignored\n",
+			       FILENAME, major) > "/dev/stderr"
+			next
+		}
+		blk_ext[b] = 1
+		blk_ext_minor[b] = $4 + 0
+		blk_ext_name[b] = substr($2, 1, 31)
+		next
+	}
+
+	b = blk_nr++
+	blk_name[b] = $2
+	if (substr($3, 1, 1) == "*") {
+		blk_cfmt[b] = $2
+		blk_ctrl_explicit[b] = 0
+	}
+	else {
+		blk_cfmt[b] = $2 $3 "%d"
+		blk_ctrl_explicit[b] = 1
+	}
+
+	c = substr($5, 1, 1)
+	if (c == "a") {
+		blk_cconv[b] = "ioc_ito26"
+		blk_dfmt[b] = "%s"
+	}
+	else if ((c == "%") || (c == "d")) {
+		blk_cconv[b] = "ioc_ito10"
+		blk_dfmt[b] = ((c == "%") ? substr($5, 2, 15) : "") "%s"
+	}
+	else {
+		blk_cconv[b] = "NULL"
+		blk_dfmt[b] = ""
+	}
+
+	blk_pfmt[b] = ((substr($7, 1, 1) == "*") ? "" : $7) "%d"
+	blk_dcount[b] = $6 + 0
+	blk_pcount[b] = $8 + 0
+	blk_desc[b] = desc
+	blk_ext[b] = 0
+
+	e = ent_nr++
+	ent_live[e] = 1
+	ent_ctrlno[e] = $4 + 0
+	ent_base[e] = major
+	ent_blk[e] = b
+	ent_desc[e] = "NULL"
+	ioconf[major] = e
+	count++
+}
+
+END {
+	print "/*"
+	print " * ioconf_tab.h: Built-in ioconf table."
+	print " * Generated from " FILENAME " by mkioconf.awk. Do not edit."
+	print " */"
+	print ""
+
+	print "#define IOC_BUILTIN_NR\t" count
+	print ""
+
+	print "static struct blk_config ioc_builtin_blk[] = {"
+	for (b = 0; b < blk_nr; b++) {
+		printf("\t{.name = %s, .cfmt = %s, .dfmt = %s, .pfmt = %s,\n",
+		       cstr(blk_name[b]), cstr(blk_cfmt[b]), cstr(blk_dfmt[b]), cstr(blk_pfmt[b]))
+		printf("\t .ctrl_explicit = %u, .dcount = %u, .pcount = %u, .desc = %s, .cconv = %s",
+		       blk_ctrl_explicit[b], blk_dcount[b], blk_pcount[b], cstr(blk_desc[b]), blk_cconv[b])
+		if (blk_ext[b]) {
+			printf(",\n\t .ext_name = %s, .ext = 1, .ext_minor = %u",
+			       cstr(blk_ext_name[b]), blk_ext_minor[b])
+		}
+		print "},"
+	}
+	print "};"
+	print ""
+
+	print "static struct ioc_entry ioc_builtin_ent[] = {"
+	for (e = 0; e < ent_nr; e++) {
+		printf("\t{.live = %u, .ctrlno = %u, .basemajor = %u, .desc = %s, .blkp = &ioc_builtin_blk[%u]},\n",
+		       ent_live[e], ent_ctrlno[e], ent_base[e], ent_desc[e], ent_blk[e])
+	}
+	print "};"
+	print ""
+
+	print "static struct ioc_entry *ioc_builtin[MAX_BLKDEV + 1] = {"
+	for (m = 0; m <= max_blkdev; m++) {
+		if (m in ioconf) {
+			printf("\t[%u] = &ioc_builtin_ent[%u],\n", m, ioconf[m])
+		}
+	}
+	print "};"
+	print ""
+
+	print "static unsigned int ioc_builtin_refnr[MAX_BLKDEV + 1] = {"
+	for (m = 0; m <= max_blkdev; m++) {
+		if (m in refnr) {
+			printf("\t[%u] = %u,\n", m, refnr[m])
+		}
+	}
+	print "};"
+}
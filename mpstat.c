@@ -28,6 +28,7 @@
 #include <errno.h>
 #include <dirent.h>
 #include <ctype.h>
+#include <stdint.h>
 #include <sys/utsname.h>
 
 #include "version.h"
@@ -61,6 +62,13 @@ unsigned char *node_bitmap = NULL;	/* Bit 0: Global; Bit 1: 1st NUMA node; etc.
 struct stats_cpu *st_cpu[3] = {NULL, NULL, NULL};
 struct stats_cpu *st_node[3] = {NULL, NULL, NULL};
 
+/*
+ * CPU utilization percentages (CPU_PCT_NR values per CPU, including CPU "all")
+ * and interval for each CPU, computed from current and previous samples.
+ */
+double *st_cpu_pct = NULL;
+unsigned long long *st_cpu_itv = NULL;
+
 /*
  * Structure used to save total number of interrupts received
  * among all CPU and for each CPU.
@@ -71,8 +79,8 @@ struct stats_global_irq *st_irq[3] = {NULL, NULL, NULL};
  * Structures used to save, for each interrupt, the number
  * received by each CPU.
  */
-struct stats_irqcpu *st_irqcpu[3] = {NULL, NULL, NULL};
-struct stats_irqcpu *st_softirqcpu[3] = {NULL, NULL, NULL};
+struct stats_irqcpu st_irqcpu[3];
+struct stats_irqcpu st_softirqcpu[3];
 
 /*
  * Number of CPU per node, e.g.:
@@ -88,6 +96,17 @@ int *cpu_per_node = NULL;
  */
 int *cpu2node = NULL;
 
+/*
+ * CPU numbers grouped by node (node_cpu_list), and position in this list
+ * of the first CPU of each node (node_cpu_start), e.g.:
+ * node_cpu_start[0]: CPU belonging to no node
+ * node_cpu_start[1]: CPU belonging to node 0
+ * etc. CPU of node N are node_cpu_list[node_cpu_start[N + 1]] to
+ * node_cpu_list[node_cpu_start[N + 2] - 1].
+ */
+int *node_cpu_start = NULL;
+int *node_cpu_list = NULL;
+
 /* CPU topology */
 struct cpu_topology *st_cpu_topology = NULL;
 
@@ -122,6 +141,10 @@ int irqcpu_nr = 0;
 /* Nb of soft interrupts per processor */
 int softirqcpu_nr = 0;
 
+/* Buffers used to read /proc/interrupts and /proc/softirqs files */
+struct file_buf irq_fb = {.fd = -1};
+struct file_buf softirq_fb = {.fd = -1};
+
 struct sigaction alrm_act, int_act;
 int sigint_caught = 0;
 
@@ -193,17 +216,24 @@ void salloc_mp_struct(int nr_cpus, int pos)
 		SREALLOC(st_cpu[i], struct stats_cpu, STATS_CPU_SIZE * nr_cpus);
 		SREALLOC(st_node[i], struct stats_cpu, STATS_CPU_SIZE * nr_cpus);
 		SREALLOC(st_irq[i], struct stats_global_irq, STATS_GLOBAL_IRQ_SIZE * nr_cpus);
-		SREALLOC(st_irqcpu[i], struct stats_irqcpu,
-			 STATS_IRQCPU_SIZE * nr_cpus * irqcpu_nr);
-		SREALLOC(st_softirqcpu[i], struct stats_irqcpu,
-			 STATS_IRQCPU_SIZE * nr_cpus * softirqcpu_nr);
+		SREALLOC(st_irqcpu[i].interrupt, unsigned int,
+			 sizeof(unsigned int) * nr_cpus * irqcpu_nr);
+		SREALLOC(st_irqcpu[i].irq_name, char, MAX_IRQ_LEN * irqcpu_nr);
+		SREALLOC(st_softirqcpu[i].interrupt, unsigned int,
+			 sizeof(unsigned int) * nr_cpus * softirqcpu_nr);
+		SREALLOC(st_softirqcpu[i].irq_name, char, MAX_IRQ_LEN * softirqcpu_nr);
 	}
 
 	SREALLOC(cpu_bitmap, unsigned char, (nr_cpus >> 3) + 1);
 	SREALLOC(node_bitmap, unsigned char, (nr_cpus >> 3) + 1);
 
+	SREALLOC(st_cpu_pct, double, sizeof(double) * CPU_PCT_NR * nr_cpus);
+	SREALLOC(st_cpu_itv, unsigned long long, sizeof(unsigned long long) * nr_cpus);
+
 	SREALLOC(cpu_per_node, int, sizeof(int) * nr_cpus);
 	SREALLOC(cpu2node, int, sizeof(int) * nr_cpus);
+	SREALLOC(node_cpu_start, int, sizeof(int) * (nr_cpus + 2));
+	SREALLOC(node_cpu_list, int, sizeof(int) * nr_cpus);
 	SREALLOC(st_cpu_topology, struct cpu_topology, sizeof(struct cpu_topology) * nr_cpus);
 
 	if (pos) {
@@ -212,8 +242,10 @@ void salloc_mp_struct(int nr_cpus, int pos)
 			memset(st_cpu[i] + pos, 0, STATS_CPU_SIZE * (nr_cpus - pos));
 			memset(st_node[i] + pos, 0, STATS_CPU_SIZE * (nr_cpus - pos));
 			memset(st_irq[i] + pos, 0, STATS_GLOBAL_IRQ_SIZE * (nr_cpus - pos));
-			memset(st_irqcpu[i] + pos, 0, STATS_IRQCPU_SIZE * (nr_cpus - pos) * irqcpu_nr);
-			memset(st_softirqcpu[i] + pos, 0, STATS_IRQCPU_SIZE * (nr_cpus - pos) * softirqcpu_nr);
+			memset(IRQ_CPU(st_irqcpu[i], pos, irqcpu_nr), 0,
+			       sizeof(unsigned int) * (nr_cpus - pos) * irqcpu_nr);
+			memset(IRQ_CPU(st_softirqcpu[i], pos, softirqcpu_nr), 0,
+			       sizeof(unsigned int) * (nr_cpus - pos) * softirqcpu_nr);
 		}
 	}
 	else {
@@ -235,14 +267,20 @@ void sfree_mp_struct(void)
 		free(st_cpu[i]);
 		free(st_node[i]);
 		free(st_irq[i]);
-		free(st_irqcpu[i]);
-		free(st_softirqcpu[i]);
+		free(st_irqcpu[i].interrupt);
+		free(st_irqcpu[i].irq_name);
+		free(st_softirqcpu[i].interrupt);
+		free(st_softirqcpu[i].irq_name);
 	}
 
+	free(st_cpu_pct);
+	free(st_cpu_itv);
 	free(cpu_bitmap);
 	free(node_bitmap);
 	free(cpu_per_node);
 	free(cpu2node);
+	free(node_cpu_start);
+	free(node_cpu_list);
 }
 
 /*
@@ -257,26 +295,156 @@ void sfree_mp_struct(void)
  * @curr	Position in array where current statistics will be saved.
  **************************************************************************
  */
-void fwd_irq_values(struct stats_irqcpu *st_ic[], unsigned int c,
+void fwd_irq_values(struct stats_irqcpu st_ic[], unsigned int c,
 		    unsigned int last, int ic_nr, int curr)
 {
-	struct stats_global_irq *st_irq_i, *st_irq_j;
-	struct stats_irqcpu *p, *q;
-	int j;
+	if (c >= last)
+		return;
 
-	while (c < last) {
+	/* Counters of consecutive CPU are contiguous */
+	memcpy(st_irq[curr] + c + 1, st_irq[!curr] + c + 1,
+	       STATS_GLOBAL_IRQ_SIZE * (last - c));
+	memcpy(IRQ_CPU(st_ic[curr], c, ic_nr), IRQ_CPU(st_ic[!curr], c, ic_nr),
+	       sizeof(unsigned int) * ic_nr * (last - c));
+}
 
-		st_irq_i = st_irq[curr] + c + 1;
-		st_irq_j = st_irq[!curr] + c + 1;
-		st_irq_i->irq_nr = st_irq_j->irq_nr;
+/*
+ ***************************************************************************
+ * Get node placement from the list of CPU of each node, as given by
+ * /sys/devices/system/node/node{N}/cpulist files. This is much faster than
+ * looking for the node link in the directory of every CPU on machines
+ * with many CPU.
+ *
+ * IN:
+ * @nr_cpus		Number of CPU on this machine.
+ *
+ * OUT:
+ * @cpu_per_node	Number of CPU per node.
+ * @cpu2node		The node the CPU belongs to.
+ *
+ * RETURNS:
+ * Highest node number found (e.g., 0 means node 0), -1 if no nodes have
+ * been found, or -2 if node directories cannot be read (node placement
+ * should then be read from each CPU directory).
+ ***************************************************************************
+ */
+int get_node_placement_from_cpulist(int nr_cpus, int cpu_per_node[], int cpu2node[])
+{
+	DIR *dir;
+	FILE *fp;
+	struct dirent *drd;
+	char filename[MAX_PF_NAME], line[8192], *cp;
+	int node, first, last, cpu, hi_node_nr = -1;
 
-		for (j = 0; j < ic_nr; j++) {
-			p = st_ic[curr] + c * ic_nr + j;
-			q = st_ic[!curr] + c * ic_nr + j;
-			p->interrupt = q->interrupt;
+	if ((dir = opendir(SYSFS_DEVNODE)) == NULL)
+		return -2;
+
+	while ((drd = readdir(dir)) != NULL) {
+
+		if (strncmp(drd->d_name, "node", 4) || !isdigit(drd->d_name[4]))
+			continue;
+
+		node = atoi(drd->d_name + 4);
+		if ((node >= nr_cpus) || (node < 0))
+			/*
+			 * Node number too high to have CPU (e.g. memory-only
+			 * node): Ignore it and keep the placement of other nodes.
+			 */
+			continue;
+
+		snprintf(filename, sizeof(filename), "%s/%s/%s",
+			 SYSFS_DEVNODE, drd->d_name, NODE_CPULIST);
+		filename[sizeof(filename) - 1] = '\0';
+
+		if ((fp = fopen(filename, "r")) == NULL) {
+			closedir(dir);
+			return -2;
+		}
+		if (fgets(line, sizeof(line), fp) == NULL) {
+			line[0] = '\0';
+		}
+		fclose(fp);
+
+		if (strlen(line) == sizeof(line) - 1) {
+			/* List truncated */
+			closedir(dir);
+			return -2;
+		}
+
+		/* List format is e.g. "0-3,8-11" */
+		for (cp = line; isdigit(*cp); ) {
+			first = last = strtol(cp, &cp, 10);
+			if (*cp == '-') {
+				last = strtol(cp + 1, &cp, 10);
+			}
+			for (cpu = first; (cpu <= last) && (cpu < nr_cpus); cpu++) {
+				if (cpu2node[cpu] >= 0)
+					/* A CPU cannot belong to several nodes */
+					continue;
+				cpu_per_node[node + 1]++;
+				cpu2node[cpu] = node;
+			}
+			if (*cp == ',') {
+				cp++;
+			}
+		}
+
+		if (node > hi_node_nr) {
+			hi_node_nr = node;
+		}
+	}
+
+	closedir(dir);
+
+	return hi_node_nr;
+}
+
+/*
+ ***************************************************************************
+ * Get the node a CPU belongs to, using the node link in the directory of
+ * the CPU (e.g. /sys/devices/system/cpu/cpu0/node0).
+ *
+ * IN:
+ * @nr_cpus	Number of CPU on this machine.
+ * @cpu		CPU number.
+ *
+ * RETURNS:
+ * Node number, -1 if the CPU belongs to no node, or -2 if the directory of
+ * the CPU cannot be read or if the node number is not valid.
+ ***************************************************************************
+ */
+int get_cpu_node_from_link(int nr_cpus, int cpu)
+{
+	DIR *dir;
+	struct dirent *drd;
+	char line[MAX_PF_NAME];
+	int node = -1;
+
+	snprintf(line, sizeof(line), "%s/cpu%d", SYSFS_DEVCPU, cpu);
+	line[sizeof(line) - 1] = '\0';
+
+	/* Open relevant /sys directory */
+	if ((dir = opendir(line)) == NULL)
+		return -2;
+
+	/* Get current file entry */
+	while ((drd = readdir(dir)) != NULL) {
+
+		if (!strncmp(drd->d_name, "node", 4) && isdigit(drd->d_name[4])) {
+			node = atoi(drd->d_name + 4);
+			if ((node >= nr_cpus) || (node < 0)) {
+				/* Assume we cannot have more nodes than CPU */
+				node = -2;
+			}
+			/* Node placement found for current CPU */
+			break;
 		}
-		c++;
 	}
+
+	/* Close directory */
+	closedir(dir);
+
+	return node;
 }
 
 /*
@@ -299,9 +467,6 @@ void fwd_irq_values(struct stats_irqcpu *st_ic[], unsigned int c,
 int get_node_placement(int nr_cpus, int cpu_per_node[], int cpu2node[])
 
 {
-	DIR *dir;
-	struct dirent *drd;
-	char line[MAX_PF_NAME];
 	int cpu, node, hi_node_nr = -1;
 
 	/* Init number of CPU per node */
@@ -312,41 +477,130 @@ int get_node_placement(int nr_cpus, int cpu_per_node[], int cpu2node[])
 	/* This is node "all" */
 	cpu_per_node[0] = nr_cpus;
 
-	for (cpu = 0; cpu < nr_cpus; cpu++) {
-		snprintf(line, sizeof(line), "%s/cpu%d", SYSFS_DEVCPU, cpu);
-		line[sizeof(line) - 1] = '\0';
-
-		/* Open relevant /sys directory */
-		if ((dir = opendir(line)) == NULL)
-			return -1;
-
-		/* Get current file entry */
-		while ((drd = readdir(dir)) != NULL) {
+	if ((hi_node_nr = get_node_placement_from_cpulist(nr_cpus, cpu_per_node,
+							  cpu2node)) > -2) {
+		if (hi_node_nr < 0)
+			return hi_node_nr;
 
-			if (!strncmp(drd->d_name, "node", 4) && isdigit(drd->d_name[4])) {
-				node = atoi(drd->d_name + 4);
-				if ((node >= nr_cpus) || (node < 0)) {
-					/* Assume we cannot have more nodes than CPU */
-					closedir(dir);
-					return -1;
-				}
-				cpu_per_node[node + 1]++;
-				cpu2node[cpu] = node;
-				if (node > hi_node_nr) {
-					hi_node_nr = node;
-				}
-				/* Node placement found for current CPU: Go to next CPU directory */
-				break;
+		/*
+		 * Offline CPU are not listed in nodes cpulist files:
+		 * Look for the node link in their directory instead.
+		 */
+		for (cpu = 0; cpu < nr_cpus; cpu++) {
+			if ((cpu2node[cpu] >= 0) ||
+			    ((node = get_cpu_node_from_link(nr_cpus, cpu)) < 0))
+				continue;
+			cpu_per_node[node + 1]++;
+			cpu2node[cpu] = node;
+			if (node > hi_node_nr) {
+				hi_node_nr = node;
 			}
 		}
+		return hi_node_nr;
+	}
+
+	/* Node directories not available: Look for node link in each CPU directory */
+	memset(cpu_per_node + 1, 0, sizeof(int) * nr_cpus);
+	memset(cpu2node, -1, sizeof(int) * nr_cpus);
+	hi_node_nr = -1;
 
-		/* Close directory */
-		closedir(dir);
+	for (cpu = 0; cpu < nr_cpus; cpu++) {
+		if ((node = get_cpu_node_from_link(nr_cpus, cpu)) == -2)
+			return -1;
+		if (node < 0)
+			/* CPU belongs to no node */
+			continue;
+
+		cpu_per_node[node + 1]++;
+		cpu2node[cpu] = node;
+		if (node > hi_node_nr) {
+			hi_node_nr = node;
+		}
 	}
 
 	return hi_node_nr;
 }
 
+/*
+ ***************************************************************************
+ * Group CPU by node, so that CPU belonging to a given node can be found
+ * without scanning the whole list of CPU.
+ *
+ * IN:
+ * @nr_cpus		Number of CPU on this machine.
+ * @cpu2node		The node the CPU belongs to (see get_node_placement()).
+ *
+ * OUT:
+ * @node_cpu_start	Position in @node_cpu_list of the first CPU of each
+ *			node. Entry 0 is for CPU belonging to no node, entry 1
+ *			for node 0, etc. An extra entry marks the end of the
+ *			list of the last node.
+ * @node_cpu_list	CPU numbers, grouped by node.
+ ***************************************************************************
+ */
+void set_node_cpu_list(int nr_cpus, int cpu2node[], int node_cpu_start[],
+		       int node_cpu_list[])
+{
+	int cpu, i;
+
+	/*
+	 * Count CPU per node (CPU of node N are counted in entry N + 3,
+	 * N being -1 for CPU belonging to no node)...
+	 */
+	memset(node_cpu_start, 0, sizeof(int) * (nr_cpus + 3));
+	for (cpu = 0; cpu < nr_cpus; cpu++) {
+		node_cpu_start[cpu2node[cpu] + 3]++;
+	}
+	/* ...so that entry N + 2 now gives the start of the list of node N... */
+	for (i = 1; i < nr_cpus + 3; i++) {
+		node_cpu_start[i] += node_cpu_start[i - 1];
+	}
+	/* ...and then the start of the list of node N + 1 once lists are filled */
+	for (cpu = 0; cpu < nr_cpus; cpu++) {
+		node_cpu_list[node_cpu_start[cpu2node[cpu] + 2]++] = cpu;
+	}
+}
+
+/*
+ ***************************************************************************
+ * Check if the set of online CPU has changed since last call. This is used
+ * to know if system topology has to be read again.
+ *
+ * IN:
+ * @nr_cpus	Number of CPU on this machine.
+ *
+ * RETURNS:
+ * TRUE if the set of online CPU (or the number of CPU) has changed, or
+ * if it cannot be known.
+ ***************************************************************************
+ */
+int cpu_online_changed(int nr_cpus)
+{
+	static char online[4096];
+	static int online_cpu_nr = -1;
+	char line[sizeof(online)];
+	FILE *fp;
+	size_t len;
+
+	if ((fp = fopen(CPU_ONLINE, "r")) == NULL)
+		return TRUE;
+	len = fread(line, 1, sizeof(line) - 1, fp);
+	fclose(fp);
+
+	if (!len || (len == sizeof(line) - 1))
+		/* Empty or possibly truncated list */
+		return TRUE;
+	line[len] = '\0';
+
+	if ((nr_cpus == online_cpu_nr) && !strcmp(line, online))
+		return FALSE;
+
+	strcpy(online, line);
+	online_cpu_nr = nr_cpus;
+
+	return TRUE;
+}
+
 /*
  ***************************************************************************
  * Read system logical topology: Socket number for each logical core is read
@@ -355,6 +609,7 @@ int get_node_placement(int nr_cpus, int cpu_per_node[], int cpu2node[])
  * /sys/devices/system/cpu/cpu{N}/topology/thread_siblings_list file.
  * Don't use /sys/devices/system/cpu/cpu{N}/topology/core_id as this is the
  * physical core id (seems to be different from the number displayed by lscpu).
+ * Topology is read again only when a CPU has gone online or offline.
  *
  * IN:
  * @nr_cpus	Number of CPU on this machine.
@@ -371,6 +626,10 @@ void read_topology(int nr_cpus, struct cpu_topology *cpu_topo)
 	char filename[MAX_PF_NAME];
 	int cpu, rc;
 
+	if (!cpu_online_changed(nr_cpus))
+		/* Topology is still the same */
+		return;
+
 	/* Init system topology */
 	memset(st_cpu_topology, 0, sizeof(struct cpu_topology) * nr_cpus);
 
@@ -445,7 +704,7 @@ void add_cpu_stats(struct stats_cpu *dest, struct stats_cpu *src)
  */
 void set_node_cpu_stats(int prev, int curr)
 {
-	int cpu;
+	int cpu, node, i;
 	unsigned long long tot_jiffies_p;
 	struct stats_cpu *scp, *scc, *snp, *snc;
 	struct stats_cpu *scc_all = st_cpu[curr];
@@ -461,27 +720,34 @@ void set_node_cpu_stats(int prev, int curr)
 	*snp_all = *scp_all;
 	*snc_all = *scc_all;
 
-	/* Individual nodes */
-	for (cpu = 0; cpu < cpu_nr; cpu++) {
-		scc = st_cpu[curr] + cpu + 1;
-		scp = st_cpu[prev] + cpu + 1;
-		snp = st_node[prev] + cpu2node[cpu] + 1;
-		snc = st_node[curr] + cpu2node[cpu] + 1;
+	/*
+	 * Individual nodes.
+	 * NB: Entry 0 is for CPU belonging to no node. Their stats are added
+	 * to node "all".
+	 */
+	for (node = 0; node <= node_nr + 1; node++) {
+		snp = st_node[prev] + node;
+		snc = st_node[curr] + node;
 
+		for (i = node_cpu_start[node]; i < node_cpu_start[node + 1]; i++) {
+			cpu = node_cpu_list[i];
+			scc = st_cpu[curr] + cpu + 1;
+			scp = st_cpu[prev] + cpu + 1;
 
-		tot_jiffies_p = scp->cpu_user + scp->cpu_nice +
-				scp->cpu_sys + scp->cpu_idle +
-				scp->cpu_iowait + scp->cpu_hardirq +
-				scp->cpu_steal + scp->cpu_softirq;
-		if ((tot_jiffies_p == 0) && (interval != 0))
-			/*
-			 * CPU has just come back online with no ref from
-			 * previous iteration: Skip it.
-			 */
-			continue;
+			tot_jiffies_p = scp->cpu_user + scp->cpu_nice +
+					scp->cpu_sys + scp->cpu_idle +
+					scp->cpu_iowait + scp->cpu_hardirq +
+					scp->cpu_steal + scp->cpu_softirq;
+			if ((tot_jiffies_p == 0) && (interval != 0))
+				/*
+				 * CPU has just come back online with no ref from
+				 * previous iteration: Skip it.
+				 */
+				continue;
 
-		add_cpu_stats(snp, scp);
-		add_cpu_stats(snc, scc);
+			add_cpu_stats(snp, scp);
+			add_cpu_stats(snc, scc);
+		}
 	}
 }
 
@@ -605,15 +871,11 @@ unsigned long long get_global_cpu_mpstats(int prev, int curr,
 /*
  ***************************************************************************
  * Display CPU statistics in plain format.
+ * CPU utilization percentages have already been computed for every CPU
+ * to display (see write_cpu_stats()).
  *
  * IN:
  * @dis		TRUE if a header line must be printed.
- * @deltot_jiffies
- *		Number of jiffies spent on the interval by all processors.
- * @prev	Position in array where statistics used	as reference are.
- *		Stats used as reference may be the previous ones read, or
- *		the very first ones when calculating the average.
- * @curr	Position in array where current statistics will be saved.
  * @prev_string	String displayed at the beginning of a header line. This is
  * 		the timestamp of the previous sample, or "Average" when
  * 		displaying average stats.
@@ -624,12 +886,11 @@ unsigned long long get_global_cpu_mpstats(int prev, int curr,
  *		CPU bitmap for offline CPU.
  ***************************************************************************
  */
-void write_plain_cpu_stats(int dis, unsigned long long deltot_jiffies, int prev, int curr,
-			   char *prev_string, char *curr_string,
+void write_plain_cpu_stats(int dis, char *prev_string, char *curr_string,
 			   const unsigned char offline_cpu_bitmap[])
 {
 	int i;
-	struct stats_cpu *scc, *scp;
+	double *pct;
 	struct cpu_topology *cpu_topo_i;
 
 	if (dis) {
@@ -652,8 +913,7 @@ void write_plain_cpu_stats(int dis, unsigned long long deltot_jiffies, int prev,
 		    IS_CPU_OFFLINE(offline_cpu_bitmap, i))
 			continue;
 
-		scc = st_cpu[curr] + i;
-		scp = st_cpu[prev] + i;
+		pct = st_cpu_pct + i * CPU_PCT_NR;
 
 		printf("%-11s", curr_string);
 
@@ -675,14 +935,8 @@ void write_plain_cpu_stats(int dis, unsigned long long deltot_jiffies, int prev,
 				cprintf_in(IS_INT, " %4d", "", cpu2node[i - 1]);
 			}
 
-			/* Recalculate itv for current proc */
-			deltot_jiffies = get_per_cpu_interval(scc, scp);
-
-			if (!deltot_jiffies) {
-				/*
-				 * If the CPU is tickless then there is no change in CPU values
-				 * but the sum of values is not zero.
-				 */
+			if (!st_cpu_itv[i]) {
+				/* CPU is tickless */
 				cprintf_xpc(NO_UNIT, FALSE, 10, 7, 2,
 					   0.0, 0.0, 0.0, 0.0, 0.0, 0.0, 0.0, 0.0, 0.0, 100.0);
 				printf("\n");
@@ -692,33 +946,10 @@ void write_plain_cpu_stats(int dis, unsigned long long deltot_jiffies, int prev,
 		}
 
 		cprintf_xpc(NO_UNIT, XHIGH, 9, 7, 2,
-			   (scc->cpu_user - scc->cpu_guest) < (scp->cpu_user - scp->cpu_guest) ?
-			   0.0 :
-			   ll_sp_value(scp->cpu_user - scp->cpu_guest,
-				       scc->cpu_user - scc->cpu_guest, deltot_jiffies),
-			   (scc->cpu_nice - scc->cpu_guest_nice) < (scp->cpu_nice - scp->cpu_guest_nice) ?
-			   0.0 :
-			   ll_sp_value(scp->cpu_nice - scp->cpu_guest_nice,
-				       scc->cpu_nice - scc->cpu_guest_nice, deltot_jiffies),
-			   ll_sp_value(scp->cpu_sys,
-				       scc->cpu_sys, deltot_jiffies),
-			   ll_sp_value(scp->cpu_iowait,
-				       scc->cpu_iowait, deltot_jiffies),
-			   ll_sp_value(scp->cpu_hardirq,
-				       scc->cpu_hardirq, deltot_jiffies),
-			   ll_sp_value(scp->cpu_softirq,
-				       scc->cpu_softirq, deltot_jiffies),
-			   ll_sp_value(scp->cpu_steal,
-				       scc->cpu_steal, deltot_jiffies),
-			   ll_sp_value(scp->cpu_guest,
-				       scc->cpu_guest, deltot_jiffies),
-			   ll_sp_value(scp->cpu_guest_nice,
-				       scc->cpu_guest_nice, deltot_jiffies));
-		cprintf_xpc(NO_UNIT, XLOW, 1, 7, 2,
-			    (scc->cpu_idle < scp->cpu_idle) ?
-			    0.0 :
-			    ll_sp_value(scp->cpu_idle,
-					scc->cpu_idle, deltot_jiffies));
+			    pct[CPU_PCT_USR], pct[CPU_PCT_NICE], pct[CPU_PCT_SYS],
+			    pct[CPU_PCT_IOWAIT], pct[CPU_PCT_IRQ], pct[CPU_PCT_SOFT],
+			    pct[CPU_PCT_STEAL], pct[CPU_PCT_GUEST], pct[CPU_PCT_GNICE]);
+		cprintf_xpc(NO_UNIT, XLOW, 1, 7, 2, pct[CPU_PCT_IDLE]);
 		printf("\n");
 	}
 }
@@ -726,25 +957,20 @@ void write_plain_cpu_stats(int dis, unsigned long long deltot_jiffies, int prev,
 /*
  ***************************************************************************
  * Display CPU statistics in JSON format.
+ * CPU utilization percentages have already been computed for every CPU
+ * to display (see write_cpu_stats()).
  *
  * IN:
  * @tab		Number of tabs to print.
- * @deltot_jiffies
- *		Number of jiffies spent on the interval by all processors.
- * @prev	Position in array where statistics used	as reference are.
- *		Stats used as reference may be the previous ones read, or
- *		the very first ones when calculating the average.
- * @curr	Position in array where current statistics will be saved.
  * @offline_cpu_bitmap
  *		CPU bitmap for offline CPU.
  ***************************************************************************
  */
-void write_json_cpu_stats(int tab, unsigned long long deltot_jiffies, int prev, int curr,
-			  const unsigned char offline_cpu_bitmap[])
+void write_json_cpu_stats(int tab, const unsigned char offline_cpu_bitmap[])
 {
 	int i, next = FALSE;
 	char cpu_name[16], topology[1024] = "";
-	struct stats_cpu *scc, *scp;
+	double *pct;
 	struct cpu_topology *cpu_topo_i;
 
 	xprintf(tab++, "\"cpu-load\": [");
@@ -760,8 +986,7 @@ void write_json_cpu_stats(int tab, unsigned long long deltot_jiffies, int prev,
 		    IS_CPU_OFFLINE(offline_cpu_bitmap, i))
 			continue;
 
-		scc = st_cpu[curr] + i;
-		scp = st_cpu[prev] + i;
+		pct = st_cpu_pct + i * CPU_PCT_NR;
 
 		if (next) {
 			printf(",\n");
@@ -788,55 +1013,17 @@ void write_json_cpu_stats(int tab, unsigned long long deltot_jiffies, int prev,
 					 ", \"core\": \"%d\", \"socket\": \"%d\", \"node\": \"%d\"",
 					 cpu_topo_i->logical_core_id, cpu_topo_i->phys_package_id, cpu2node[i - 1]);
 			}
-
-			/* Recalculate itv for current proc */
-			deltot_jiffies = get_per_cpu_interval(scc, scp);
-
-			if (!deltot_jiffies) {
-				/*
-				 * If the CPU is tickless then there is no change in CPU values
-				 * but the sum of values is not zero.
-				 */
-				xprintf0(tab, "{\"cpu\": \"%d\"%s, \"usr\": 0.00, \"nice\": 0.00, "
-					 "\"sys\": 0.00, \"iowait\": 0.00, \"irq\": 0.00, "
-					 "\"soft\": 0.00, \"steal\": 0.00, \"guest\": 0.00, "
-					 "\"gnice\": 0.00, \"idle\": 100.00}", i - 1, topology);
-				printf("\n");
-
-				continue;
-			}
 		}
 
+		/* A tickless CPU has all its values set to zero, except %idle (100%) */
 		xprintf0(tab, "{\"cpu\": \"%s\"%s, \"usr\": %.2f, \"nice\": %.2f, \"sys\": %.2f, "
 			 "\"iowait\": %.2f, \"irq\": %.2f, \"soft\": %.2f, \"steal\": %.2f, "
 			 "\"guest\": %.2f, \"gnice\": %.2f, \"idle\": %.2f}",
 			 cpu_name, topology,
-			 (scc->cpu_user - scc->cpu_guest) < (scp->cpu_user - scp->cpu_guest) ?
-			 0.0 :
-			 ll_sp_value(scp->cpu_user - scp->cpu_guest,
-				     scc->cpu_user - scc->cpu_guest, deltot_jiffies),
-			 (scc->cpu_nice - scc->cpu_guest_nice) < (scp->cpu_nice - scp->cpu_guest_nice) ?
-			 0.0 :
-			 ll_sp_value(scp->cpu_nice - scp->cpu_guest_nice,
-				     scc->cpu_nice - scc->cpu_guest_nice, deltot_jiffies),
-			 ll_sp_value(scp->cpu_sys,
-				     scc->cpu_sys, deltot_jiffies),
-			 ll_sp_value(scp->cpu_iowait,
-				     scc->cpu_iowait, deltot_jiffies),
-			 ll_sp_value(scp->cpu_hardirq,
-				     scc->cpu_hardirq, deltot_jiffies),
-			 ll_sp_value(scp->cpu_softirq,
-				     scc->cpu_softirq, deltot_jiffies),
-			 ll_sp_value(scp->cpu_steal,
-				     scc->cpu_steal, deltot_jiffies),
-			 ll_sp_value(scp->cpu_guest,
-				     scc->cpu_guest, deltot_jiffies),
-			 ll_sp_value(scp->cpu_guest_nice,
-				     scc->cpu_guest_nice, deltot_jiffies),
-			 (scc->cpu_idle < scp->cpu_idle) ?
-			 0.0 :
-			 ll_sp_value(scp->cpu_idle,
-				     scc->cpu_idle, deltot_jiffies));
+			 pct[CPU_PCT_USR], pct[CPU_PCT_NICE], pct[CPU_PCT_SYS],
+			 pct[CPU_PCT_IOWAIT], pct[CPU_PCT_IRQ], pct[CPU_PCT_SOFT],
+			 pct[CPU_PCT_STEAL], pct[CPU_PCT_GUEST], pct[CPU_PCT_GNICE],
+			 pct[CPU_PCT_IDLE]);
 	}
 
 	printf("\n");
@@ -877,17 +1064,20 @@ void write_cpu_stats(int dis, unsigned long long deltot_jiffies, int prev, int c
 		deltot_jiffies = 1;
 	}
 
+	/* Compute CPU utilization for every CPU to display */
+	get_cpu_pct_table(st_cpu[curr], st_cpu[prev], STATS_CPU_SIZE, cpu_nr + 1,
+			  cpu_bitmap, offline_cpu_bitmap, deltot_jiffies,
+			  st_cpu_itv, st_cpu_pct);
+
 	if (DISPLAY_JSON_OUTPUT(flags)) {
 		if (*next) {
 			printf(",\n");
 		}
 		*next = TRUE;
-		write_json_cpu_stats(tab, deltot_jiffies, prev, curr,
-				     offline_cpu_bitmap);
+		write_json_cpu_stats(tab, offline_cpu_bitmap);
 	}
 	else {
-		write_plain_cpu_stats(dis, deltot_jiffies, prev, curr,
-				      prev_string, curr_string, offline_cpu_bitmap);
+		write_plain_cpu_stats(dis, prev_string, curr_string, offline_cpu_bitmap);
 	}
 }
 
@@ -915,7 +1105,7 @@ void write_plain_node_stats(int dis, unsigned long long deltot_jiffies,
 			    int prev, int curr, char *prev_string, char *curr_string)
 {
 	struct stats_cpu *snc, *snp, *scc, *scp;
-	int cpu, node;
+	int cpu, node, i;
 
 	if (dis) {
 		printf("\n%-11s NODE    %%usr   %%nice    %%sys %%iowait    %%irq   "
@@ -946,7 +1136,8 @@ void write_plain_node_stats(int dis, unsigned long long deltot_jiffies,
 
 			/* Recalculate interval for current node */
 			deltot_jiffies = 0;
-			for (cpu = 1; cpu <= cpu_nr; cpu++) {
+			for (i = node_cpu_start[node]; i < node_cpu_start[node + 1]; i++) {
+				cpu = node_cpu_list[i] + 1;
 				scc = st_cpu[curr] + cpu;
 				scp = st_cpu[prev] + cpu;
 
@@ -955,9 +1146,7 @@ void write_plain_node_stats(int dis, unsigned long long deltot_jiffies,
 				     scp->cpu_steal + scp->cpu_softirq == 0) && (interval != 0))
 					continue;
 
-				if (cpu2node[cpu - 1] == node - 1) {
-					deltot_jiffies += get_per_cpu_interval(scc, scp);
-				}
+				deltot_jiffies += get_per_cpu_interval(scc, scp);
 			}
 
 			if (!deltot_jiffies) {
@@ -1020,7 +1209,7 @@ void write_json_node_stats(int tab, unsigned long long deltot_jiffies,
 			   int prev, int curr)
 {
 	struct stats_cpu *snc, *snp, *scc, *scp;
-	int cpu, node, next = FALSE;
+	int cpu, node, i, next = FALSE;
 	char node_name[16];
 
 	xprintf(tab++, "\"node-load\": [");
@@ -1053,7 +1242,8 @@ void write_json_node_stats(int tab, unsigned long long deltot_jiffies,
 
 			/* Recalculate interval for current node */
 			deltot_jiffies = 0;
-			for (cpu = 1; cpu <= cpu_nr; cpu++) {
+			for (i = node_cpu_start[node]; i < node_cpu_start[node + 1]; i++) {
+				cpu = node_cpu_list[i] + 1;
 				scc = st_cpu[curr] + cpu;
 				scp = st_cpu[prev] + cpu;
 
@@ -1062,9 +1252,7 @@ void write_json_node_stats(int tab, unsigned long long deltot_jiffies,
 				     scp->cpu_steal + scp->cpu_softirq == 0) && (interval != 0))
 					continue;
 
-				if (cpu2node[cpu - 1] == node - 1) {
-					deltot_jiffies += get_per_cpu_interval(scc, scp);
-				}
+				deltot_jiffies += get_per_cpu_interval(scc, scp);
 			}
 
 			if (!deltot_jiffies) {
@@ -1342,6 +1530,95 @@ void write_isumcpu_stats(int dis, unsigned long long itv, int prev, int curr,
 	}
 }
 
+/*
+ ***************************************************************************
+ * Get the position in the previous sample of each interrupt of the current
+ * sample. This is done once for all CPU, so that the counters of each CPU
+ * can then be processed in a single pass.
+ *
+ * IN:
+ * @st_ic	Array for per-CPU statistics.
+ * @ic_nr	Number of interrupts (hard or soft) per CPU.
+ * @prev	Position in array where statistics used	as reference are.
+ * @curr	Position in array where current statistics are.
+ *
+ * OUT:
+ * @offset	Position of each interrupt in previous sample, or -1 if this
+ *		is a new interrupt (in which case its previous value is
+ *		assumed to be zero).
+ *
+ * RETURNS:
+ * Number of interrupts to display.
+ ***************************************************************************
+ */
+int get_irq_offsets(struct stats_irqcpu st_ic[], int ic_nr, int prev, int curr,
+		    int offset[])
+{
+	char *p0;
+	int j, k;
+
+	for (j = 0; j < ic_nr; j++) {
+		p0 = IRQ_NAME(st_ic[curr], j);
+		/*
+		 * An empty string for irq_name means it is a remaining interrupt
+		 * which is no longer used, for example because the
+		 * number of interrupts has decreased in /proc/interrupts.
+		 */
+		if (*p0 == '\0')
+			/* End of the list of interrupts */
+			break;
+
+		offset[j] = j;
+
+		/*
+		 * If we want stats for the time since system startup,
+		 * previous names are all empty since previous structures
+		 * are completely set to zero: Use zero as previous values.
+		 */
+		if (!interval || !strcmp(p0, IRQ_NAME(st_ic[prev], j)))
+			continue;
+
+		/* Check if interrupt exists elsewhere in list */
+		for (k = 0; k < ic_nr; k++) {
+			if (!strcmp(p0, IRQ_NAME(st_ic[prev], k)))
+				/* Interrupt found at another position */
+				break;
+		}
+		/*
+		 * Instead of printing "N/A" for a new interrupt,
+		 * assume that its previous value was zero.
+		 */
+		offset[j] = (k < ic_nr) ? k : -1;
+	}
+
+	return j;
+}
+
+/*
+ ***************************************************************************
+ * Compute the rate of each interrupt received by a CPU.
+ *
+ * IN:
+ * @p		Counters of the CPU for current sample.
+ * @q		Counters of the CPU for previous sample.
+ * @offset	Position in @q of each interrupt (see get_irq_offsets()).
+ * @nr		Number of interrupts to process.
+ * @itv		Interval value.
+ *
+ * OUT:
+ * @rate	Number of interrupts per second.
+ ***************************************************************************
+ */
+void get_irq_rates(const unsigned int *p, const unsigned int *q, const int offset[],
+		   int nr, unsigned long long itv, double rate[])
+{
+	int j;
+
+	for (j = 0; j < nr; j++) {
+		rate[j] = S_VALUE(offset[j] < 0 ? 0 : q[offset[j]], p[j], itv);
+	}
+}
+
 /*
  ***************************************************************************
  * Display interrupts statistics for each CPU in plain format.
@@ -1365,13 +1642,13 @@ void write_isumcpu_stats(int dis, unsigned long long itv, int prev, int curr,
  *		CPU bitmap for offline CPU.
  ***************************************************************************
  */
-void write_plain_irqcpu_stats(struct stats_irqcpu *st_ic[], int ic_nr, int dis,
+void write_plain_irqcpu_stats(struct stats_irqcpu st_ic[], int ic_nr, int dis,
 			      unsigned long long itv, int prev, int curr,
 			      char *prev_string, char *curr_string,
 			      const unsigned char offline_cpu_bitmap[])
 {
-	int j = ic_nr, offset, cpu, colwidth[NR_IRQS];
-	struct stats_irqcpu *p, *q, *p0, *q0;
+	int j = ic_nr, nr, cpu, colwidth[ic_nr], offset[ic_nr];
+	double rate[ic_nr];
 
 	/*
 	 * Check if number of interrupts has changed.
@@ -1381,9 +1658,7 @@ void write_plain_irqcpu_stats(struct stats_irqcpu *st_ic[], int ic_nr, int dis,
 	 */
 	if (!dis && interval) {
 		for (j = 0; j < ic_nr; j++) {
-			p0 = st_ic[curr] + j;
-			q0 = st_ic[prev] + j;
-			if (strcmp(p0->irq_name, q0->irq_name))
+			if (strcmp(IRQ_NAME(st_ic[curr], j), IRQ_NAME(st_ic[prev], j)))
 				/*
 				 * These are two different interrupts: The header must be displayed
 				 * (maybe an interrupt has disappeared, or a new one has just been registered).
@@ -1394,28 +1669,21 @@ void write_plain_irqcpu_stats(struct stats_irqcpu *st_ic[], int ic_nr, int dis,
 		}
 	}
 
+	nr = get_irq_offsets(st_ic, ic_nr, prev, curr, offset);
+
 	if (dis || (j < ic_nr)) {
 		/* Print header */
 		printf("\n%-11s  CPU", prev_string);
-		for (j = 0; j < ic_nr; j++) {
-			p0 = st_ic[curr] + j;
-			if (p0->irq_name[0] == '\0')
-				/* End of the list of interrupts */
-				break;
-			printf(" %8s/s", p0->irq_name);
+		for (j = 0; j < nr; j++) {
+			printf(" %8s/s", IRQ_NAME(st_ic[curr], j));
 		}
 		printf("\n");
 	}
 
 	/* Calculate column widths */
-	for (j = 0; j < ic_nr; j++) {
-		p0 = st_ic[curr] + j;
-		/*
-		 * Width is IRQ name + 2 for the trailing "/s".
-		 * Width is calculated even for "undefined" interrupts (with
-		 * an empty irq_name string) to quiet code analysis tools.
-		 */
-		colwidth[j] = strlen(p0->irq_name) + 2;
+	for (j = 0; j < nr; j++) {
+		/* Width is IRQ name + 2 for the trailing "/s" */
+		colwidth[j] = strlen(IRQ_NAME(st_ic[curr], j)) + 2;
 		/*
 		 * Normal space for printing a number is 11 chars
 		 * (space + 10 digits including the period).
@@ -1439,49 +1707,12 @@ void write_plain_irqcpu_stats(struct stats_irqcpu *st_ic[], int ic_nr, int dis,
 		printf("%-11s", curr_string);
 		cprintf_in(IS_INT, "  %3d", "", cpu - 1);
 
-		for (j = 0; j < ic_nr; j++) {
-			p0 = st_ic[curr] + j;	/* irq_name set only for CPU#0 */
-			/*
-			 * An empty string for irq_name means it is a remaining interrupt
-			 * which is no longer used, for example because the
-			 * number of interrupts has decreased in /proc/interrupts.
-			 */
-			if (p0->irq_name[0] == '\0')
-				/* End of the list of interrupts */
-				break;
-			q0 = st_ic[prev] + j;
-			offset = j;
+		get_irq_rates(IRQ_CPU(st_ic[curr], cpu - 1, ic_nr),
+			      IRQ_CPU(st_ic[prev], cpu - 1, ic_nr),
+			      offset, nr, itv, rate);
 
-			/*
-			 * If we want stats for the time since system startup,
-			 * we have p0->irq_name != q0->irq_name, since q0 structure
-			 * is completely set to zero.
-			 */
-			if (strcmp(p0->irq_name, q0->irq_name) && interval) {
-				/* Check if interrupt exists elsewhere in list */
-				for (offset = 0; offset < ic_nr; offset++) {
-					q0 = st_ic[prev] + offset;
-					if (!strcmp(p0->irq_name, q0->irq_name))
-						/* Interrupt found at another position */
-						break;
-				}
-			}
-
-			p = st_ic[curr] + (cpu - 1) * ic_nr + j;
-
-			if (!strcmp(p0->irq_name, q0->irq_name) || !interval) {
-				q = st_ic[prev] + (cpu - 1) * ic_nr + offset;
-				cprintf_f(NO_UNIT, FALSE, 1, colwidth[j], 2,
-					  S_VALUE(q->interrupt, p->interrupt, itv));
-			}
-			else {
-				/*
-				 * Instead of printing "N/A", assume that previous value
-				 * for this new interrupt was zero.
-				 */
-				cprintf_f(NO_UNIT, FALSE, 1, colwidth[j], 2,
-					  S_VALUE(0, p->interrupt, itv));
-			}
+		for (j = 0; j < nr; j++) {
+			cprintf_f(NO_UNIT, FALSE, 1, colwidth[j], 2, rate[j]);
 		}
 		printf("\n");
 	}
@@ -1505,13 +1736,13 @@ void write_plain_irqcpu_stats(struct stats_irqcpu *st_ic[], int ic_nr, int dis,
  *		CPU bitmap for offline CPU.
  ***************************************************************************
  */
-void write_json_irqcpu_stats(int tab, struct stats_irqcpu *st_ic[], int ic_nr,
+void write_json_irqcpu_stats(int tab, struct stats_irqcpu st_ic[], int ic_nr,
 			     unsigned long long itv, int prev, int curr, int type,
 			     const unsigned char offline_cpu_bitmap[])
 {
-	int j = ic_nr, offset, cpu;
-	struct stats_irqcpu *p, *q, *p0, *q0;
-	int nextcpu = FALSE, nextirq;
+	int j, nr, cpu, offset[ic_nr];
+	int nextcpu = FALSE;
+	double rate[ic_nr];
 
 	if (type == M_D_IRQ_CPU) {
 		xprintf(tab++, "\"individual-interrupts\": [");
@@ -1520,6 +1751,8 @@ void write_json_irqcpu_stats(int tab, struct stats_irqcpu *st_ic[], int ic_nr,
 		xprintf(tab++, "\"soft-interrupts\": [");
 	}
 
+	nr = get_irq_offsets(st_ic, ic_nr, prev, curr, offset);
+
 	for (cpu = 1; cpu <= cpu_nr; cpu++) {
 
 		/*
@@ -1535,60 +1768,18 @@ void write_json_irqcpu_stats(int tab, struct stats_irqcpu *st_ic[], int ic_nr,
 			printf(",\n");
 		}
 		nextcpu = TRUE;
-		nextirq = FALSE;
 		xprintf(tab++, "{\"cpu\": \"%d\", \"intr\": [", cpu - 1);
 
-		for (j = 0; j < ic_nr; j++) {
-
-			p0 = st_ic[curr] + j;	/* irq_name set only for CPU#0 */
-			/*
-			 * An empty string for irq_name means it is a remaining interrupt
-			 * which is no longer used, for example because the
-			 * number of interrupts has decreased in /proc/interrupts.
-			 */
-			if (p0->irq_name[0] == '\0')
-				/* End of the list of interrupts */
-				break;
-			q0 = st_ic[prev] + j;
-			offset = j;
+		get_irq_rates(IRQ_CPU(st_ic[curr], cpu - 1, ic_nr),
+			      IRQ_CPU(st_ic[prev], cpu - 1, ic_nr),
+			      offset, nr, itv, rate);
 
-			if (nextirq) {
+		for (j = 0; j < nr; j++) {
+			if (j) {
 				printf(",\n");
 			}
-			nextirq = TRUE;
-
-			/*
-			 * If we want stats for the time since system startup,
-			 * we have p0->irq_name != q0->irq_name, since q0 structure
-			 * is completely set to zero.
-			 */
-			if (strcmp(p0->irq_name, q0->irq_name) && interval) {
-				/* Check if interrupt exists elsewhere in list */
-				for (offset = 0; offset < ic_nr; offset++) {
-					q0 = st_ic[prev] + offset;
-					if (!strcmp(p0->irq_name, q0->irq_name))
-						/* Interrupt found at another position */
-						break;
-				}
-			}
-
-			p = st_ic[curr] + (cpu - 1) * ic_nr + j;
-
-			if (!strcmp(p0->irq_name, q0->irq_name) || !interval) {
-				q = st_ic[prev] + (cpu - 1) * ic_nr + offset;
-				xprintf0(tab, "{\"name\": \"%s\", \"value\": %.2f}",
-					 p0->irq_name,
-					 S_VALUE(q->interrupt, p->interrupt, itv));
-			}
-			else {
-				/*
-				 * Instead of printing "N/A", assume that previous value
-				 * for this new interrupt was zero.
-				 */
-				xprintf0(tab, "{\"name\": \"%s\", \"value\": %.2f}",
-					 p0->irq_name,
-					 S_VALUE(0, p->interrupt, itv));
-			}
+			xprintf0(tab, "{\"name\": \"%s\", \"value\": %.2f}",
+				 IRQ_NAME(st_ic[curr], j), rate[j]);
 		}
 		printf("\n");
 		xprintf0(--tab, "] }");
@@ -1624,7 +1815,7 @@ void write_json_irqcpu_stats(int tab, struct stats_irqcpu *st_ic[], int ic_nr,
  *		CPU bitmap for offline CPU.
  ***************************************************************************
  */
-void write_irqcpu_stats(struct stats_irqcpu *st_ic[], int ic_nr, int dis,
+void write_irqcpu_stats(struct stats_irqcpu st_ic[], int ic_nr, int dis,
 			unsigned long long itv, int prev, int curr,
 			char *prev_string, char *curr_string, int tab,
 			int *next, int type, unsigned char offline_cpu_bitmap[])
@@ -1807,119 +1998,194 @@ void read_stat_total_irq(struct stats_global_irq *st_irq)
 }
 /*
  ***************************************************************************
- * Read stats from /proc/interrupts or /proc/softirqs.
+ * Skip the spaces at the beginning of a string. Spaces are skipped eight at
+ * a time when possible by comparing a whole word with a word of spaces.
+ * The string must be followed by at least FILE_BUF_PAD - 1 readable bytes
+ * (see read_file_buf()).
  *
  * IN:
- * @file	/proc file to read (interrupts or softirqs).
+ * @cp	String.
+ *
+ * RETURNS:
+ * Pointer on the first character which is not a space.
+ ***************************************************************************
+ */
+static char *skip_spaces(char *cp)
+{
+#if defined(__GNUC__) && defined(__BYTE_ORDER__) && (__BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__)
+	uint64_t w;
+
+	for (;;) {
+		memcpy(&w, cp, sizeof(w));
+		/* Bytes which are spaces are now zero */
+		w ^= 0x2020202020202020ULL;
+		if (w)
+			/* Lowest non-zero byte is the first character which is not a space */
+			return cp + (__builtin_ctzll(w) >> 3);
+		cp += sizeof(w);
+	}
+#else
+	while (*cp == ' ') {
+		cp++;
+	}
+	return cp;
+#endif
+}
+
+/*
+ ***************************************************************************
+ * Parse the contents of /proc/interrupts or /proc/softirqs.
+ * Each line is parsed in place: Its counters are written directly at their
+ * location in the array of per-CPU statistics.
+ *
+ * IN:
+ * @buf		Contents of the file (see read_file_buf()).
  * @ic_nr	Number of interrupts (hard or soft) per CPU.
  * @curr	Position in array where current statistics will be saved.
  *
  * OUT:
  * @st_ic	Array for per-CPU interrupts statistics.
+ *
+ * RETURNS:
+ * Number of interrupts read.
  ***************************************************************************
  */
-void read_interrupts_stat(char *file, struct stats_irqcpu *st_ic[], int ic_nr, int curr)
+int parse_interrupts_stat(char *buf, struct stats_irqcpu st_ic[], int ic_nr, int curr)
 {
-	FILE *fp;
 	struct stats_global_irq *st_irq_i;
-	struct stats_irqcpu *p;
-	char *line = NULL, *li;
-	unsigned long irq = 0;
+	char *name, *line = buf, *eol, *li, *cp, *next;
+	unsigned long irq = 0, val;
 	unsigned int cpu, c = 0;
 	int cpu_index[cpu_nr], index = 0, len;
-	char *cp, *next;
 
-	if ((fp = fopen(file, "r")) != NULL) {
-
-		SREALLOC(line, char, INTERRUPTS_LINE + 11 * cpu_nr);
+	/*
+	 * Parse header line to see which CPUs are online
+	 */
+	for (; *line; line = eol + 1) {
 
-		/*
-		 * Parse header line to see which CPUs are online
-		 */
-		while (fgets(line, INTERRUPTS_LINE + 11 * cpu_nr, fp) != NULL) {
+		if ((eol = strchr(line, '\n')) != NULL) {
+			*eol = '\0';
+		}
+		else {
+			eol = line + strlen(line) - 1;
+		}
 
-			next = line;
-			while (((cp = strstr(next, "CPU")) != NULL) && (index < cpu_nr)) {
+		next = line;
+		while (((cp = strstr(next, "CPU")) != NULL) && (index < cpu_nr)) {
 
-				cpu = strtol(cp + 3, &next, 10);
-				if (cpu >= cpu_nr)
-					break;
-				cpu_index[index++] = cpu;
+			cpu = strtol(cp + 3, &next, 10);
+			if (cpu >= cpu_nr)
+				break;
+			cpu_index[index++] = cpu;
 
-				/*
-				 * Reset total number of interrupts received by a CPU
-				 * only for online CPU. Only needed for st_irq structures.
-				 */
-				st_irq_i = st_irq[curr] + cpu + 1;
-				st_irq_i->irq_nr = 0;
+			/*
+			 * Reset total number of interrupts received by a CPU
+			 * only for online CPU. Only needed for st_irq structures.
+			 */
+			st_irq_i = st_irq[curr] + cpu + 1;
+			st_irq_i->irq_nr = 0;
 
-				/*
-				 * For offline CPU, pick up previous values so that when the
-				 * CPU goes back online, values won't jump from zero.
-				 */
-				fwd_irq_values(st_ic, c, cpu, ic_nr, curr);
-				c = cpu + 1;
-			}
-			if (index)
-				/* Header line found */
-				break;
+			/*
+			 * For offline CPU, pick up previous values so that when the
+			 * CPU goes back online, values won't jump from zero.
+			 */
+			fwd_irq_values(st_ic, c, cpu, ic_nr, curr);
+			c = cpu + 1;
 		}
+		if (index) {
+			/* Header line found */
+			line = eol + 1;
+			break;
+		}
+	}
 
-		/* Process possible offline CPU at the end of the list */
-		fwd_irq_values(st_ic, c, cpu_nr, ic_nr, curr);
+	/* Process possible offline CPU at the end of the list */
+	fwd_irq_values(st_ic, c, cpu_nr, ic_nr, curr);
 
-		/* Parse each line of interrupts statistics data */
-		while ((fgets(line, INTERRUPTS_LINE + 11 * cpu_nr, fp) != NULL) &&
-		       (irq < ic_nr)) {
+	/* Parse each line of interrupts statistics data */
+	for (; *line && (irq < ic_nr); line = eol + 1) {
 
-			/* Skip over "<irq>:" */
-			if ((cp = strchr(line, ':')) == NULL)
-				/* Chr ':' not found */
-				continue;
-			cp++;
+		if ((eol = strchr(line, '\n')) != NULL) {
+			*eol = '\0';
+		}
+		else {
+			eol = line + strlen(line) - 1;
+		}
 
-			p = st_ic[curr] + irq;
+		/* Skip over "<irq>:" */
+		if ((cp = strchr(line, ':')) == NULL)
+			/* Chr ':' not found */
+			continue;
+		cp++;
 
-			/* Remove possible heading spaces in interrupt's name... */
-			li = line;
-			while (*li == ' ')
-				li++;
+		/* Remove possible heading spaces in interrupt's name... */
+		li = line;
+		while (*li == ' ')
+			li++;
 
-			len = strcspn(li, ":");
-			if (len >= MAX_IRQ_LEN) {
-				len = MAX_IRQ_LEN - 1;
-			}
-			/* ...then save its name */
-			strncpy(p->irq_name, li, len);
-			p->irq_name[len] = '\0';
-
-			/* For each interrupt: Get number received by each CPU */
-			for (cpu = 0; cpu < index; cpu++) {
-				p = st_ic[curr] + cpu_index[cpu] * ic_nr + irq;
-				st_irq_i = st_irq[curr] + cpu_index[cpu] + 1;
-				/*
-				 * No need to set (st_irqcpu + cpu * irqcpu_nr)->irq_name:
-				 * This is the same as st_irqcpu->irq_name.
-				 * Now save current interrupt value for current CPU (in
-				 * stats_irqcpu structure) and total number of interrupts
-				 * received by current CPU (in stats_global_irq structure).
-				 */
-				p->interrupt = strtoul(cp, &next, 10);
-				st_irq_i->irq_nr += p->interrupt;
-				cp = next;
+		len = cp - 1 - li;
+		if (len >= MAX_IRQ_LEN) {
+			len = MAX_IRQ_LEN - 1;
+		}
+		/* ...then save its name */
+		name = IRQ_NAME(st_ic[curr], irq);
+		memcpy(name, li, len);
+		name[len] = '\0';
+
+		/* For each interrupt: Get number received by each CPU */
+		for (cpu = 0; cpu < index; cpu++) {
+			/*
+			 * Values are separated by spaces only. A missing value
+			 * (end of line or text reached) is read as zero.
+			 */
+			cp = skip_spaces(cp);
+			for (val = 0; (unsigned char) (*cp - '0') < 10; cp++) {
+				val = val * 10 + (*cp - '0');
 			}
-			irq++;
+
+			/*
+			 * Now save current interrupt value for current CPU (in
+			 * its column of counters) and total number of interrupts
+			 * received by current CPU (in stats_global_irq structure).
+			 */
+			IRQ_CPU(st_ic[curr], cpu_index[cpu], ic_nr)[irq] = (unsigned int) val;
+			st_irq[curr][cpu_index[cpu] + 1].irq_nr += (unsigned int) val;
 		}
+		irq++;
+	}
 
-		fclose(fp);
+	return irq;
+}
+
+/*
+ ***************************************************************************
+ * Read stats from /proc/interrupts or /proc/softirqs.
+ * The file is read as a whole in a buffer which is reused from one sample
+ * to the next.
+ *
+ * IN:
+ * @file	/proc file to read (interrupts or softirqs).
+ * @fb		Buffer used to read the file.
+ * @ic_nr	Number of interrupts (hard or soft) per CPU.
+ * @curr	Position in array where current statistics will be saved.
+ *
+ * OUT:
+ * @st_ic	Array for per-CPU interrupts statistics.
+ ***************************************************************************
+ */
+void read_interrupts_stat(char *file, struct file_buf *fb, struct stats_irqcpu st_ic[],
+			  int ic_nr, int curr)
+{
+	int irq = 0;
 
-		free(line);
+	if (read_file_buf(file, fb) >= 0) {
+		irq = parse_interrupts_stat(fb->buf, st_ic, ic_nr, curr);
 	}
 
 	while (irq < ic_nr) {
 		/* Nb of interrupts per processor has changed */
-		p = st_ic[curr] + irq;
-		p->irq_name[0] = '\0';	/* This value means this is a dummy interrupt */
+		/* An empty name means this is a dummy interrupt */
+		*IRQ_NAME(st_ic[curr], irq) = '\0';
 		irq++;
 	}
 }
@@ -1989,10 +2255,10 @@ void rw_mpstat_loop(int dis_hdr, int rows)
 	 */
 	if (DISPLAY_IRQ_SUM(actflags) || DISPLAY_IRQ_CPU(actflags)) {
 		/* Read this file to display int per CPU or total nr of int per CPU */
-		read_interrupts_stat(INTERRUPTS, st_irqcpu, irqcpu_nr, 0);
+		read_interrupts_stat(INTERRUPTS, &irq_fb, st_irqcpu, irqcpu_nr, 0);
 	}
 	if (DISPLAY_SOFTIRQS(actflags)) {
-		read_interrupts_stat(SOFTIRQS, st_softirqcpu, softirqcpu_nr, 0);
+		read_interrupts_stat(SOFTIRQS, &softirq_fb, st_softirqcpu, softirqcpu_nr, 0);
 	}
 
 	if (!interval) {
@@ -2001,9 +2267,12 @@ void rw_mpstat_loop(int dis_hdr, int rows)
 		memset(st_cpu[1], 0, STATS_CPU_SIZE * (cpu_nr + 1));
 		memset(st_node[1], 0, STATS_CPU_SIZE * (cpu_nr + 1));
 		memset(st_irq[1], 0, STATS_GLOBAL_IRQ_SIZE * (cpu_nr + 1));
-		memset(st_irqcpu[1], 0, STATS_IRQCPU_SIZE * (cpu_nr + 1) * irqcpu_nr);
+		memset(st_irqcpu[1].interrupt, 0, sizeof(unsigned int) * (cpu_nr + 1) * irqcpu_nr);
+		memset(st_irqcpu[1].irq_name, 0, MAX_IRQ_LEN * irqcpu_nr);
 		if (DISPLAY_SOFTIRQS(actflags)) {
-			memset(st_softirqcpu[1], 0, STATS_IRQCPU_SIZE * (cpu_nr + 1) * softirqcpu_nr);
+			memset(st_softirqcpu[1].interrupt, 0,
+			       sizeof(unsigned int) * (cpu_nr + 1) * softirqcpu_nr);
+			memset(st_softirqcpu[1].irq_name, 0, MAX_IRQ_LEN * softirqcpu_nr);
 		}
 		write_stats(0, DISP_HDR);
 		if (DISPLAY_JSON_OUTPUT(flags)) {
@@ -2024,10 +2293,14 @@ void rw_mpstat_loop(int dis_hdr, int rows)
 	memcpy(st_cpu[2], st_cpu[0], STATS_CPU_SIZE * (cpu_nr + 1));
 	memcpy(st_node[2], st_node[0], STATS_CPU_SIZE * (cpu_nr + 1));
 	memcpy(st_irq[2], st_irq[0], STATS_GLOBAL_IRQ_SIZE * (cpu_nr + 1));
-	memcpy(st_irqcpu[2], st_irqcpu[0], STATS_IRQCPU_SIZE * (cpu_nr + 1) * irqcpu_nr);
+	memcpy(st_irqcpu[2].interrupt, st_irqcpu[0].interrupt,
+	       sizeof(unsigned int) * (cpu_nr + 1) * irqcpu_nr);
+	memcpy(st_irqcpu[2].irq_name, st_irqcpu[0].irq_name, MAX_IRQ_LEN * irqcpu_nr);
 	if (DISPLAY_SOFTIRQS(actflags)) {
-		memcpy(st_softirqcpu[2], st_softirqcpu[0],
-		       STATS_IRQCPU_SIZE * (cpu_nr + 1) * softirqcpu_nr);
+		memcpy(st_softirqcpu[2].interrupt, st_softirqcpu[0].interrupt,
+		       sizeof(unsigned int) * (cpu_nr + 1) * softirqcpu_nr);
+		memcpy(st_softirqcpu[2].irq_name, st_softirqcpu[0].irq_name,
+		       MAX_IRQ_LEN * softirqcpu_nr);
 	}
 
 	/* Set a handler for SIGINT */
@@ -2072,10 +2345,10 @@ void rw_mpstat_loop(int dis_hdr, int rows)
 		 * and compute the total number of interrupts received by each CPU.
 		 */
 		if (DISPLAY_IRQ_SUM(actflags) || DISPLAY_IRQ_CPU(actflags)) {
-			read_interrupts_stat(INTERRUPTS, st_irqcpu, irqcpu_nr, curr);
+			read_interrupts_stat(INTERRUPTS, &irq_fb, st_irqcpu, irqcpu_nr, curr);
 		}
 		if (DISPLAY_SOFTIRQS(actflags)) {
-			read_interrupts_stat(SOFTIRQS, st_softirqcpu, softirqcpu_nr, curr);
+			read_interrupts_stat(SOFTIRQS, &softirq_fb, st_softirqcpu, softirqcpu_nr, curr);
 		}
 
 		/* Write stats */
@@ -2125,6 +2398,7 @@ void rw_mpstat_loop(int dis_hdr, int rows)
 
 				/* Get NUMA node placement */
 				node_nr = get_node_placement(new_cpu_nr, cpu_per_node, cpu2node);
+				set_node_cpu_list(new_cpu_nr, cpu2node, node_cpu_start, node_cpu_list);
 
 				/* Update the highest processor number */
 				cpu_nr = new_cpu_nr;
@@ -2184,6 +2458,7 @@ int main(int argc, char **argv)
 
 	/* Get NUMA node placement */
 	node_nr = get_node_placement(cpu_nr, cpu_per_node, cpu2node);
+	set_node_cpu_list(cpu_nr, cpu2node, node_cpu_start, node_cpu_list);
 
 	while (++opt < argc) {
 
@@ -18,6 +18,9 @@
 #define SOFTIRQS	PRE "/proc/softirqs"
 #define PHYS_PACK_ID	"topology/physical_package_id"
 #define THREAD_SBL_LST	"topology/thread_siblings_list"
+#define CPU_ONLINE	SYSFS_DEVCPU "/online"
+#define SYSFS_DEVNODE	PRE "/sys/devices/system/node"
+#define NODE_CPULIST	"cpulist"
 
 /*
  ***************************************************************************
@@ -78,23 +81,28 @@
  */
 
 /*
- * stats_irqcpu->irq_name:  IRQ#-A
- * stats_irqcpu->interrupt: number of IRQ#-A for proc 0
- * stats_irqcpu->irq_name:  IRQ#-B
- * stats_irqcpu->interrupt: number of IRQ#-B for proc 0
+ * Interrupts (hard or soft) statistics for every CPU.
+ * Each interrupt name is saved only once, and the counters of each CPU
+ * are saved in a dense column of @ic_nr values:
+ * IRQ_NAME(st_ic, 0):   IRQ#-A
+ * IRQ_NAME(st_ic, 1):   IRQ#-B
  * ...
- * stats_irqcpu->irq_name:  (undef'd)
- * stats_irqcpu->interrupt: number of IRQ#-A for proc 1
- * stats_irqcpu->irq_name:  (undef'd)
- * stats_irqcpu->interrupt: number of IRQ#-B for proc 1
+ * interrupt[0]:         number of IRQ#-A for proc 0
+ * interrupt[1]:         number of IRQ#-B for proc 0
+ * ...
+ * interrupt[ic_nr]:     number of IRQ#-A for proc 1
+ * interrupt[ic_nr + 1]: number of IRQ#-B for proc 1
  * ...
  */
 struct stats_irqcpu {
-	unsigned int interrupt;
-	char         irq_name[MAX_IRQ_LEN];
+	unsigned int *interrupt;
+	char         *irq_name;		/* @ic_nr names of MAX_IRQ_LEN bytes */
 };
 
-#define STATS_IRQCPU_SIZE      (sizeof(struct stats_irqcpu))
+/* Name of interrupt #j */
+#define IRQ_NAME(st_ic, j)	((st_ic).irq_name + (j) * MAX_IRQ_LEN)
+/* Counters of CPU #c (0 is the first CPU) */
+#define IRQ_CPU(st_ic, c, ic_nr)	((st_ic).interrupt + (c) * (ic_nr))
 
 struct stats_global_irq {
 	unsigned long long irq_nr;
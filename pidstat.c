@@ -22,12 +22,18 @@
 #include <stdio.h>
 #include <string.h>
 #include <stdlib.h>
+#include <stddef.h>
 #include <unistd.h>
 #include <fcntl.h>
 #include <signal.h>
 #include <dirent.h>
 #include <ctype.h>
+#include <time.h>
+#include <errno.h>
 #include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/vfs.h>
+#include <sys/syscall.h>
 #include <pwd.h>
 #include <sys/utsname.h>
 #include <sys/wait.h>
@@ -76,12 +82,30 @@ unsigned int pidflag = 0;	/* General flags */
 unsigned int tskflag = 0;	/* TASK/CHILD stats */
 unsigned int actflag = 0;	/* Activity flag */
 
-struct sigaction alrm_act, int_act, chld_act;
+struct sigaction alrm_act, int_act, chld_act, usr1_act;
 int signal_caught = 0;
+volatile sig_atomic_t alarm_caught = FALSE;	/* Set to TRUE when SIGALRM is received */
+volatile sig_atomic_t cmd_refresh = FALSE;	/* Set to TRUE when SIGUSR1 is received */
 int status = 0;
 
 int dplaces_nr = -1;		/* Number of decimal places */
 
+unsigned int top_nr = 0;	/* Number of tasks to display with option --top */
+int top_key = TOP_CPU;		/* Key used to select those tasks */
+struct top_ent *top_heap = NULL;
+
+struct pstr *pstr_hash[PSTR_HASH_SIZE];	/* Shared strings */
+
+struct st_cgroup *cg_root = NULL;	/* Root of the cgroup tree (option --cgroup) */
+struct st_cgroup *cg_hash[CG_HASH_SIZE];	/* Cgroups hashed by parent and name */
+unsigned int cg_fd_nr = 0;		/* Number of descriptors kept open on cgroup directories */
+unsigned int cg_fd_max = CG_FD_MAX;	/* Max number of such descriptors */
+
+char ofile[MAX_FILE_LEN];	/* File where stats are saved (option -o) */
+int ofd = -1;
+struct task_stats *task_buf = NULL;	/* Stats to be saved to file */
+int task_buf_nr = 0;
+
 /*
  ***************************************************************************
  * Print usage and exit.
@@ -98,8 +122,9 @@ void usage(char *progname)
 	fprintf(stderr, _("Options are:\n"
 			  "[ -d ] [ -H ] [ -h ] [ -I ] [ -l ] [ -R ] [ -r ] [ -s ] [ -t ] [ -U [ <username> ] ]\n"
 			  "[ -u ] [ -V ] [ -v ] [ -w ] [ -C <command> ] [ -G <process_name> ]\n"
-			  "[ -p { <pid> [,...] | SELF | ALL } ] [ -T { TASK | CHILD | ALL } ]\n"
-			  "[ --dec={ 0 | 1 | 2 } ] [ --human ]\n"));
+			  "[ -o <filename> ] [ -p { <pid> [,...] | SELF | ALL } ] [ -T { TASK | CHILD | ALL } ]\n"
+			  "[ --cgroup ] [ --dec={ 0 | 1 | 2 } ] [ --fast-threads ] [ --human ] [ --lazy ]\n"
+			  "[ --stack-res ] [ --top <nr> [ --sort { cpu | mem | io | cswch } ] ]\n"));
 	exit(1);
 }
 
@@ -113,6 +138,7 @@ void usage(char *progname)
  */
 void alarm_handler(int sig)
 {
+	alarm_caught = TRUE;
 	alarm(interval);
 }
 
@@ -140,6 +166,134 @@ void int_handler(int sig)
 	}
 }
 
+/*
+ ***************************************************************************
+ * SIGUSR1 signal handler: Command names and command lines saved for
+ * every task will be read again during next sample.
+ *
+ * IN:
+ * @sig	Signal number.
+ ***************************************************************************
+ */
+void usr1_handler(int sig)
+{
+	cmd_refresh = TRUE;
+}
+
+/*
+ ***************************************************************************
+ * Wait for next sample, i.e. for SIGALRM (or SIGINT/SIGCHLD) signal.
+ * SIGUSR1 signals received in the meantime don't make us stop waiting.
+ ***************************************************************************
+ */
+void wait_next_sample(void)
+{
+	while (!alarm_caught && !signal_caught) {
+		__pause();
+#ifdef TEST
+		/* No SIGALRM in test mode: Next sample is due at once */
+		alarm_caught = TRUE;
+#endif
+	}
+	alarm_caught = FALSE;
+}
+
+/*
+ ***************************************************************************
+ * Get a shared copy of a string. Tasks running the same program (and
+ * threads of a same process) then use the same copy of their command name
+ * and command line.
+ *
+ * IN:
+ * @str		String to share (not necessarily null-terminated).
+ * @len		Length of the string.
+ *
+ * RETURNS:
+ * Pointer on the shared copy of the string. It must be released with
+ * release_string() when no longer used.
+ ***************************************************************************
+ */
+char *intern_string(const char *str, size_t len)
+{
+	unsigned int hash = 2166136261U;
+	size_t i;
+	struct pstr *ps;
+
+	/* FNV-1a hash */
+	for (i = 0; i < len; i++) {
+		hash = (hash ^ (unsigned char) str[i]) * 16777619U;
+	}
+
+	for (ps = pstr_hash[hash % PSTR_HASH_SIZE]; ps != NULL; ps = ps->next) {
+		if ((ps->hash == hash) && !strncmp(ps->str, str, len) && !ps->str[len]) {
+			ps->refcnt++;
+			return ps->str;
+		}
+	}
+
+	if ((ps = (struct pstr *) malloc(sizeof(struct pstr) + len + 1)) == NULL) {
+		perror("malloc");
+		exit(4);
+	}
+	memcpy(ps->str, str, len);
+	ps->str[len] = '\0';
+	ps->hash = hash;
+	ps->refcnt = 1;
+	ps->next = pstr_hash[hash % PSTR_HASH_SIZE];
+	pstr_hash[hash % PSTR_HASH_SIZE] = ps;
+
+	return ps->str;
+}
+
+/*
+ ***************************************************************************
+ * Get another reference on a shared string.
+ *
+ * IN:
+ * @str		Shared string (as returned by intern_string()).
+ *
+ * RETURNS:
+ * Pointer on the shared string.
+ ***************************************************************************
+ */
+char *share_string(char *str)
+{
+	struct pstr *ps = (struct pstr *) (str - offsetof(struct pstr, str));
+
+	ps->refcnt++;
+
+	return str;
+}
+
+/*
+ ***************************************************************************
+ * Release a reference on a shared string. The string is freed when no
+ * longer used.
+ *
+ * IN:
+ * @str		Shared string (as returned by intern_string()). May be NULL.
+ ***************************************************************************
+ */
+void release_string(char *str)
+{
+	struct pstr *ps, **pp;
+
+	if (!str)
+		return;
+
+	ps = (struct pstr *) (str - offsetof(struct pstr, str));
+	if (--ps->refcnt)
+		return;
+
+	for (pp = &pstr_hash[ps->hash % PSTR_HASH_SIZE]; *pp != NULL; pp = &((*pp)->next)) {
+		if (*pp == ps) {
+			*pp = ps->next;
+			break;
+		}
+	}
+	free(ps);
+}
+
 /*
  ***************************************************************************
  * Free unused PID structures.
@@ -151,19 +305,29 @@ void int_handler(int sig)
  */
 void sfree_pid(struct st_pid **plist, int force)
 {
-	int i;
-	struct st_pid *p;
+	struct st_pid *p, **hp, *gone = NULL;
 
 	while (*plist != NULL) {
 
 		p = *plist;
 		if (!p->exist || force) {
 			*plist = p->next;
-			for (i = 0; i < 3; i++) {
-				if (p->pstats[i]) {
-					free(p->pstats[i]);
-				}
+			if (p->tgid && (p->tgid != gone)) {
+				/*
+				 * Remove thread from its TGID's hash table. No need to do it
+				 * if the TGID has just been freed (its threads immediately
+				 * follow it in list).
+				 */
+				for (hp = &(p->tgid->thr_hash[p->pid % THR_HASH_SIZE]);
+				     *hp != p; hp = &((*hp)->hnext));
+				*hp = p->hnext;
+			}
+			else if (!p->tgid) {
+				free(p->thr_hash);
+				gone = p;
 			}
+			release_string(p->comm);
+			release_string(p->cmdline);
 			free(p);
 		}
 		else {
@@ -210,8 +374,19 @@ void check_flags(void)
 		pidflag |= P_D_ACTIVE_PID + P_D_ALL_PID;
 	}
 
-	if (!tskflag) {
-		tskflag |= P_TASK;
+	if (!tskflag || SAVE_TO_FILE(pidflag)) {
+		/* Only stats for the tasks themselves are saved to file */
+		tskflag = P_TASK;
+	}
+
+	if (DISPLAY_CGROUP(pidflag)) {
+		/* Only CPU, memory and I/O stats are available per cgroup */
+		actflag &= P_A_CPU + P_A_MEM + P_A_IO;
+		if (!actflag) {
+			fprintf(stderr, _("Requested activities not available\n"));
+			exit(1);
+		}
+		return;
 	}
 
 	/* Check that requested activities are available */
@@ -231,6 +406,106 @@ void check_flags(void)
 	}
 }
 
+/*
+ ***************************************************************************
+ * Allocate and initialize a new st_pid structure.
+ *
+ * IN:
+ * @pid		PID number.
+ * @tgid_p	If PID is a TID then pointer on its TGID structure. NULL
+ *		otherwise.
+ * @next	Next structure in list.
+ *
+ * RETURNS:
+ * Pointer on the new structure.
+ ***************************************************************************
+ */
+struct st_pid *new_pid(pid_t pid, struct st_pid *tgid_p, struct st_pid *next)
+{
+	struct st_pid *p;
+	int i;
+
+	if ((p = (struct st_pid *) malloc(sizeof(struct st_pid))) == NULL) {
+		perror("malloc");
+		exit(4);
+	}
+	memset(p, 0, sizeof(struct st_pid));
+
+	for (i = 0; i < 3; i++) {
+		p->pstats[i] = &(p->stats[i]);
+	}
+	p->comm = intern_string("", 0);
+	p->cmdline = intern_string("", 0);
+	p->pid = pid;
+	p->next = next;
+	p->tgid = tgid_p;
+
+	return p;
+}
+
+/*
+ ***************************************************************************
+ * Look for a TID among the threads of its TGID and store it if necessary.
+ * Threads are looked up using the TGID's hash table, then inserted in
+ * ascending order immediately following their TGID in list.
+ *
+ * IN:
+ * @tgid_p	Pointer on the st_pid structure of the TGID.
+ * @tid		TID number.
+ * @hint	Last thread of the same TGID looked up (or NULL). Directory
+ *		entries are usually returned in ascending order, so that
+ *		the new TID is likely to be inserted just after it.
+ *
+ * OUT:
+ * @hint	Pointer on the st_pid structure of the TID.
+ *
+ * RETURNS:
+ * Pointer on the st_pid structure in the list where the TID is located
+ * (whether it was already in the list or if it has been added).
+ ***************************************************************************
+ */
+struct st_pid *add_list_tid(struct st_pid *tgid_p, pid_t tid, struct st_pid **hint)
+{
+	struct st_pid *p, **plist;
+	unsigned int h = tid % THR_HASH_SIZE;
+
+	if (!tgid_p->thr_hash) {
+		if ((tgid_p->thr_hash = (struct st_pid **) calloc(THR_HASH_SIZE,
+								 sizeof(struct st_pid *))) == NULL) {
+			perror("calloc");
+			exit(4);
+		}
+	}
+
+	for (p = tgid_p->thr_hash[h]; p != NULL; p = p->hnext) {
+		if (p->pid == tid)
+			/* TID found in list */
+			goto found;
+	}
+
+	/* TID not found: Look for the place where it should be inserted */
+	if (hint && *hint && ((*hint)->pid < tid)) {
+		plist = &((*hint)->next);
+	}
+	else {
+		plist = &(tgid_p->next);
+	}
+	while ((*plist != NULL) && ((*plist)->tgid == tgid_p) && ((*plist)->pid < tid)) {
+		plist = &((*plist)->next);
+	}
+
+	/* Add TID to the list and to the hash table */
+	p = *plist = new_pid(tid, tgid_p, *plist);
+	p->hnext = tgid_p->thr_hash[h];
+	tgid_p->thr_hash[h] = p;
+
+found:
+	if (hint) {
+		*hint = p;
+	}
+	return p;
+}
+
 /*
  ***************************************************************************
  * Look for the PID in the list and store it if necessary.
@@ -251,100 +526,45 @@ void check_flags(void)
  */
 struct st_pid *add_list_pid(struct st_pid **plist, pid_t pid, pid_t tgid)
 {
-	struct st_pid *p, *ps, *tgid_p = NULL;
-	int i;
+	struct st_pid *p;
 
 	if (!pid)
 		return NULL;
 
-	if (!tgid) {
-		/*
-		 * Add a true PID to the list.
-		 * Add it in ascending order, not taking into account
-		 * other TIDs.
-		 */
-		while (*plist != NULL) {
-
-			p = *plist;
-			if (!p->tgid && (p->pid == pid))
-				/* PID found in list */
-				return p;
-
-			if (!p->tgid && (p->pid > pid))
-				/* Stop now to insert PID in list */
-				break;
-
-			plist = &(p->next);
+	if (tgid) {
+		/* PID is a TID: Look for its TGID first */
+		for (p = *plist; p != NULL; p = p->next) {
+			if (!p->tgid && (p->pid == tgid))
+				/* TGID found in list */
+				return add_list_tid(p, pid, NULL);
 		}
+		/* TGID not found: Stop now */
+		return NULL;
 	}
-	else {
-		int tgid_found = FALSE;
 
-		/*
-		 * PID is a TID.
-		 * It will be inserted in ascending order immediately
-		 * following its TGID.
-		 */
-		while (*plist != NULL) {
+	/*
+	 * Add a true PID to the list.
+	 * Add it in ascending order, not taking into account
+	 * other TIDs.
+	 */
+	while (*plist != NULL) {
 
-			p = *plist;
-			if (p->pid == tgid) {
-				/* TGID found in list */
-				tgid_found = TRUE;
-				tgid_p = p;
-				break;
-			}
+		p = *plist;
+		if (!p->tgid && (p->pid == pid))
+			/* PID found in list */
+			return p;
 
-			plist = &(p->next);
-		}
-		if (!tgid_found)
-			/* TGID not found: Stop now */
-			return NULL;
+		if (!p->tgid && (p->pid > pid))
+			/* Stop now to insert PID in list */
+			break;
 
 		plist = &(p->next);
-		while (*plist != NULL) {
-
-			p = *plist;
-			if ((p->tgid == tgid_p) && (p->pid == pid))
-				/* TID found in list */
-				return p;
-
-			if ((p->tgid == tgid_p) && (p->pid > pid))
-				/* Stop now to insert TID in list */
-				break;
-			if (p->tgid != tgid_p)
-				/* End of TID list: insert TID here */
-				break;
-
-			plist = &(p->next);
-		}
-	}
-
-	/* PID not found */
-	ps = *plist;
-
-	/* Add PID to the list */
-	if ((*plist = (struct st_pid *) malloc(sizeof(struct st_pid))) == NULL) {
-		perror("malloc");
-		exit(4);
 	}
-	memset(*plist, 0, sizeof(struct st_pid));
 
-	p = *plist;
-	for (i = 0; i < 3; i++) {
-		if ((p->pstats[i] = (struct pid_stats *) malloc(sizeof(struct pid_stats))) == NULL) {
-			perror("malloc");
-			exit(4);
-		}
-		memset(p->pstats[i], 0, PID_STATS_SIZE);
-	}
-	p->pid = pid;
-	p->next = ps;
-	if (tgid_p) {
-		p->tgid = tgid_p;
-	}
+	/* PID not found: Add it to the list */
+	*plist = new_pid(pid, NULL, *plist);
 
-	return p;
+	return *plist;
 }
 
 /*
@@ -359,7 +579,7 @@ struct st_pid *add_list_pid(struct st_pid **plist, pid_t pid, pid_t tgid)
  */
 char *get_tcmd(struct st_pid *plist)
 {
-	if (DISPLAY_CMDLINE(pidflag) && strlen(plist->cmdline) && !plist->tgid)
+	if (DISPLAY_CMDLINE(pidflag) && plist->cmdline[0] && !plist->tgid)
 		/* Option "-l" used */
 		return plist->cmdline;
 	else
@@ -436,7 +656,8 @@ int read_proc_pid_stat(pid_t pid, struct st_pid *plist,
 	int fd, sz, rc, commsz;
 	char filename[128];
 	static char buffer[1024 + 1];
-	char *start, *end;
+	char *start, *end, *comm;
+	unsigned long long starttime;
 	struct pid_stats *pst = plist->pstats[curr];
 
 	if (tgid) {
@@ -464,25 +685,44 @@ int read_proc_pid_stat(pid_t pid, struct st_pid *plist,
 	commsz = end - start;
 	if (commsz >= MAX_COMM_LEN)
 		return 1;
-	memcpy(plist->comm, start, commsz);
-	plist->comm[commsz] = '\0';
+	comm = start;
 	start = end + 2;
 
 	rc = sscanf(start,
 		    "%*s %*d %*d %*d %*d %*d %*u %llu %llu"
-		    " %llu %llu %llu %llu %lld %lld %*d %*d %u %*u %*d %llu %llu"
-		    " %*u %*u %*u %*u %*u %*u %*u %*u %*u %*u %*u %*u %*u"
+		    " %llu %llu %llu %llu %lld %lld %*d %*d %u %*u %llu %llu %llu"
+		    " %*u %*u %*u %llu %*u %*u %*u %*u %*u %*u %*u %*u %*u"
 		    " %*u %u %u %u %llu %llu %lld\n",
 		    &pst->minflt, &pst->cminflt, &pst->majflt, &pst->cmajflt,
 		    &pst->utime,  &pst->stime, &pst->cutime, &pst->cstime,
-		    thread_nr, &pst->vsz, &pst->rss, &pst->processor,
-		    &pst->priority, &pst->policy,
+		    thread_nr, &starttime, &pst->vsz, &pst->rss, &plist->startstack,
+		    &pst->processor, &pst->priority, &pst->policy,
 		    &pst->blkio_swapin_delays, &pst->gtime, &pst->cgtime);
 
-	if (rc < 15)
+	if (rc < 17)
 		return 1;
 
-	if (rc < 17) {
+	/*
+	 * Command name and command line are saved only once for a given task.
+	 * A task is identified by its PID and its start time, so that a PID which
+	 * has been reused is detected. The command line is read again only if
+	 * the command name has changed (the task has called exec()).
+	 */
+	if (plist->starttime != starttime) {
+		/* New task, or PID reused by another task */
+		plist->starttime = starttime;
+		release_string(plist->comm);
+		plist->comm = intern_string(comm, commsz);
+		plist->flags &= ~(F_CMDLINE_READ + F_PID_FULL_READ);
+	}
+	else if (strncmp(plist->comm, comm, commsz) || plist->comm[commsz]) {
+		/* Task has called exec() */
+		release_string(plist->comm);
+		plist->comm = intern_string(comm, commsz);
+		plist->flags &= ~F_CMDLINE_READ;
+	}
+
+	if (rc < 19) {
 		/* gtime and cgtime fields are unavailable in file */
 		pst->gtime = pst->cgtime = 0;
 	}
@@ -599,7 +839,8 @@ int read_proc_pid_status(pid_t pid, struct st_pid *plist, pid_t tgid, int curr)
 
 /*
  *****************************************************************************
- * Read information from /proc/#[/task/##}/smaps.
+ * Read information from /proc/#[/task/##}/smaps: Stack size, and amounts of
+ * stack memory referenced by the task and present in RAM.
  *
  * @pid		Process whose stats are to be read.
  * @plist	Pointer on the linked list where PID is saved.
@@ -628,7 +869,7 @@ int read_proc_pid_smap(pid_t pid, struct st_pid *plist, pid_t tgid, int curr)
 		/* No such process */
 		return 1;
 
-	while ((state < 3) && (fgets(line, sizeof(line), fp) != NULL)) {
+	while ((state < 4) && (fgets(line, sizeof(line), fp) != NULL)) {
 
 		switch (state) {
 			case 0:
@@ -643,9 +884,15 @@ int read_proc_pid_smap(pid_t pid, struct st_pid *plist, pid_t tgid, int curr)
 				}
 				break;
 			case 2:
+				if (!strncmp(line, "Rss:", 4)) {
+					sscanf(line + sizeof("Rss:"), "%lu", &pst->stack_res);
+					state = 3;
+				}
+				break;
+			case 3:
 				if (strstr(line, "Referenced:")) {
 					sscanf(line + sizeof("Referenced:"), "%lu", &pst->stack_ref);
-					state = 3;
+					state = 4;
 				}
 				break;
 		}
@@ -656,6 +903,111 @@ int read_proc_pid_smap(pid_t pid, struct st_pid *plist, pid_t tgid, int curr)
 	return 0;
 }
 
+/*
+ *****************************************************************************
+ * Read stack size and resident stack memory without using
+ * /proc/#[/task/##]/smaps, whose contents require the kernel to walk the
+ * page tables of every mapping of the process. The stack mapping is found in
+ * /proc/#[/task/##]/maps (it is labelled "[stack]" and contains the address
+ * of the start of the stack given in /proc/#/stat), then only the pages of
+ * this range are queried in /proc/#[/task/##]/pagemap. The pagemap file
+ * tells which pages are present in RAM, but not which ones have been
+ * referenced: This is used only with option --stack-res.
+ *
+ * IN:
+ * @pid		Process whose stats are to be read.
+ * @plist	Pointer on the linked list where PID is saved.
+ * @tgid	If != 0, thread whose stats are to be read.
+ * @curr	Index in array for current sample statistics.
+ *
+ * RETURNS:
+ * 0 if stats have been successfully read, and 1 otherwise (e.g. maps or
+ * pagemap files are unavailable or not readable).
+ *****************************************************************************
+ */
+int read_proc_pid_stack(pid_t pid, struct st_pid *plist, pid_t tgid, int curr)
+{
+	FILE *fp;
+	int fd, i, found = FALSE, bol, eol = TRUE;
+	ssize_t sz;
+	char filename[128], line[512];
+	unsigned long long start, end, pg_size, pg_first, pg_nr, pg_ref = 0;
+	unsigned long long pm[512];
+	struct pid_stats *pst = plist->pstats[curr];
+
+	if (tgid) {
+		sprintf(filename, TASK_MAPS, tgid, pid);
+	}
+	else {
+		sprintf(filename, PID_MAPS, pid);
+	}
+
+	if ((fp = fopen(filename, "r")) == NULL)
+		return 1;
+
+	/* Look for the stack mapping. No page table walk is needed to get this list */
+	while (fgets(line, sizeof(line), fp) != NULL) {
+
+		/* Skip the end of lines longer than the buffer */
+		bol = eol;
+		eol = (line[strlen(line) - 1] == '\n');
+		if (!bol || (sscanf(line, "%llx-%llx", &start, &end) != 2))
+			continue;
+
+		if (strstr(line, "[stack]") ||
+		    (plist->startstack && (plist->startstack >= start) &&
+		     (plist->startstack < end))) {
+			found = TRUE;
+			break;
+		}
+	}
+
+	fclose(fp);
+
+	if (!found)
+		return 1;
+
+	if (tgid) {
+		sprintf(filename, TASK_PAGEMAP, tgid, pid);
+	}
+	else {
+		sprintf(filename, PID_PAGEMAP, pid);
+	}
+
+	if ((fd = open(filename, O_RDONLY)) < 0)
+		return 1;
+
+	/* Read the pagemap entries (one per page) for the stack range only */
+	pg_size = 1024ULL << kb_shift;
+	pg_first = start / pg_size;
+	pg_nr = (end - start) / pg_size;
+
+	while (pg_nr) {
+		sz = pread(fd, pm, (pg_nr < 512 ? pg_nr : 512) * sizeof(pm[0]),
+			   (off_t) (pg_first * sizeof(pm[0])));
+		if (sz <= 0) {
+			close(fd);
+			return 1;
+		}
+
+		for (i = 0; i < sz / (ssize_t) sizeof(pm[0]); i++) {
+			if (pm[i] & PM_PRESENT) {
+				pg_ref++;
+			}
+		}
+		pg_first += sz / sizeof(pm[0]);
+		pg_nr -= sz / sizeof(pm[0]);
+	}
+
+	close(fd);
+
+	/* Save values in kB */
+	pst->stack_size = (end - start) >> 10;
+	pst->stack_res = PG_TO_KB(pg_ref);
+
+	return 0;
+}
+
 /*
  *****************************************************************************
  * Read process command line from /proc/#[/task/##]/cmdline.
@@ -707,13 +1059,14 @@ int read_proc_pid_cmdline(pid_t pid, struct st_pid *plist, pid_t tgid)
 				line[i] = ' ';
 			}
 		}
-		strncpy(plist->cmdline, line, sizeof(plist->cmdline) - 1);
-		plist->cmdline[sizeof(plist->cmdline) - 1] = '\0';
-	}
-	else {
-		/* proc/.../cmdline was empty */
-		plist->cmdline[0] = '\0';
 	}
+	/* If /proc/.../cmdline was empty, then command line is an empty string */
+	release_string(plist->cmdline);
+	plist->cmdline = intern_string(line, strlen(line));
+
+	/* Command line will be kept until the task calls exec() */
+	plist->flags |= F_CMDLINE_READ;
+
 	return 0;
 }
 
@@ -779,11 +1132,36 @@ int read_proc_pid_io(pid_t pid, struct st_pid *plist, pid_t tgid, int curr)
 
 /*
  ***************************************************************************
- * Count number of file descriptors in /proc/#[/task/##]/fd directory.
+ * Get the buffer used to read directory entries with getdents64().
+ * It is allocated once and then reused.
  *
- * IN:
- * @pid		Process whose stats are to be read.
- * @plist	Pointer on the linked list where PID is saved.
+ * RETURNS:
+ * Pointer on a buffer of DENTS_BUF_SIZE bytes.
+ ***************************************************************************
+ */
+char *get_dents_buf(void)
+{
+	static char *dbuf = NULL;
+
+	if (!dbuf && ((dbuf = (char *) malloc(DENTS_BUF_SIZE)) == NULL)) {
+		perror("malloc");
+		exit(4);
+	}
+
+	return dbuf;
+}
+
+/*
+ ***************************************************************************
+ * Count number of file descriptors in /proc/#[/task/##]/fd directory.
+ * Recent kernels (6.2 and later) report this number as the size of the
+ * directory, so use it when available. Else count the entries of the
+ * directory with getdents64(), but don't spend more than FD_NR_BUDGET
+ * microseconds doing this: Once exceeded, the last known value is used.
+ *
+ * IN:
+ * @pid		Process whose stats are to be read.
+ * @plist	Pointer on the linked list where PID is saved.
  * @tgid	If != 0, thread whose stats are to be read.
  * @curr	Index in array for current sample statistics.
  *
@@ -796,9 +1174,15 @@ int read_proc_pid_io(pid_t pid, struct st_pid *plist, pid_t tgid, int curr)
  */
 int read_proc_pid_fd(pid_t pid, struct st_pid *plist, pid_t tgid, int curr)
 {
-	DIR *dir;
-	struct dirent *drp;
+	int fd;
+	long nread, pos;
+	unsigned int fd_nr = 0;
 	char filename[128];
+	char *dbuf;
+	struct stat st;
+	struct statfs stf;
+	struct timespec ts_start, ts_now;
+	struct linux_dirent64 *de;
 	struct pid_stats *pst = plist->pstats[curr];
 
 	if (tgid) {
@@ -808,126 +1192,927 @@ int read_proc_pid_fd(pid_t pid, struct st_pid *plist, pid_t tgid, int curr)
 		sprintf(filename, PID_FD, pid);
 	}
 
-	if ((dir = opendir(filename)) == NULL) {
+	if ((fd = open(filename, O_RDONLY | O_DIRECTORY)) < 0) {
 		/* Cannot read fd directory */
 		plist->flags |= F_NO_PID_FD;
 		return 0;
 	}
 
-	pst->fd_nr = 0;
+	/*
+	 * Size of the directory is the number of file descriptors on recent kernels.
+	 * Older ones return 0 (and a process may have no fd at all): Count them then.
+	 */
+	if (!fstatfs(fd, &stf) && (stf.f_type == PROC_SUPER_MAGIC) &&
+	    !fstat(fd, &st) && (st.st_size > 0)) {
+		close(fd);
+		pst->fd_nr = plist->last_fd_nr = (unsigned int) st.st_size;
+		plist->flags &= ~F_NO_PID_FD;
+		return 0;
+	}
+
+	dbuf = get_dents_buf();
+
+	clock_gettime(CLOCK_MONOTONIC, &ts_start);
+
+	/* Count number of entries in fd directory */
+	while ((nread = syscall(SYS_getdents64, fd, dbuf, DENTS_BUF_SIZE)) > 0) {
+
+		for (pos = 0; pos < nread; pos += de->d_reclen) {
+			de = (struct linux_dirent64 *) (dbuf + pos);
+			if (isdigit(de->d_name[0])) {
+				fd_nr++;
+			}
+		}
+
+		/*
+		 * Stop counting if it takes too long, but only if a complete
+		 * count exists for the task: A partial count would be displayed
+		 * as if it were the right value.
+		 */
+		if (!plist->last_fd_nr)
+			continue;
+
+		clock_gettime(CLOCK_MONOTONIC, &ts_now);
+		if ((ts_now.tv_sec - ts_start.tv_sec) * 1000000 +
+		    (ts_now.tv_nsec - ts_start.tv_nsec) / 1000 > FD_NR_BUDGET) {
+			/* Too many fds: Keep last known value */
+			close(fd);
+			pst->fd_nr = plist->last_fd_nr;
+			plist->flags &= ~F_NO_PID_FD;
+			return 0;
+		}
+	}
+
+	close(fd);
+
+	if (nread < 0) {
+		/* Process has terminated */
+		plist->flags |= F_NO_PID_FD;
+		return 0;
+	}
+
+	pst->fd_nr = plist->last_fd_nr = fd_nr;
+	plist->flags &= ~F_NO_PID_FD;
+
+	return 0;
+}
+
+/*
+ ***************************************************************************
+ * Copy the statistics which are not read from /proc/#[/task/##]/stat from
+ * previous sample to current one. Used with option --lazy for tasks that
+ * have been idle during the interval.
+ *
+ * IN:
+ * @pstc	Structure with statistics for current sample.
+ * @pstp	Structure with statistics for previous sample.
+ ***************************************************************************
+ */
+void carry_pid_stats(struct pid_stats *pstc, struct pid_stats *pstp)
+{
+	/* Time when the values below were actually read */
+	pstc->rd_uptime = pstp->rd_uptime;
+
+	/* From /proc/#/schedstat */
+	pstc->wtime = pstp->wtime;
+
+	/* From /proc/#/status */
+	pstc->threads = pstp->threads;
+	pstc->nvcsw = pstp->nvcsw;
+	pstc->nivcsw = pstp->nivcsw;
+
+	/* From /proc/#/smaps (or maps) */
+	pstc->stack_size = pstp->stack_size;
+	pstc->stack_ref = pstp->stack_ref;
+	pstc->stack_res = pstp->stack_res;
+
+	/* From /proc/#/fd */
+	pstc->fd_nr = pstp->fd_nr;
+
+	/* From /proc/#/io */
+	pstc->read_bytes = pstp->read_bytes;
+	pstc->write_bytes = pstp->write_bytes;
+	pstc->cancelled_write_bytes = pstp->cancelled_write_bytes;
+}
+
+/*
+ ***************************************************************************
+ * Get the interval of time over which the statistics not read from
+ * /proc/#[/task/##]/stat have changed. This is longer than the interval
+ * between the two samples when the statistics were carried forward for
+ * previous sample (option --lazy), so that the changes made while the
+ * task was considered idle are not displayed as if they had happened
+ * during the last interval only.
+ *
+ * IN:
+ * @pstc	Structure with statistics for current sample.
+ * @pstp	Structure with statistics for previous sample.
+ * @itv		Interval of time between the two samples in 1/100th of a
+ *		second.
+ *
+ * RETURNS:
+ * Interval of time in 1/100th of a second.
+ ***************************************************************************
+ */
+unsigned long long get_pid_itv(struct pid_stats *pstc, struct pid_stats *pstp,
+			       unsigned long long itv)
+{
+	if (!pstp->rd_uptime || (pstc->rd_uptime == pstp->rd_uptime))
+		/* New task, or statistics carried forward (no change) */
+		return itv;
+
+	return get_interval(pstp->rd_uptime, pstc->rd_uptime);
+}
+
+/*
+ ***************************************************************************
+ * Read various stats for given PID.
+ *
+ * IN:
+ * @pid		Process whose stats are to be read.
+ * @plist	Pointer on the linked list where PID is saved.
+ * @tgid	If !=0, thread whose stats are to be read.
+ * @curr	Index in array for current sample statistics.
+ *
+ * OUT:
+ * @thread_nr	Number of threads of the process.
+ *
+ * RETURNS:
+ * 0 if stats have been successfully read, and 1 otherwise.
+ ***************************************************************************
+ */
+int read_pid_stats(pid_t pid, struct st_pid *plist, unsigned int *thread_nr,
+		   pid_t tgid, int curr)
+{
+	struct pid_stats *pstc, *pstp;
+
+	if (read_proc_pid_stat(pid, plist, thread_nr, tgid, curr))
+		return 1;
+
+	if (DISPLAY_CMDLINE(pidflag)) {
+		if (plist->tgid) {
+			/* Threads share the command line of their leader */
+			if (plist->cmdline != plist->tgid->cmdline) {
+				release_string(plist->cmdline);
+				plist->cmdline = share_string(plist->tgid->cmdline);
+			}
+		}
+		else if (!IS_CMDLINE_READ(plist->flags)) {
+			if (read_proc_pid_cmdline(pid, plist, tgid))
+				return 1;
+		}
+	}
+
+	if (plist->tgid && FAST_THREADS(pidflag) && !DISPLAY_ALL_THREAD_FILES(actflag)) {
+		/*
+		 * Thread fast path (option --fast-threads): When only statistics
+		 * from /proc/#/task/##/stat (and possibly schedstat) are needed,
+		 * don't read the other files. The thread is assumed to have the
+		 * same owner as its leader.
+		 */
+		pstc = plist->pstats[curr];
+		pstp = plist->pstats[!curr];
+
+		plist->uid = plist->tgid->uid;
+		carry_pid_stats(pstc, pstp);
+
+		if (DISPLAY_CPU(actflag)) {
+			read_proc_pid_sched(pid, plist, tgid, curr);
+		}
+		/* Values displayed from other files than stat are all read */
+		pstc->rd_uptime = uptime_cs[curr];
+		return 0;
+	}
+
+	if (LAZY_READ(pidflag) && IS_PID_FULL_READ(plist->flags)) {
+		pstc = plist->pstats[curr];
+		pstp = plist->pstats[!curr];
+
+		if ((pstc->utime == pstp->utime) && (pstc->stime == pstp->stime) &&
+		    (pstc->majflt == pstp->majflt) && (pstc->minflt == pstp->minflt)) {
+			/*
+			 * Task has been idle during the interval: Don't read the
+			 * other files and use the values from previous sample.
+			 */
+			carry_pid_stats(pstc, pstp);
+			return 0;
+		}
+	}
+
+	/*
+	 * No need to test the return code here: Not finding
+	 * the schedstat files shouldn't make pidstat stop.
+	 */
+	read_proc_pid_sched(pid, plist, tgid, curr);
+
+	if (read_proc_pid_status(pid, plist, tgid, curr))
+		return 1;
+
+	if (DISPLAY_STACK(actflag)) {
+		/*
+		 * Referenced stack memory is only available from smaps file.
+		 * Resident stack memory can be read much faster from pagemap.
+		 */
+		if ((!STACK_RESIDENT(pidflag) || read_proc_pid_stack(pid, plist, tgid, curr)) &&
+		    read_proc_pid_smap(pid, plist, tgid, curr))
+			return 1;
+	}
+
+	if (DISPLAY_KTAB(actflag)) {
+		if (read_proc_pid_fd(pid, plist, tgid, curr))
+			return 1;
+	}
+
+	plist->flags |= F_PID_FULL_READ;
+	pstc = plist->pstats[curr];
+	pstc->rd_uptime = uptime_cs[curr];
+
+	if (DISPLAY_IO(actflag))
+		/* Assume that /proc/#/task/#/io exists! */
+		return (read_proc_pid_io(pid, plist, tgid, curr));
+
+	return 0;
+}
+
+/*
+ ***************************************************************************
+ * Compare two TIDs. Used with qsort().
+ ***************************************************************************
+ */
+int cmp_tid(const void *a, const void *b)
+{
+	pid_t ta = *((const pid_t *) a), tb = *((const pid_t *) b);
+
+	return (ta > tb) - (ta < tb);
+}
+
+/*
+ ***************************************************************************
+ * Read stats for threads in /proc/#/task directory.
+ * The directory entries are read in large batches with getdents64() (or
+ * from the "_list" file in test mode), then threads are processed in
+ * ascending order, so that each one can be inserted in list right after
+ * the previous one.
+ *
+ * IN:
+ * @pid		Process number whose threads stats are to be read.
+ * @plist	Pointer on the linked list where PID is saved.
+ * @curr	Index in array for current sample statistics.
+ ***************************************************************************
+ */
+void read_task_stats(pid_t pid, struct st_pid *plist, int curr)
+{
+	static pid_t *tids = NULL;
+	static int tids_sz = 0;
+	int i, tid_nr = 0;
+	char filename[128];
+	unsigned int thr_nr;
+	struct st_pid *tlist, *hint = NULL;
+#ifdef TEST
+	DIR *dir;
+	struct dirent *drp;
+#else
+	int fd;
+	long nread, pos;
+	char *dbuf;
+	struct linux_dirent64 *de;
+#endif
+
+	/* Open /proc/#/task directory */
+	sprintf(filename, PROC_TASK, pid);
+#ifdef TEST
+	if ((dir = __opendir(filename)) == NULL)
+		return;
+
+	while ((drp = __readdir(dir)) != NULL) {
+		if (!isdigit(drp->d_name[0]))
+			continue;
+
+		if (tid_nr >= tids_sz) {
+			tids_sz = tids_sz ? tids_sz * 2 : 256;
+			SREALLOC(tids, pid_t, (size_t) tids_sz * sizeof(pid_t));
+		}
+		tids[tid_nr++] = atoi(drp->d_name);
+	}
+
+	__closedir(dir);
+#else
+	if ((fd = open(filename, O_RDONLY | O_DIRECTORY)) < 0)
+		return;
+
+	dbuf = get_dents_buf();
+
+	while ((nread = syscall(SYS_getdents64, fd, dbuf, DENTS_BUF_SIZE)) > 0) {
+
+		for (pos = 0; pos < nread; pos += de->d_reclen) {
+			de = (struct linux_dirent64 *) (dbuf + pos);
+			if (!isdigit(de->d_name[0]))
+				continue;
+
+			if (tid_nr >= tids_sz) {
+				tids_sz = tids_sz ? tids_sz * 2 : 256;
+				SREALLOC(tids, pid_t, (size_t) tids_sz * sizeof(pid_t));
+			}
+			tids[tid_nr++] = atoi(de->d_name);
+		}
+	}
+
+	close(fd);
+#endif
+
+	qsort(tids, tid_nr, sizeof(pid_t), cmp_tid);
+
+	for (i = 0; i < tid_nr; i++) {
+
+		tlist = add_list_tid(plist, tids[i], &hint);
+		tlist->exist = TRUE;
+
+		if (read_pid_stats(tids[i], tlist, &thr_nr, pid, curr)) {
+			/* Thread doesn't exist */
+			tlist->exist = FALSE;
+		}
+	}
+}
+
+/*
+ ***************************************************************************
+ * Close the descriptor kept open on a cgroup directory (if any).
+ *
+ * IN:
+ * @cg		Cgroup structure.
+ ***************************************************************************
+ */
+void close_cgroup_fd(struct st_cgroup *cg)
+{
+	if (cg->dirfd >= 0) {
+		close(cg->dirfd);
+		cg->dirfd = -1;
+		cg_fd_nr--;
+	}
+}
+
+/*
+ ***************************************************************************
+ * Close descriptors kept open on cgroup directories until no more than
+ * @max of them remain open. Descriptors of the cgroups being read (i.e.
+ * the current cgroup and its ancestors) are still in use and are never
+ * closed.
+ *
+ * IN:
+ * @cg		Root of the cgroup tree.
+ * @max		Max number of descriptors to keep open.
+ ***************************************************************************
+ */
+void shrink_cgroup_fds(struct st_cgroup *cg, unsigned int max)
+{
+	for (; (cg != NULL) && (cg_fd_nr > max); cg = cg->sibling) {
+		shrink_cgroup_fds(cg->child, max);
+		if ((cg_fd_nr > max) && !cg->in_use) {
+			close_cgroup_fd(cg);
+		}
+	}
+}
+
+/*
+ ***************************************************************************
+ * Open a file or a directory located in a cgroup directory. If there are
+ * too many open files, keep less descriptors open on cgroup directories
+ * and try again.
+ *
+ * IN:
+ * @dirfd	Descriptor of the cgroup directory, or AT_FDCWD.
+ * @name	Name of the file or directory to open.
+ * @flags	Flags passed to openat().
+ *
+ * RETURNS:
+ * Descriptor opened on the file, or -1 (with errno set).
+ ***************************************************************************
+ */
+int openat_cgroup(int dirfd, char *name, int flags)
+{
+	int fd;
+
+	if (((fd = openat(dirfd, name, flags)) < 0) &&
+	    ((errno == EMFILE) || (errno == ENFILE)) && cg_fd_nr) {
+		/* Too many open files: Keep less descriptors open and try again */
+		cg_fd_max = cg_fd_nr / 2;
+		shrink_cgroup_fds(cg_root, cg_fd_max);
+		fd = openat(dirfd, name, flags);
+	}
+
+	return fd;
+}
+
+/*
+ ***************************************************************************
+ * Read the contents of a file located in a cgroup directory.
+ *
+ * IN:
+ * @dirfd	Descriptor of the cgroup directory.
+ * @name	Name of the file to read.
+ * @size	Size of the buffer.
+ *
+ * OUT:
+ * @buf		Buffer containing the null-terminated file contents.
+ *
+ * RETURNS:
+ * Number of bytes read, or -1 if the file couldn't be read.
+ ***************************************************************************
+ */
+ssize_t read_cgroup_file(int dirfd, char *name, char *buf, size_t size)
+{
+	int fd;
+	ssize_t sz, len = 0;
+
+	if ((fd = openat_cgroup(dirfd, name, O_RDONLY)) < 0)
+		return -1;
 
-	/* Count number of entries if fd directory */
-	while ((drp = readdir(dir)) != NULL) {
-		if (isdigit(drp->d_name[0])) {
-			(pst->fd_nr)++;
+	while ((len < size - 1) &&
+	       ((sz = read(fd, buf + len, size - 1 - len)) > 0)) {
+		len += sz;
+	}
+	close(fd);
+	buf[len] = '\0';
+
+	return len;
+}
+
+/*
+ ***************************************************************************
+ * Get the total stall time ("some" line) from a cgroup *.pressure file.
+ *
+ * IN:
+ * @dirfd	Descriptor of the cgroup directory.
+ * @name	Name of the pressure file.
+ *
+ * RETURNS:
+ * Total time (in microseconds) during which at least one task has been
+ * stalled, or 0 if the file doesn't exist.
+ ***************************************************************************
+ */
+unsigned long long read_cgroup_pressure(int dirfd, char *name)
+{
+	char buf[256], *t;
+	unsigned long long total = 0;
+
+	if ((read_cgroup_file(dirfd, name, buf, sizeof(buf)) > 0) &&
+	    !strncmp(buf, "some", 4) && ((t = strstr(buf, "total=")) != NULL)) {
+		sscanf(t + 6, "%llu", &total);
+	}
+
+	return total;
+}
+
+/*
+ ***************************************************************************
+ * Read CPU, memory, I/O and pressure statistics for a cgroup.
+ *
+ * IN:
+ * @dirfd	Descriptor of the cgroup directory.
+ * @cst		Structure where stats will be saved.
+ ***************************************************************************
+ */
+void read_cgroup_files(int dirfd, struct cg_stats *cst)
+{
+	static char buf[65536];
+	char *line, *t;
+	unsigned long long val;
+
+	memset(cst, 0, CG_STATS_SIZE);
+
+	if (DISPLAY_CPU(actflag)) {
+		if (read_cgroup_file(dirfd, CG_CPU_STAT, buf, sizeof(buf)) > 0) {
+			for (line = strtok(buf, "\n"); line; line = strtok(NULL, "\n")) {
+				if (!strncmp(line, "usage_usec ", 11)) {
+					sscanf(line + 11, "%llu", &cst->usage_usec);
+				}
+				else if (!strncmp(line, "user_usec ", 10)) {
+					sscanf(line + 10, "%llu", &cst->user_usec);
+				}
+				else if (!strncmp(line, "system_usec ", 12)) {
+					sscanf(line + 12, "%llu", &cst->system_usec);
+				}
+			}
+		}
+		cst->cpu_some_usec = read_cgroup_pressure(dirfd, CG_CPU_PRESSURE);
+	}
+
+	if (DISPLAY_MEM(actflag)) {
+		if (read_cgroup_file(dirfd, CG_MEM_CURRENT, buf, sizeof(buf)) > 0) {
+			sscanf(buf, "%llu", &cst->mem_current);
+		}
+		if (read_cgroup_file(dirfd, CG_MEM_STAT, buf, sizeof(buf)) > 0) {
+			for (line = strtok(buf, "\n"); line; line = strtok(NULL, "\n")) {
+				if (!strncmp(line, "anon ", 5)) {
+					sscanf(line + 5, "%llu", &cst->mem_anon);
+				}
+				else if (!strncmp(line, "file ", 5)) {
+					sscanf(line + 5, "%llu", &cst->mem_file);
+				}
+			}
+		}
+		cst->mem_some_usec = read_cgroup_pressure(dirfd, CG_MEM_PRESSURE);
+	}
+
+	if (DISPLAY_IO(actflag)) {
+		/* One line per device: Sum the values for all devices */
+		if (read_cgroup_file(dirfd, CG_IO_STAT, buf, sizeof(buf)) > 0) {
+			for (line = strtok(buf, "\n"); line; line = strtok(NULL, "\n")) {
+				if (((t = strstr(line, " rbytes=")) != NULL) &&
+				    (sscanf(t + 8, "%llu", &val) == 1)) {
+					cst->rbytes += val;
+				}
+				if (((t = strstr(line, " wbytes=")) != NULL) &&
+				    (sscanf(t + 8, "%llu", &val) == 1)) {
+					cst->wbytes += val;
+				}
+			}
+		}
+		cst->io_some_usec = read_cgroup_pressure(dirfd, CG_IO_PRESSURE);
+	}
+}
+
+/*
+ ***************************************************************************
+ * Compute the hash value of a cgroup from its parent and its name.
+ *
+ * IN:
+ * @parent	Parent cgroup, or NULL if this is the root cgroup.
+ * @name	Name of the cgroup directory.
+ *
+ * RETURNS:
+ * Hash value.
+ ***************************************************************************
+ */
+unsigned int hash_cgroup(struct st_cgroup *parent, char *name)
+{
+	unsigned int hash = parent ? parent->hash : 2166136261U;
+
+	/* FNV-1a hash of the path */
+	hash = (hash ^ '/') * 16777619U;
+	for (; *name; name++) {
+		hash = (hash ^ (unsigned char) *name) * 16777619U;
+	}
+
+	return hash;
+}
+
+/*
+ ***************************************************************************
+ * Look for a cgroup in the hash table.
+ *
+ * IN:
+ * @parent	Parent cgroup.
+ * @name	Name of the cgroup directory.
+ *
+ * RETURNS:
+ * Pointer on the cgroup structure, or NULL if not found.
+ ***************************************************************************
+ */
+struct st_cgroup *find_cgroup(struct st_cgroup *parent, char *name)
+{
+	unsigned int hash = hash_cgroup(parent, name);
+	struct st_cgroup *cg;
+
+	for (cg = cg_hash[hash % CG_HASH_SIZE]; cg != NULL; cg = cg->hnext) {
+		if ((cg->hash == hash) && (cg->parent == parent) && !strcmp(cg->name, name))
+			return cg;
+	}
+
+	return NULL;
+}
+
+/*
+ ***************************************************************************
+ * Allocate and init a new cgroup structure. The new cgroup is inserted
+ * in the hash table and at the beginning of the list of its parent's
+ * children: sort_cgroup_children() should then be called to keep this
+ * list sorted by name.
+ *
+ * IN:
+ * @parent	Parent cgroup, or NULL if this is the root cgroup.
+ * @name	Name of the cgroup directory.
+ *
+ * RETURNS:
+ * Pointer on the new structure.
+ ***************************************************************************
+ */
+struct st_cgroup *add_cgroup(struct st_cgroup *parent, char *name)
+{
+	struct st_cgroup *cg;
+	size_t len;
+
+	if ((cg = (struct st_cgroup *) malloc(sizeof(struct st_cgroup))) == NULL) {
+		perror("malloc");
+		exit(4);
+	}
+	memset(cg, 0, sizeof(struct st_cgroup));
+	cg->dirfd = -1;
+
+	len = (parent ? strlen(parent->path) : 0) + strlen(name) + 2;
+	if ((cg->path = (char *) malloc(len)) == NULL) {
+		perror("malloc");
+		exit(4);
+	}
+	if (!parent) {
+		strcpy(cg->path, "/");
+	}
+	else if (!strcmp(parent->path, "/")) {
+		snprintf(cg->path, len, "/%s", name);
+	}
+	else {
+		snprintf(cg->path, len, "%s/%s", parent->path, name);
+	}
+	cg->name = strrchr(cg->path, '/') + 1;
+
+	cg->parent = parent;
+	cg->hash = hash_cgroup(parent, cg->name);
+	cg->hnext = cg_hash[cg->hash % CG_HASH_SIZE];
+	cg_hash[cg->hash % CG_HASH_SIZE] = cg;
+
+	if (parent) {
+		cg->sibling = parent->child;
+		parent->child = cg;
+	}
+
+	return cg;
+}
+
+/*
+ ***************************************************************************
+ * Compare the names of two cgroups (used by qsort()).
+ *
+ * IN:
+ * @a		Pointer on the first cgroup structure pointer.
+ * @b		Pointer on the second cgroup structure pointer.
+ *
+ * RETURNS:
+ * Result of the comparison of the names.
+ ***************************************************************************
+ */
+int cmp_cgroup_name(const void *a, const void *b)
+{
+	return strcmp((*(struct st_cgroup **) a)->name,
+		      (*(struct st_cgroup **) b)->name);
+}
+
+/*
+ ***************************************************************************
+ * Sort the list of the children of a cgroup by name.
+ *
+ * IN:
+ * @cg		Cgroup whose children are to be sorted.
+ ***************************************************************************
+ */
+void sort_cgroup_children(struct st_cgroup *cg)
+{
+	struct st_cgroup *child, **cga;
+	int nr = 0, i = 0;
+
+	for (child = cg->child; child != NULL; child = child->sibling) {
+		nr++;
+	}
+	if (nr < 2)
+		return;
+
+	if ((cga = (struct st_cgroup **) malloc(sizeof(struct st_cgroup *) * nr)) == NULL) {
+		perror("malloc");
+		exit(4);
+	}
+	for (child = cg->child; child != NULL; child = child->sibling) {
+		cga[i++] = child;
+	}
+
+	qsort(cga, nr, sizeof(struct st_cgroup *), cmp_cgroup_name);
+
+	cg->child = cga[0];
+	for (i = 0; i < nr - 1; i++) {
+		cga[i]->sibling = cga[i + 1];
+	}
+	cga[nr - 1]->sibling = NULL;
+
+	free(cga);
+}
+
+/*
+ ***************************************************************************
+ * Open a cgroup directory.
+ *
+ * IN:
+ * @cg		Cgroup whose directory is to be opened.
+ * @pfd		Descriptor opened on the directory of the parent cgroup,
+ *		or -1 if not available.
+ *
+ * RETURNS:
+ * Descriptor opened on the directory, or -1 (with errno set).
+ ***************************************************************************
+ */
+int open_cgroup_dir(struct st_cgroup *cg, int pfd)
+{
+	char filename[MAX_PF_NAME];
+
+	if (pfd >= 0)
+		return openat_cgroup(pfd, cg->name, O_RDONLY | O_DIRECTORY);
+
+	snprintf(filename, sizeof(filename), "%s%s", CGROUP_ROOT, cg->path);
+	filename[sizeof(filename) - 1] = '\0';
+
+	return openat_cgroup(AT_FDCWD, filename, O_RDONLY | O_DIRECTORY);
+}
+
+/*
+ ***************************************************************************
+ * Check that the descriptor kept open on a cgroup directory still refers
+ * to the cgroup with this name: The cgroup may have been removed, and
+ * possibly created again.
+ *
+ * IN:
+ * @cg		Cgroup structure.
+ * @pfd		Descriptor opened on the directory of the parent cgroup,
+ *		or -1 if not available.
+ *
+ * RETURNS:
+ * TRUE if the descriptor is still valid.
+ ***************************************************************************
+ */
+int check_cgroup_fd(struct st_cgroup *cg, int pfd)
+{
+	char filename[MAX_PF_NAME];
+	struct stat st;
+
+	if (pfd >= 0) {
+		if (fstatat(pfd, cg->name, &st, 0) < 0)
+			return FALSE;
+	}
+	else {
+		snprintf(filename, sizeof(filename), "%s%s", CGROUP_ROOT, cg->path);
+		filename[sizeof(filename) - 1] = '\0';
+		if (stat(filename, &st) < 0)
+			return FALSE;
+	}
+
+	return (st.st_ino == cg->ino);
+}
+
+/*
+ ***************************************************************************
+ * Free cgroup structures which no longer exist (with all their children).
+ *
+ * IN:
+ * @cgp		Address of the pointer on the first cgroup of the list.
+ * @force	Set to TRUE if all cgroup structures shall be freed.
+ ***************************************************************************
+ */
+void sfree_cgroup(struct st_cgroup **cgp, int force)
+{
+	struct st_cgroup *cg, **hp;
+
+	while (*cgp != NULL) {
+
+		cg = *cgp;
+		if (!cg->exist || force) {
+			*cgp = cg->sibling;
+			sfree_cgroup(&(cg->child), TRUE);
+			close_cgroup_fd(cg);
+			for (hp = &cg_hash[cg->hash % CG_HASH_SIZE]; *hp != NULL; hp = &((*hp)->hnext)) {
+				if (*hp == cg) {
+					*hp = cg->hnext;
+					break;
+				}
+			}
+			free(cg->path);
+			free(cg);
+		}
+		else {
+			cgp = &(cg->sibling);
 		}
 	}
-
-	closedir(dir);
-
-	plist->flags &= ~F_NO_PID_FD;
-
-	return 0;
 }
 
 /*
  ***************************************************************************
- * Read various stats for given PID.
+ * Read statistics for a cgroup and all its descendants. Descriptors opened
+ * on cgroup directories are kept and reused during next samples (up to
+ * @cg_fd_max of them), so that only the statistics files are opened then.
  *
  * IN:
- * @pid		Process whose stats are to be read.
- * @plist	Pointer on the linked list where PID is saved.
- * @tgid	If !=0, thread whose stats are to be read.
+ * @cg		Cgroup whose stats are to be read.
+ * @pfd		Descriptor opened on the directory of the parent cgroup,
+ *		or -1 if not available.
  * @curr	Index in array for current sample statistics.
- *
- * OUT:
- * @thread_nr	Number of threads of the process.
- *
- * RETURNS:
- * 0 if stats have been successfully read, and 1 otherwise.
  ***************************************************************************
  */
-int read_pid_stats(pid_t pid, struct st_pid *plist, unsigned int *thread_nr,
-		   pid_t tgid, int curr)
+void read_cgroup_tree(struct st_cgroup *cg, int pfd, int curr)
 {
-	if (read_proc_pid_stat(pid, plist, thread_nr, tgid, curr))
-		return 1;
+	int fd, new_cg = FALSE;
+	long nread, pos;
+	char *dbuf;
+	struct st_cgroup *child;
+	struct linux_dirent64 *de;
+	struct stat st;
+
+	if ((cg->dirfd >= 0) && !check_cgroup_fd(cg, pfd)) {
+		/* Cgroup has been removed (and possibly created again) */
+		close_cgroup_fd(cg);
+	}
 
-	/*
-	 * No need to test the return code here: Not finding
-	 * the schedstat files shouldn't make pidstat stop.
-	 */
-	read_proc_pid_sched(pid, plist, tgid, curr);
+	if ((fd = cg->dirfd) < 0) {
+		if ((fd = open_cgroup_dir(cg, pfd)) < 0) {
+			if ((errno != EMFILE) && (errno != ENFILE)) {
+				/* Cgroup has been removed */
+				cg->exist = FALSE;
+				return;
+			}
+			/*
+			 * Cgroup still exists but cannot be read: Keep it with
+			 * its previous statistics (and its child cgroups).
+			 */
+			cg->exist = TRUE;
+			memcpy(&(cg->cstats[curr]), &(cg->cstats[!curr]), CG_STATS_SIZE);
+			for (child = cg->child; child != NULL; child = child->sibling) {
+				read_cgroup_tree(child, -1, curr);
+			}
+			return;
+		}
 
-	if (DISPLAY_CMDLINE(pidflag) && !plist->cmdline[0]) {
-		if (read_proc_pid_cmdline(pid, plist, tgid))
-			return 1;
+		if (fstat(fd, &st) == 0) {
+			cg->ino = st.st_ino;
+		}
+		if (cg_fd_nr < cg_fd_max) {
+			/* Keep the descriptor for next samples */
+			cg->dirfd = fd;
+			cg_fd_nr++;
+		}
 	}
+	cg->exist = TRUE;
+	/* Descriptor is used until all the children have been read: Don't close it */
+	cg->in_use = TRUE;
 
-	if (read_proc_pid_status(pid, plist, tgid, curr))
-		return 1;
+	read_cgroup_files(fd, &(cg->cstats[curr]));
 
-	if (DISPLAY_STACK(actflag)) {
-		if (read_proc_pid_smap(pid, plist, tgid, curr))
-			return 1;
+	/* Look for child cgroups (subdirectories). They may have been created or removed */
+	for (child = cg->child; child != NULL; child = child->sibling) {
+		child->exist = FALSE;
 	}
 
-	if (DISPLAY_KTAB(actflag)) {
-		if (read_proc_pid_fd(pid, plist, tgid, curr))
-			return 1;
+	dbuf = get_dents_buf();
+	lseek(fd, 0, SEEK_SET);
+
+	while ((nread = syscall(SYS_getdents64, fd, dbuf, DENTS_BUF_SIZE)) > 0) {
+
+		for (pos = 0; pos < nread; pos += de->d_reclen) {
+			de = (struct linux_dirent64 *) (dbuf + pos);
+
+			if ((de->d_type != DT_DIR) || (de->d_name[0] == '.'))
+				continue;
+
+			if ((child = find_cgroup(cg, de->d_name)) == NULL) {
+				/* New cgroup */
+				child = add_cgroup(cg, de->d_name);
+				new_cg = TRUE;
+			}
+			child->exist = TRUE;
+		}
+	}
+	if (new_cg) {
+		/* Keep child cgroups sorted by name */
+		sort_cgroup_children(cg);
 	}
 
-	if (DISPLAY_IO(actflag))
-		/* Assume that /proc/#/task/#/io exists! */
-		return (read_proc_pid_io(pid, plist, tgid, curr));
+	/*
+	 * Now read stats for child cgroups (the getdents buffer is no longer used).
+	 * Their directories are opened relative to this one.
+	 */
+	for (child = cg->child; child != NULL; child = child->sibling) {
+		if (child->exist) {
+			read_cgroup_tree(child, fd, curr);
+		}
+	}
 
-	return 0;
+	cg->in_use = FALSE;
+	if (fd != cg->dirfd) {
+		close(fd);
+	}
+
+	/* Free cgroups which no longer exist */
+	sfree_cgroup(&(cg->child), FALSE);
 }
 
 /*
  ***************************************************************************
- * Read stats for threads in /proc/#/task directory.
+ * Save the stats of a cgroup tree collected for the first sample. They
+ * will be used to compute the average.
  *
  * IN:
- * @pid		Process number whose threads stats are to be read.
- * @plist	Pointer on the linked list where PID is saved.
- * @curr	Index in array for current sample statistics.
+ * @cg		Root of the cgroup tree.
  ***************************************************************************
  */
-void read_task_stats(pid_t pid, struct st_pid *plist, int curr)
+void save_cgroup_first_stats(struct st_cgroup *cg)
 {
-	DIR *dir;
-	pid_t tid;
-	struct dirent *drp;
-	char filename[128];
-	unsigned int thr_nr;
-	struct st_pid *tlist;
-
-	/* Open /proc/#/task directory */
-	sprintf(filename, PROC_TASK, pid);
-	if ((dir = __opendir(filename)) == NULL)
-		return;
-
-	while ((drp = __readdir(dir)) != NULL) {
-
-		if (!isdigit(drp->d_name[0])) {
-			continue;
-		}
-
-		tid = atoi(drp->d_name);
-
-		tlist = add_list_pid(&pid_list, tid, pid);
-		if (!tlist)
-			continue;
-		tlist->exist = TRUE;
-
-		if (read_pid_stats(tid, tlist, &thr_nr, pid, curr)) {
-			/* Thread doesn't exist */
-			tlist->exist = FALSE;
-		}
+	for (; cg != NULL; cg = cg->sibling) {
+		memcpy(&(cg->cstats[2]), &(cg->cstats[0]), CG_STATS_SIZE);
+		save_cgroup_first_stats(cg->child);
 	}
-
-	__closedir(dir);
 }
 
 /*
@@ -967,6 +2152,27 @@ void read_stats(int curr)
 			    st_cpu->cpu_steal + st_cpu->cpu_softirq;
 	free(st_cpu);
 
+	if (DISPLAY_CGROUP(pidflag)) {
+		/* Read stats per cgroup instead of per task */
+		if (!cg_root) {
+			cg_root = add_cgroup(NULL, "");
+		}
+		read_cgroup_tree(cg_root, -1, curr);
+		if (!cg_root->exist) {
+			fprintf(stderr, _("Cannot read cgroup hierarchy in %s\n"), CGROUP_ROOT);
+			exit(2);
+		}
+		return;
+	}
+
+	if (cmd_refresh) {
+		/* SIGUSR1 received: Command lines will be read again */
+		for (plist = pid_list; plist != NULL; plist = plist->next) {
+			plist->flags &= ~F_CMDLINE_READ;
+		}
+		cmd_refresh = FALSE;
+	}
+
 	if (DISPLAY_ALL_PID(pidflag)) {
 		DIR *dir;
 		struct dirent *drp;
@@ -1037,6 +2243,122 @@ void read_stats(int curr)
 	sfree_pid(&pid_list, FALSE);
 }
 
+/*
+ ***************************************************************************
+ * Check that a task has been active during the interval for at least one
+ * of the selected activities.
+ *
+ * IN:
+ * @prev	Index in array where stats used as reference are.
+ * @curr	Index in array for current sample statistics.
+ * @activity	Current activity to display (CPU, memory...).
+ * 		Can be more than one if stats are displayed on one line.
+ * @pflag	Flag indicating whether stats are to be displayed for
+ * 		individual tasks or for all their children.
+ * @plist	Pointer on the linked list where PID is saved.
+ *
+ * RETURNS:
+ * TRUE if the task has been active, FALSE otherwise.
+ ***************************************************************************
+ */
+int is_pid_active(int prev, int curr, unsigned int activity, unsigned int pflag,
+		  struct st_pid *plist)
+{
+	int isActive = FALSE;
+	struct pid_stats *pstc = plist->pstats[curr], *pstp = plist->pstats[prev];
+
+	/* Check that it's an "active" process */
+	if (DISPLAY_CPU(activity)) {
+		/* User time already includes guest time */
+		if ((pstc->utime != pstp->utime) ||
+		    (pstc->stime != pstp->stime)) {
+			isActive = TRUE;
+		}
+		else {
+			/*
+			 * Process is not active but if we are showing
+			 * child stats then we need to look there.
+			 */
+			if (DISPLAY_CHILD_STATS(pflag)) {
+				/* User time already includes guest time */
+				if ((pstc->cutime != pstp->cutime) ||
+				    (pstc->cstime != pstp->cstime)) {
+					isActive = TRUE;
+				}
+			}
+		}
+	}
+
+	if (DISPLAY_MEM(activity) && !isActive) {
+		if ((pstc->minflt != pstp->minflt) ||
+		    (pstc->majflt != pstp->majflt)) {
+			isActive = TRUE;
+		}
+		else {
+			if (DISPLAY_TASK_STATS(pflag)) {
+				if ((pstc->vsz != pstp->vsz) ||
+				    (pstc->rss != pstp->rss)) {
+					isActive = TRUE;
+				}
+			}
+			else if (DISPLAY_CHILD_STATS(pflag)) {
+				if ((pstc->cminflt != pstp->cminflt) ||
+				    (pstc->cmajflt != pstp->cmajflt)) {
+					isActive = TRUE;
+				}
+			}
+		}
+	}
+
+	if (DISPLAY_STACK(activity) && !isActive) {
+		if ((pstc->stack_size != pstp->stack_size) ||
+		    (pstc->stack_ref != pstp->stack_ref) ||
+		    (pstc->stack_res != pstp->stack_res)) {
+			isActive = TRUE;
+		}
+	}
+
+	if (DISPLAY_IO(activity) && !isActive) {
+		if (pstc->blkio_swapin_delays !=
+		     pstp->blkio_swapin_delays) {
+			isActive = TRUE;
+		}
+		if (!(NO_PID_IO(plist->flags)) && !isActive) {
+			/* /proc/#/io file should exist to check I/O stats */
+			if ((pstc->read_bytes  != pstp->read_bytes)  ||
+			    (pstc->write_bytes != pstp->write_bytes) ||
+			    (pstc->cancelled_write_bytes !=
+			     pstp->cancelled_write_bytes)) {
+				isActive = TRUE;
+			}
+		}
+	}
+
+	if (DISPLAY_CTXSW(activity) && !isActive) {
+		if ((pstc->nvcsw  != pstp->nvcsw) ||
+		    (pstc->nivcsw != pstp->nivcsw)) {
+			isActive = TRUE;
+		}
+	}
+
+	if (DISPLAY_RT(activity) && !isActive) {
+		if ((pstc->priority != pstp->priority) ||
+		    (pstc->policy != pstp->policy)) {
+			isActive = TRUE;
+		}
+	}
+
+	if (DISPLAY_KTAB(activity) && !isActive &&
+		!(NO_PID_FD(plist->flags))) {	/* /proc/#/fd directory should be readable */
+		if ((pstc->threads != pstp->threads) ||
+		    (pstc->fd_nr != pstp->fd_nr)) {
+			isActive = TRUE;
+		}
+	}
+
+	return isActive;
+}
+
 /*
  ***************************************************************************
  * Get current PID to display.
@@ -1068,7 +2390,6 @@ int get_pid_to_display(int prev, int curr, unsigned int activity, unsigned int p
 	int rc;
 	char *pc;
 	regex_t regex;
-	struct pid_stats *pstc = plist->pstats[curr], *pstp = plist->pstats[prev];
 
 	if (!plist->exist)
 		/* PID no longer exists */
@@ -1079,150 +2400,252 @@ int get_pid_to_display(int prev, int curr, unsigned int activity, unsigned int p
 		plist->flags &= ~F_PID_DISPLAYED;
 	}
 
+	if (top_nr && !IS_PID_TOP(plist->flags))
+		/* Not part of the tasks selected with option --top */
+		return -1;
+
 	if ((DISPLAY_ALL_PID(pidflag) || DISPLAY_TID(pidflag)) &&
-		DISPLAY_ACTIVE_PID(pidflag)) {
-		int isActive = FALSE;
+	    DISPLAY_ACTIVE_PID(pidflag) &&
+	    !is_pid_active(prev, curr, activity, pflag, plist))
+		/* PID isn't active for any of the activities */
+		return -1;
 
-		/* Check that it's an "active" process */
-		if (DISPLAY_CPU(activity)) {
-			/* User time already includes guest time */
-			if ((pstc->utime != pstp->utime) ||
-			    (pstc->stime != pstp->stime)) {
-				isActive = TRUE;
-			}
-			else {
-				/*
-				 * Process is not active but if we are showing
-				 * child stats then we need to look there.
-				 */
-				if (DISPLAY_CHILD_STATS(pflag)) {
-					/* User time already includes guest time */
-					if ((pstc->cutime != pstp->cutime) ||
-					    (pstc->cstime != pstp->cstime)) {
-						isActive = TRUE;
-					}
-				}
-			}
-		}
+	if (COMMAND_STRING(pidflag)) {
+		if (regcomp(&regex, commstr, REG_EXTENDED | REG_NOSUB) != 0)
+			/* Error in preparing regex structure */
+			return -1;
+
+		pc = get_tcmd(plist);	/* Get pointer on task's command string */
+		rc = regexec(&regex, pc, 0, NULL, 0);
+		regfree(&regex);
+
+		if (rc)
+			/* regex pattern not found in command name */
+			return -1;
+	}
+
+	if (PROCESS_STRING(pidflag)) {
+		if (!plist->tgid) {
+			/* This PID is a process ("thread group leader") */
+			if (regcomp(&regex, procstr, REG_EXTENDED | REG_NOSUB) != 0)
+				/* Error in preparing regex structure */
+				return -1;
+
+			pc = get_tcmd(plist);	/* Get pointer on task's command string */
+			rc = regexec(&regex, pc, 0, NULL, 0);
+			regfree(&regex);
+
+			if (rc)
+				/* regex pattern not found in command name */
+				return -1;
 
-		if (DISPLAY_MEM(activity) && !isActive) {
-			if ((pstc->minflt != pstp->minflt) ||
-			    (pstc->majflt != pstp->majflt)) {
-				isActive = TRUE;
-			}
-			else {
-				if (DISPLAY_TASK_STATS(pflag)) {
-					if ((pstc->vsz != pstp->vsz) ||
-					    (pstc->rss != pstp->rss)) {
-						isActive = TRUE;
-					}
-				}
-				else if (DISPLAY_CHILD_STATS(pflag)) {
-					if ((pstc->cminflt != pstp->cminflt) ||
-					    (pstc->cmajflt != pstp->cmajflt)) {
-						isActive = TRUE;
-					}
-				}
-			}
 		}
+		else if (!IS_PID_DISPLAYED(plist->tgid->flags))
+			/* This pid is a thread and is not part of a process to display */
+			return -1;
+	}
 
-		if (DISPLAY_STACK(activity) && !isActive) {
-			if ((pstc->stack_size != pstp->stack_size) ||
-			    (pstc->stack_ref != pstp->stack_ref)) {
-				isActive = TRUE;
-			}
+	if (USER_STRING(pidflag)) {
+		struct passwd *pwdent;
+
+		if ((pwdent = __getpwuid(plist->uid)) != NULL) {
+			if (strcmp(pwdent->pw_name, userstr))
+				/* This PID doesn't belong to user */
+				return -1;
 		}
+	}
+
+	plist->flags |= F_PID_DISPLAYED;
+	return 1;
+}
+
+/*
+ ***************************************************************************
+ * Get the value used to sort tasks with option --top.
+ *
+ * IN:
+ * @prev	Index in array where stats used as reference are.
+ * @curr	Index in array for current sample statistics.
+ * @plist	Pointer on the linked list where PID is saved.
+ *
+ * RETURNS:
+ * Value of the key selected with option --sort for current task.
+ ***************************************************************************
+ */
+unsigned long long get_top_value(int prev, int curr, struct st_pid *plist)
+{
+	struct pid_stats *pstc = plist->pstats[curr], *pstp = plist->pstats[prev];
+	unsigned long long itv = get_interval(uptime_cs[prev], uptime_cs[curr]);
+
+	/*
+	 * I/O and context switches may have been counted over a longer interval
+	 * (option --lazy): Scale them to the interval between the two samples.
+	 */
+	switch (top_key) {
+
+		case TOP_MEM:
+			return pstc->rss;
+
+		case TOP_IO:
+			if (NO_PID_IO(plist->flags))
+				return 0;
+			return ((pstc->read_bytes + pstc->write_bytes) -
+				(pstp->read_bytes + pstp->write_bytes)) *
+			       itv / get_pid_itv(pstc, pstp, itv);
+
+		case TOP_CSWCH:
+			return ((pstc->nvcsw + pstc->nivcsw) -
+				(pstp->nvcsw + pstp->nivcsw)) *
+			       itv / get_pid_itv(pstc, pstp, itv);
+
+		default:
+			/* User time already includes guest time */
+			return (pstc->utime + pstc->stime) -
+			       (pstp->utime + pstp->stime);
+	}
+}
+
+/*
+ ***************************************************************************
+ * Restore the heap property (smallest value at the root) of the heap used
+ * to select the tasks to display with option --top.
+ *
+ * IN:
+ * @heap	Heap of selected tasks.
+ * @nr		Number of entries in heap.
+ * @i		Index of the entry whose value has been increased.
+ ***************************************************************************
+ */
+void sift_down_top(struct top_ent *heap, unsigned int nr, unsigned int i)
+{
+	unsigned int c;
+	struct top_ent tmp;
 
-		if (DISPLAY_IO(activity) && !isActive) {
-			if (pstc->blkio_swapin_delays !=
-			     pstp->blkio_swapin_delays) {
-				isActive = TRUE;
-			}
-			if (!(NO_PID_IO(plist->flags)) && !isActive) {
-				/* /proc/#/io file should exist to check I/O stats */
-				if ((pstc->read_bytes  != pstp->read_bytes)  ||
-				    (pstc->write_bytes != pstp->write_bytes) ||
-				    (pstc->cancelled_write_bytes !=
-				     pstp->cancelled_write_bytes)) {
-					isActive = TRUE;
-				}
-			}
+	while ((c = 2 * i + 1) < nr) {
+		if ((c + 1 < nr) && (heap[c + 1].value < heap[c].value)) {
+			c++;
 		}
+		if (heap[i].value <= heap[c].value)
+			break;
 
-		if (DISPLAY_CTXSW(activity) && !isActive) {
-			if ((pstc->nvcsw  != pstp->nvcsw) ||
-			    (pstc->nivcsw != pstp->nivcsw)) {
-				isActive = TRUE;
-			}
-		}
+		tmp = heap[i];
+		heap[i] = heap[c];
+		heap[c] = tmp;
+		i = c;
+	}
+}
 
-		if (DISPLAY_RT(activity) && !isActive) {
-			if ((pstc->priority != pstp->priority) ||
-			    (pstc->policy != pstp->policy)) {
-				isActive = TRUE;
-			}
-		}
+/*
+ ***************************************************************************
+ * Select the @top_nr tasks with the highest values for the key entered
+ * with option --sort. A min-heap of @top_nr entries is used, so that the
+ * whole list of tasks doesn't need to be sorted. Selected tasks have their
+ * F_PID_TOP flag set. Options -C, -G and -U, and the activity of the tasks
+ * (if only active tasks are displayed), are taken into account so that
+ * selected tasks can actually be displayed. Tasks are selected again for
+ * each report, since a task may be active for one activity only.
+ *
+ * IN:
+ * @prev	Index in array where stats used as reference are.
+ * @curr	Index in array for current sample statistics.
+ * @activity	Activity of the report to display (CPU, memory...).
+ * 		Can be more than one if stats are displayed on one line.
+ * @pflag	Flag indicating whether stats are to be displayed for
+ * 		individual tasks or for all their children.
+ ***************************************************************************
+ */
+void select_top_pids(int prev, int curr, unsigned int activity, unsigned int pflag)
+{
+	unsigned int nr = 0, i, j;
+	unsigned long long value;
+	struct st_pid *plist;
+	struct passwd *pwdent;
+	regex_t comm_re, proc_re;
+	struct top_ent tmp;
 
-		if (DISPLAY_KTAB(activity) && !isActive &&
-			!(NO_PID_FD(plist->flags))) {	/* /proc/#/fd directory should be readable */
-			if ((pstc->threads != pstp->threads) ||
-			    (pstc->fd_nr != pstp->fd_nr)) {
-				isActive = TRUE;
-			}
-		}
+	if (!top_nr)
+		return;
 
-		/* If PID isn't active for any of the activities then return */
-		if (!isActive)
-			return -1;
+	if (!top_heap &&
+	    ((top_heap = (struct top_ent *) malloc(sizeof(struct top_ent) * top_nr)) == NULL)) {
+		perror("malloc");
+		exit(4);
 	}
 
-	if (COMMAND_STRING(pidflag)) {
-		if (regcomp(&regex, commstr, REG_EXTENDED | REG_NOSUB) != 0)
-			/* Error in preparing regex structure */
-			return -1;
+	for (plist = pid_list; plist != NULL; plist = plist->next) {
+		plist->flags &= ~F_PID_TOP;
+	}
 
-		pc = get_tcmd(plist);	/* Get pointer on task's command string */
-		rc = regexec(&regex, pc, 0, NULL, 0);
-		regfree(&regex);
+	if (COMMAND_STRING(pidflag) &&
+	    (regcomp(&comm_re, commstr, REG_EXTENDED | REG_NOSUB) != 0))
+		/* Error in preparing regex structure: No task can be displayed */
+		return;
 
-		if (rc)
-			/* regex pattern not found in command name */
-			return -1;
+	if (PROCESS_STRING(pidflag) &&
+	    (regcomp(&proc_re, procstr, REG_EXTENDED | REG_NOSUB) != 0)) {
+		if (COMMAND_STRING(pidflag)) {
+			regfree(&comm_re);
+		}
+		return;
 	}
 
-	if (PROCESS_STRING(pidflag)) {
-		if (!plist->tgid) {
-			/* This PID is a process ("thread group leader") */
-			if (regcomp(&regex, procstr, REG_EXTENDED | REG_NOSUB) != 0)
-				/* Error in preparing regex structure */
-				return -1;
+	for (plist = pid_list; plist != NULL; plist = plist->next) {
 
-			pc = get_tcmd(plist);	/* Get pointer on task's command string */
-			rc = regexec(&regex, pc, 0, NULL, 0);
-			regfree(&regex);
+		if (!plist->exist)
+			continue;
 
-			if (rc)
-				/* regex pattern not found in command name */
-				return -1;
+		if ((DISPLAY_ALL_PID(pidflag) || DISPLAY_TID(pidflag)) &&
+		    DISPLAY_ACTIVE_PID(pidflag) &&
+		    !is_pid_active(prev, curr, activity, pflag, plist))
+			/* Inactive tasks won't be displayed: Don't let them take a slot */
+			continue;
 
-		}
-		else if (!IS_PID_DISPLAYED(plist->tgid->flags))
-			/* This pid is a thread and is not part of a process to display */
-			return -1;
-	}
+		if (COMMAND_STRING(pidflag) &&
+		    regexec(&comm_re, get_tcmd(plist), 0, NULL, 0))
+			continue;
 
-	if (USER_STRING(pidflag)) {
-		struct passwd *pwdent;
+		if (PROCESS_STRING(pidflag) &&
+		    regexec(&proc_re, get_tcmd(plist->tgid ? plist->tgid : plist), 0, NULL, 0))
+			continue;
 
-		if ((pwdent = __getpwuid(plist->uid)) != NULL) {
-			if (strcmp(pwdent->pw_name, userstr))
-				/* This PID doesn't belong to user */
-				return -1;
+		if (USER_STRING(pidflag) &&
+		    ((pwdent = __getpwuid(plist->uid)) != NULL) &&
+		    strcmp(pwdent->pw_name, userstr))
+			continue;
+
+		value = get_top_value(prev, curr, plist);
+
+		if (nr < top_nr) {
+			/* Heap not full yet: Add task and move it up to its place */
+			top_heap[nr].value = value;
+			top_heap[nr].plist = plist;
+			i = nr++;
+			while (i && (top_heap[(i - 1) / 2].value > top_heap[i].value)) {
+				j = (i - 1) / 2;
+				tmp = top_heap[i];
+				top_heap[i] = top_heap[j];
+				top_heap[j] = tmp;
+				i = j;
+			}
+		}
+		else if (value > top_heap[0].value) {
+			/* Replace the smallest value selected so far */
+			top_heap[0].value = value;
+			top_heap[0].plist = plist;
+			sift_down_top(top_heap, nr, 0);
 		}
 	}
 
-	plist->flags |= F_PID_DISPLAYED;
-	return 1;
+	for (i = 0; i < nr; i++) {
+		top_heap[i].plist->flags |= F_PID_TOP;
+	}
+
+	if (COMMAND_STRING(pidflag)) {
+		regfree(&comm_re);
+	}
+	if (PROCESS_STRING(pidflag)) {
+		regfree(&proc_re);
+	}
 }
 
 /*
@@ -1325,7 +2748,7 @@ int write_pid_task_all_stats(int prev, int curr, int dis,
 			printf("  minflt/s  majflt/s     VSZ     RSS   %%MEM");
 		}
 		if (DISPLAY_STACK(actflag)) {
-			printf(" StkSize  StkRef");
+			printf(STACK_RESIDENT(pidflag) ? " StkSize  StkRes" : " StkSize  StkRef");
 		}
 		if (DISPLAY_IO(actflag)) {
 			printf("   kB_rd/s   kB_wr/s kB_ccwr/s iodelay");
@@ -1360,7 +2783,7 @@ int write_pid_task_all_stats(int prev, int curr, int dis,
 					    pstc->utime - pstc->gtime, itv * HZ / 100),
 				   SP_VALUE(pstp->stime,  pstc->stime, itv * HZ / 100),
 				   SP_VALUE(pstp->gtime,  pstc->gtime, itv * HZ / 100),
-				   SP_VALUE(pstp->wtime,  pstc->wtime, itv * HZ / 100),
+				   SP_VALUE(pstp->wtime,  pstc->wtime, get_pid_itv(pstc, pstp, itv) * HZ / 100),
 				   /* User time already includes guest time */
 				   IRIX_MODE_OFF(pidflag) ?
 				   SP_VALUE(pstp->utime + pstp->stime,
@@ -1385,7 +2808,8 @@ int write_pid_task_all_stats(int prev, int curr, int dis,
 		if (DISPLAY_STACK(actflag)) {
 			cprintf_u64(DISPLAY_UNIT(pidflag) ? UNIT_KILOBYTE : NO_UNIT, 2, 7,
 				    (unsigned long long) pstc->stack_size,
-				    (unsigned long long) pstc->stack_ref);
+				    (unsigned long long) (STACK_RESIDENT(pidflag) ? pstc->stack_res
+										  : pstc->stack_ref));
 		}
 
 		if (DISPLAY_IO(actflag)) {
@@ -1393,10 +2817,10 @@ int write_pid_task_all_stats(int prev, int curr, int dis,
 			{
 				double rbytes, wbytes, cbytes;
 
-				rbytes = S_VALUE(pstp->read_bytes,  pstc->read_bytes, itv);
-				wbytes = S_VALUE(pstp->write_bytes, pstc->write_bytes, itv);
+				rbytes = S_VALUE(pstp->read_bytes,  pstc->read_bytes, get_pid_itv(pstc, pstp, itv));
+				wbytes = S_VALUE(pstp->write_bytes, pstc->write_bytes, get_pid_itv(pstc, pstp, itv));
 				cbytes = S_VALUE(pstp->cancelled_write_bytes,
-						 pstc->cancelled_write_bytes, itv);
+						 pstc->cancelled_write_bytes, get_pid_itv(pstc, pstp, itv));
 				if (!DISPLAY_UNIT(pidflag)) {
 					rbytes /= 1024;
 					wbytes /= 1024;
@@ -1420,8 +2844,8 @@ int write_pid_task_all_stats(int prev, int curr, int dis,
 
 		if (DISPLAY_CTXSW(actflag)) {
 			cprintf_f(NO_UNIT, FALSE, 2, 9, 2,
-				  S_VALUE(pstp->nvcsw, pstc->nvcsw, itv),
-				  S_VALUE(pstp->nivcsw, pstc->nivcsw, itv));
+				  S_VALUE(pstp->nvcsw, pstc->nvcsw, get_pid_itv(pstc, pstp, itv)),
+				  S_VALUE(pstp->nivcsw, pstc->nivcsw, get_pid_itv(pstc, pstp, itv)));
 		}
 
 		if (DISPLAY_KTAB(actflag)) {
@@ -1576,7 +3000,7 @@ int write_pid_task_cpu_stats(int prev, int curr, int dis, int disp_avg,
 				    pstc->utime - pstc->gtime, itv * HZ / 100),
 			   SP_VALUE(pstp->stime, pstc->stime, itv * HZ / 100),
 			   SP_VALUE(pstp->gtime, pstc->gtime, itv * HZ / 100),
-			   SP_VALUE(pstp->wtime, pstc->wtime, itv * HZ / 100),
+			   SP_VALUE(pstp->wtime, pstc->wtime, get_pid_itv(pstc, pstp, itv) * HZ / 100),
 			   /* User time already includes guest time */
 			   IRIX_MODE_OFF(pidflag) ?
 			   SP_VALUE(pstp->utime + pstp->stime,
@@ -1874,7 +3298,8 @@ int write_pid_stack_stats(int prev, int curr, int dis, int disp_avg,
 
 	if (dis) {
 		PRINT_ID_HDR(prev_string, pidflag);
-		printf(" StkSize  StkRef  Command\n");
+		printf(STACK_RESIDENT(pidflag) ? " StkSize  StkRes  Command\n"
+					       : " StkSize  StkRef  Command\n");
 	}
 
 	for (plist = pid_list; plist != NULL; plist = plist->next) {
@@ -1889,6 +3314,7 @@ int write_pid_stack_stats(int prev, int curr, int dis, int disp_avg,
 		if (!disp_avg) {
 			plist->total_stack_size += pstc->stack_size;
 			plist->total_stack_ref  += pstc->stack_ref;
+			plist->total_stack_res  += pstc->stack_res;
 			plist->sk_asum_count += 1;
 		}
 
@@ -1901,12 +3327,15 @@ int write_pid_stack_stats(int prev, int curr, int dis, int disp_avg,
 		if (disp_avg) {
 			cprintf_f(DISPLAY_UNIT(pidflag) ? UNIT_KILOBYTE : NO_UNIT, FALSE, 2, 7, 0,
 				  (double) plist->total_stack_size / plist->sk_asum_count,
-				  (double) plist->total_stack_ref  / plist->sk_asum_count);
+				  (double) (STACK_RESIDENT(pidflag) ? plist->total_stack_res
+								    : plist->total_stack_ref) /
+				  plist->sk_asum_count);
 		}
 		else {
 			cprintf_u64(DISPLAY_UNIT(pidflag) ? UNIT_KILOBYTE : NO_UNIT, 2, 7,
 				    (unsigned long long) pstc->stack_size,
-				    (unsigned long long) pstc->stack_ref);
+				    (unsigned long long) (STACK_RESIDENT(pidflag) ? pstc->stack_res
+										  : pstc->stack_ref));
 		}
 
 		print_comm(plist);
@@ -1974,10 +3403,10 @@ int write_pid_io_stats(int prev, int curr, int dis, int disp_avg,
 		pstp = plist->pstats[prev];
 
 		if (!NO_PID_IO(plist->flags)) {
-			rbytes = S_VALUE(pstp->read_bytes,  pstc->read_bytes, itv);
-			wbytes = S_VALUE(pstp->write_bytes, pstc->write_bytes, itv);
+			rbytes = S_VALUE(pstp->read_bytes,  pstc->read_bytes, get_pid_itv(pstc, pstp, itv));
+			wbytes = S_VALUE(pstp->write_bytes, pstc->write_bytes, get_pid_itv(pstc, pstp, itv));
 			cbytes = S_VALUE(pstp->cancelled_write_bytes,
-					 pstc->cancelled_write_bytes, itv);
+					 pstc->cancelled_write_bytes, get_pid_itv(pstc, pstp, itv));
 			if (!DISPLAY_UNIT(pidflag)) {
 				rbytes /= 1024;
 				wbytes /= 1024;
@@ -2054,8 +3483,8 @@ int write_pid_ctxswitch_stats(int prev, int curr, int dis,
 		pstp = plist->pstats[prev];
 
 		cprintf_f(NO_UNIT, FALSE, 2, 9, 2,
-			  S_VALUE(pstp->nvcsw,  pstc->nvcsw,  itv),
-			  S_VALUE(pstp->nivcsw, pstc->nivcsw, itv));
+			  S_VALUE(pstp->nvcsw,  pstc->nvcsw, get_pid_itv(pstc, pstp, itv)),
+			  S_VALUE(pstp->nivcsw, pstc->nivcsw, get_pid_itv(pstc, pstp, itv)));
 
 		print_comm(plist);
 		again = 1;
@@ -2197,6 +3626,134 @@ int write_pid_ktab_stats(int prev, int curr, int dis, int disp_avg,
 	return again;
 }
 
+/*
+ ***************************************************************************
+ * Display statistics for a cgroup and all its descendants.
+ *
+ * IN:
+ * @cg		Cgroup whose stats are to be displayed.
+ * @prev	Index in array where stats used as reference are.
+ * @curr	Index in array for current sample statistics.
+ * @disp_avg	TRUE if average stats are displayed.
+ * @curr_string	String displayed at the beginning of current sample stats.
+ * 		This is the timestamp of the current sample, or "Average"
+ * 		when displaying average stats.
+ * @itv		Interval of time in 1/100th of a second.
+ ***************************************************************************
+ */
+void write_cgroup_tree_stats(struct st_cgroup *cg, int prev, int curr, int disp_avg,
+			     char *curr_string, unsigned long long itv)
+{
+	struct cg_stats *cstc, *cstp;
+	/* Time spent by all CPUs during the interval in us (option -I) */
+	unsigned long long itv_us = itv * 10000 * (IRIX_MODE_OFF(pidflag) && cpu_nr ? cpu_nr : 1);
+	double rbytes, wbytes;
+
+	for (; cg != NULL; cg = cg->sibling) {
+
+		if (!cg->exist)
+			continue;
+
+		cstc = &(cg->cstats[curr]);
+		cstp = &(cg->cstats[prev]);
+
+		printf("%-11s", curr_string);
+
+		if (DISPLAY_CPU(actflag)) {
+			cprintf_xpc(DISPLAY_UNIT(pidflag), XHIGH, 4, 7, 2,
+				    SP_VALUE(cstp->user_usec, cstc->user_usec, itv_us),
+				    SP_VALUE(cstp->system_usec, cstc->system_usec, itv_us),
+				    SP_VALUE(cstp->usage_usec, cstc->usage_usec, itv_us),
+				    SP_VALUE(cstp->cpu_some_usec, cstc->cpu_some_usec, itv * 10000));
+		}
+
+		if (DISPLAY_MEM(actflag)) {
+			if (disp_avg) {
+				cprintf_f(DISPLAY_UNIT(pidflag) ? UNIT_KILOBYTE : NO_UNIT, FALSE, 3, 9, 0,
+					  (double) (cg->total_mem_current >> 10) / cg->mem_asum_count,
+					  (double) (cg->total_mem_anon >> 10) / cg->mem_asum_count,
+					  (double) (cg->total_mem_file >> 10) / cg->mem_asum_count);
+				cprintf_xpc(DISPLAY_UNIT(pidflag), XHIGH, 1, 6, 2,
+					    tlmkb ?
+					    SP_VALUE(0, (cg->total_mem_current >> 10) / cg->mem_asum_count, tlmkb)
+					    : 0.0);
+			}
+			else {
+				/* This will be used to compute average */
+				cg->total_mem_current += cstc->mem_current;
+				cg->total_mem_anon += cstc->mem_anon;
+				cg->total_mem_file += cstc->mem_file;
+				cg->mem_asum_count += 1;
+
+				cprintf_u64(DISPLAY_UNIT(pidflag) ? UNIT_KILOBYTE : NO_UNIT, 3, 9,
+					    cstc->mem_current >> 10,
+					    cstc->mem_anon >> 10,
+					    cstc->mem_file >> 10);
+				cprintf_xpc(DISPLAY_UNIT(pidflag), XHIGH, 1, 6, 2,
+					    tlmkb ? SP_VALUE(0, cstc->mem_current >> 10, tlmkb) : 0.0);
+			}
+			cprintf_xpc(DISPLAY_UNIT(pidflag), XHIGH, 1, 6, 2,
+				    SP_VALUE(cstp->mem_some_usec, cstc->mem_some_usec, itv * 10000));
+		}
+
+		if (DISPLAY_IO(actflag)) {
+			rbytes = S_VALUE(cstp->rbytes, cstc->rbytes, itv);
+			wbytes = S_VALUE(cstp->wbytes, cstc->wbytes, itv);
+			if (!DISPLAY_UNIT(pidflag)) {
+				rbytes /= 1024;
+				wbytes /= 1024;
+			}
+			cprintf_f(DISPLAY_UNIT(pidflag) ? UNIT_BYTE : NO_UNIT, FALSE, 2, 9, 2,
+				  rbytes, wbytes);
+			cprintf_xpc(DISPLAY_UNIT(pidflag), XHIGH, 1, 6, 2,
+				    SP_VALUE(cstp->io_some_usec, cstc->io_some_usec, itv * 10000));
+		}
+
+		cprintf_s(IS_STR, "  %s\n", cg->path);
+
+		write_cgroup_tree_stats(cg->child, prev, curr, disp_avg, curr_string, itv);
+	}
+}
+
+/*
+ ***************************************************************************
+ * Display statistics for cgroups (option --cgroup).
+ *
+ * IN:
+ * @prev	Index in array where stats used as reference are.
+ * @curr	Index in array for current sample statistics.
+ * @dis		TRUE if a header line must be printed.
+ * @disp_avg	TRUE if average stats are displayed.
+ * @prev_string	String displayed at the beginning of a header line. This is
+ * 		the timestamp of the previous sample, or "Average" when
+ * 		displaying average stats.
+ * @curr_string	String displayed at the beginning of current sample stats.
+ * 		This is the timestamp of the current sample, or "Average"
+ * 		when displaying average stats.
+ * @itv		Interval of time in 1/100th of a second.
+ ***************************************************************************
+ */
+void write_cgroup_stats(int prev, int curr, int dis, int disp_avg,
+			char *prev_string, char *curr_string,
+			unsigned long long itv)
+{
+	if (dis) {
+		printf("\n%-11s", prev_string);
+		if (DISPLAY_CPU(actflag)) {
+			printf("    %%usr %%system    %%CPU   %%scpu");
+		}
+		if (DISPLAY_MEM(actflag)) {
+			printf("       MEM      ANON      FILE   %%MEM   %%smem");
+		}
+		if (DISPLAY_IO(actflag)) {
+			printf("   kB_rd/s   kB_wr/s    %%sio");
+		}
+		printf("  Cgroup\n");
+	}
+
+	write_cgroup_tree_stats(cg_root, prev, curr, disp_avg, curr_string, itv);
+}
+
 /*
  ***************************************************************************
  * Display statistics.
@@ -2232,12 +3789,21 @@ int write_stats_core(int prev, int curr, int dis, int disp_avg,
 
 	itv = get_interval(uptime_cs[prev], uptime_cs[curr]);
 
+	if (DISPLAY_CGROUP(pidflag)) {
+		/* Display stats per cgroup */
+		write_cgroup_stats(prev, curr, dis, disp_avg, prev_string, curr_string, itv);
+		return 1;
+	}
+
+	/* With option --top, tasks to display are selected before each report */
 	if (DISPLAY_ONELINE(pidflag)) {
 		if (DISPLAY_TASK_STATS(tskflag)) {
+			select_top_pids(prev, curr, actflag, P_TASK);
 			again += write_pid_task_all_stats(prev, curr, dis, prev_string, curr_string,
 							  itv, deltot_jiffies);
 		}
 		if (DISPLAY_CHILD_STATS(tskflag)) {
+			select_top_pids(prev, curr, actflag, P_CHILD);
 			again += write_pid_child_all_stats(prev, curr, dis, prev_string, curr_string);
 		}
 	}
@@ -2246,11 +3812,13 @@ int write_stats_core(int prev, int curr, int dis, int disp_avg,
 		if (DISPLAY_CPU(actflag)) {
 
 			if (DISPLAY_TASK_STATS(tskflag)) {
+				select_top_pids(prev, curr, P_A_CPU, P_TASK);
 				again += write_pid_task_cpu_stats(prev, curr, dis, disp_avg,
 								  prev_string, curr_string,
 								  itv, deltot_jiffies);
 			}
 			if (DISPLAY_CHILD_STATS(tskflag)) {
+				select_top_pids(prev, curr, P_A_CPU, P_CHILD);
 				again += write_pid_child_cpu_stats(prev, curr, dis, disp_avg,
 								   prev_string, curr_string);
 			}
@@ -2260,10 +3828,12 @@ int write_stats_core(int prev, int curr, int dis, int disp_avg,
 		if (DISPLAY_MEM(actflag)) {
 
 			if (DISPLAY_TASK_STATS(tskflag)) {
+				select_top_pids(prev, curr, P_A_MEM, P_TASK);
 				again += write_pid_task_memory_stats(prev, curr, dis, disp_avg,
 								     prev_string, curr_string, itv);
 			}
 			if (DISPLAY_CHILD_STATS(tskflag) && DISPLAY_MEM(actflag)) {
+				select_top_pids(prev, curr, P_A_MEM, P_CHILD);
 				again += write_pid_child_memory_stats(prev, curr, dis, disp_avg,
 								      prev_string, curr_string);
 			}
@@ -2271,30 +3841,35 @@ int write_stats_core(int prev, int curr, int dis, int disp_avg,
 
 		/* Display stack stats */
 		if (DISPLAY_STACK(actflag)) {
+			select_top_pids(prev, curr, P_A_STACK, P_NULL);
 			again += write_pid_stack_stats(prev, curr, dis, disp_avg,
 						       prev_string, curr_string);
 		}
 
 		/* Display I/O stats */
 		if (DISPLAY_IO(actflag)) {
+			select_top_pids(prev, curr, P_A_IO, P_NULL);
 			again += write_pid_io_stats(prev, curr, dis, disp_avg, prev_string,
 						    curr_string, itv);
 		}
 
 		/* Display context switches stats */
 		if (DISPLAY_CTXSW(actflag)) {
+			select_top_pids(prev, curr, P_A_CTXSW, P_NULL);
 			again += write_pid_ctxswitch_stats(prev, curr, dis, prev_string,
 							   curr_string, itv);
 		}
 
 		/* Display kernel table stats */
 		if (DISPLAY_KTAB(actflag)) {
+			select_top_pids(prev, curr, P_A_KTAB, P_NULL);
 			again += write_pid_ktab_stats(prev, curr, dis, disp_avg,
 						      prev_string, curr_string);
 		}
 
 		/* Display scheduling priority and policy information */
 		if (DISPLAY_RT(actflag)) {
+			select_top_pids(prev, curr, P_A_RT, P_NULL);
 			again += write_pid_rt_stats(prev, curr, dis, prev_string, curr_string);
 		}
 	}
@@ -2372,6 +3947,108 @@ int write_stats(int curr, int dis)
 				 cur_time[!curr], cur_time[curr]));
 }
 
+/*
+ ***************************************************************************
+ * Save PID stats to file (option -o). Raw values are saved: Rates are
+ * computed when the file is read by sadf. The first sample contains all
+ * the tasks. Then only the tasks which would be displayed are saved
+ * (e.g. only active tasks if option -p hasn't been entered): Values for
+ * other tasks haven't changed since they were last saved.
+ *
+ * IN:
+ * @prev	Index in array where stats used as reference are.
+ * @curr	Index in array for current sample statistics.
+ * @all		TRUE if all the tasks should be saved.
+ *
+ * RETURNS:
+ * 0 if all the processes to display have terminated.
+ * <> 0 if there are still some processes left to display.
+ ***************************************************************************
+ */
+int write_task_stats(int prev, int curr, int all)
+{
+	struct st_pid *plist;
+	struct pid_stats *pstc;
+	struct task_stats *ts;
+	struct task_sys_stats tss;
+	int nr = 0, again = 0;
+
+	if (top_nr && !all) {
+		/* Select the tasks to save */
+		select_top_pids(prev, curr, actflag, P_TASK);
+	}
+
+	for (plist = pid_list; plist != NULL; plist = plist->next) {
+
+		if (!plist->exist)
+			continue;
+		again = 1;
+
+		if (!all && (get_pid_to_display(prev, curr, actflag, P_TASK, plist) <= 0))
+			continue;
+
+		if (nr >= task_buf_nr) {
+			task_buf_nr = task_buf_nr ? task_buf_nr * 2 : 256;
+			SREALLOC(task_buf, struct task_stats, (size_t) task_buf_nr * TASK_STATS_SIZE);
+		}
+		ts = task_buf + nr++;
+		memset(ts, 0, TASK_STATS_SIZE);
+
+		pstc = plist->pstats[curr];
+		ts->utime      = pstc->utime;
+		ts->stime      = pstc->stime;
+		ts->gtime      = pstc->gtime;
+		ts->wtime      = pstc->wtime;
+		ts->minflt     = pstc->minflt;
+		ts->majflt     = pstc->majflt;
+		ts->vsz        = pstc->vsz;
+		ts->rss        = pstc->rss;
+		ts->stack_size = pstc->stack_size;
+		ts->stack_ref  = pstc->stack_ref;
+		ts->stack_res  = pstc->stack_res;
+		ts->read_bytes = pstc->read_bytes;
+		ts->write_bytes = pstc->write_bytes;
+		ts->cancelled_write_bytes = pstc->cancelled_write_bytes;
+		ts->blkio_swapin_delays   = pstc->blkio_swapin_delays;
+		ts->nvcsw      = pstc->nvcsw;
+		ts->nivcsw     = pstc->nivcsw;
+		ts->starttime  = plist->starttime;
+		ts->pid        = plist->pid;
+		ts->tgid       = plist->tgid ? plist->tgid->pid : 0;
+		ts->uid        = plist->uid;
+		ts->processor  = pstc->processor;
+		ts->priority   = pstc->priority;
+		ts->policy     = pstc->policy;
+		ts->threads    = pstc->threads;
+		ts->fd_nr      = pstc->fd_nr;
+		if (NO_PID_IO(plist->flags)) {
+			ts->flags |= TASK_F_NO_IO;
+		}
+		if (NO_PID_FD(plist->flags)) {
+			ts->flags |= TASK_F_NO_FD;
+		}
+		if (STACK_RESIDENT(pidflag)) {
+			ts->flags |= TASK_F_STK_RES;
+		}
+		if (plist->comm) {
+			strncpy(ts->comm, plist->comm, TASK_COMM_SIZE - 1);
+		}
+	}
+
+	memset(&tss, 0, TASK_SYS_STATS_SIZE);
+	tss.tlmkb  = tlmkb;
+	tss.act    = actflag;
+	tss.cpu_nr = cpu_nr;
+
+	if (write_task_record(ofd, uptime_cs[curr], &tss, task_buf, nr) < 0) {
+		fprintf(stderr, _("Cannot write data to system activity file: %s\n"),
+			strerror(errno));
+		exit(2);
+	}
+
+	return (DISPLAY_PID(pidflag) && !DISPLAY_ALL_PID(pidflag) ? again : 1);
+}
+
 /*
  ***************************************************************************
  * Main loop: Read and display PID stats.
@@ -2397,6 +4074,11 @@ void rw_pidstat_loop(int dis_hdr, int rows)
 		read_proc_meminfo();
 	}
 
+	if (SAVE_TO_FILE(pidflag)) {
+		/* Save the first stats collected, for all the tasks */
+		write_task_stats(0, 0, TRUE);
+	}
+
 	if (!interval && !EXEC_PGM(pidflag)) {
 		/* Display since boot time */
 		ps_tstamp[1] = ps_tstamp[0];
@@ -2419,14 +4101,20 @@ void rw_pidstat_loop(int dis_hdr, int rows)
 	for (plist = pid_list; plist != NULL; plist = plist->next) {
 		memcpy(plist->pstats[2], plist->pstats[0], PID_STATS_SIZE);
 	}
+	save_cgroup_first_stats(cg_root);
 
 	/* Set a handler for SIGINT */
 	memset(&int_act, 0, sizeof(int_act));
 	int_act.sa_handler = int_handler;
 	sigaction(SIGINT, &int_act, NULL);
 
+	/* Set a handler for SIGUSR1 */
+	memset(&usr1_act, 0, sizeof(usr1_act));
+	usr1_act.sa_handler = usr1_handler;
+	sigaction(SIGUSR1, &usr1_act, NULL);
+
 	/* Wait for SIGALRM (or possibly SIGINT) signal */
-	__pause();
+	wait_next_sample();
 
 	if (signal_caught && interval)
 		/* SIGINT/SIGCHLD signals caught during first interval: Exit immediately */
@@ -2453,8 +4141,13 @@ void rw_pidstat_loop(int dis_hdr, int rows)
 			lines++;
 		}
 
-		/* Print results */
-		again = write_stats(curr, dis);
+		/* Print results or save them to file */
+		if (SAVE_TO_FILE(pidflag)) {
+			again = write_task_stats(!curr, curr, FALSE);
+		}
+		else {
+			again = write_stats(curr, dis);
+		}
 
 		if (!again)
 			return;
@@ -2465,12 +4158,14 @@ void rw_pidstat_loop(int dis_hdr, int rows)
 
 		if (count) {
 
-			__pause();
+			wait_next_sample();
 
 			if (signal_caught) {
 				/* SIGINT/SIGCHLD signals caught => Display average stats */
 				count = 0;
-				printf("\n");	/* Skip "^C" displayed on screen */
+				if (!SAVE_TO_FILE(pidflag)) {
+					printf("\n");	/* Skip "^C" displayed on screen */
+				}
 			}
 			else {
 				curr ^= 1;
@@ -2483,7 +4178,7 @@ void rw_pidstat_loop(int dis_hdr, int rows)
 	 * The one line format uses a raw time value rather than time strings
 	 * so the average doesn't really fit.
 	 */
-	if (!DISPLAY_ONELINE(pidflag))
+	if (!DISPLAY_ONELINE(pidflag) && !SAVE_TO_FILE(pidflag))
 	{
 		/* Write stats average */
 		write_stats_avg(curr, dis_hdr);
@@ -2637,11 +4332,76 @@ int main(int argc, char **argv)
 			}
 		}
 
+		else if (!strcmp(argv[opt], "-o")) {
+			/* Save stats to file */
+			if (!argv[++opt]) {
+				usage(argv[0]);
+			}
+			strncpy(ofile, argv[opt++], sizeof(ofile));
+			ofile[sizeof(ofile) - 1] = '\0';
+			pidflag |= P_F_OFILE;
+			if (!strlen(ofile)) {
+				usage(argv[0]);
+			}
+		}
+
 		else if (!strcmp(argv[opt], "--human")) {
 			pidflag |= P_D_UNIT;
 			opt++;
 		}
 
+		else if (!strcmp(argv[opt], "--cgroup")) {
+			pidflag |= P_D_CGROUP;
+			opt++;
+		}
+
+		else if (!strcmp(argv[opt], "--lazy")) {
+			pidflag |= P_F_LAZY;
+			opt++;
+		}
+
+		else if (!strcmp(argv[opt], "--fast-threads")) {
+			pidflag |= P_F_FAST_THR;
+			opt++;
+		}
+
+		else if (!strcmp(argv[opt], "--stack-res")) {
+			pidflag |= P_F_STACK_RES;
+			opt++;
+		}
+
+		else if (!strcmp(argv[opt], "--top")) {
+			if (!argv[++opt] || (strspn(argv[opt], DIGITS) != strlen(argv[opt]))) {
+				usage(argv[0]);
+			}
+			top_nr = atoi(argv[opt++]);
+			if (top_nr < 1) {
+				usage(argv[0]);
+			}
+		}
+
+		else if (!strcmp(argv[opt], "--sort")) {
+			if (!argv[++opt]) {
+				usage(argv[0]);
+			}
+			if (!strcmp(argv[opt], K_TOP_CPU)) {
+				top_key = TOP_CPU;
+			}
+			else if (!strcmp(argv[opt], K_TOP_MEM)) {
+				top_key = TOP_MEM;
+			}
+			else if (!strcmp(argv[opt], K_TOP_IO)) {
+				top_key = TOP_IO;
+			}
+			else if (!strcmp(argv[opt], K_TOP_CSWCH)) {
+				top_key = TOP_CSWCH;
+			}
+			else {
+				usage(argv[0]);
+			}
+			opt++;
+		}
+
 #ifdef TEST
 		else if (!strncmp(argv[opt], "--getenv", 8)) {
 			__env = TRUE;
@@ -2831,12 +4591,22 @@ int main(int argc, char **argv)
 		dis_hdr = 1;
 	}
 
+	if (SAVE_TO_FILE(pidflag) && (!interval || DISPLAY_CGROUP(pidflag))) {
+		/* Stats can be saved only for tasks, and an interval must be given */
+		usage(argv[0]);
+	}
+
 	/* Check flags and set default values */
 	check_flags();
 
 	/* Count nb of proc */
 	cpu_nr = get_cpu_nr(~0, FALSE);
 
+	if (SAVE_TO_FILE(pidflag)) {
+		/* Create output file and write its headers */
+		ofd = create_task_file(ofile, cpu_nr);
+	}
+
 	if (dis_hdr < 0) {
 		dis_hdr = 0;
 	}
@@ -2859,17 +4629,26 @@ int main(int argc, char **argv)
 	 */
 	setbuf(stdout, NULL);
 
-	/* Get system name, release number and hostname */
-	__uname(&header);
-	print_gal_header(&(ps_tstamp[0]), header.sysname, header.release,
-			 header.nodename, header.machine, cpu_nr,
-			 PLAIN_OUTPUT);
+	if (!SAVE_TO_FILE(pidflag)) {
+		/* Get system name, release number and hostname */
+		__uname(&header);
+		print_gal_header(&(ps_tstamp[0]), header.sysname, header.release,
+				 header.nodename, header.machine, cpu_nr,
+				 PLAIN_OUTPUT);
+	}
 
 	/* Main loop */
 	rw_pidstat_loop(dis_hdr, rows);
 
 	/* Free structures */
 	sfree_pid(&pid_list, TRUE);
+	sfree_cgroup(&cg_root, TRUE);
+	free(top_heap);
+	free(task_buf);
+
+	if (ofd >= 0) {
+		close(ofd);
+	}
 
 	/*
 	 * @status contains the exit code of the child process monitored with option -e,
@@ -11,6 +11,7 @@
 #undef HZ
 #endif
 #include "common.h"
+#include "sa_task.h"
 
 #define K_SELF		"SELF"
 
@@ -18,6 +19,17 @@
 #define K_P_CHILD	"CHILD"
 #define K_P_ALL		"ALL"
 
+/* Keys used to select tasks with option --top */
+#define K_TOP_CPU	"cpu"
+#define K_TOP_MEM	"mem"
+#define K_TOP_IO	"io"
+#define K_TOP_CSWCH	"cswch"
+
+#define TOP_CPU		0
+#define TOP_MEM		1
+#define TOP_IO		2
+#define TOP_CSWCH	3
+
 #ifdef _POSIX_ARG_MAX
 #define MAX_COMM_LEN    _POSIX_ARG_MAX
 #define MAX_CMDLINE_LEN _POSIX_ARG_MAX
@@ -32,15 +44,7 @@
 #define MAX_USER_LEN    32
 #endif
 
-/* Activities */
-#define P_A_CPU		0x01
-#define P_A_MEM		0x02
-#define P_A_IO		0x04
-#define P_A_CTXSW	0x08
-#define P_A_STACK	0x10
-#define P_A_KTAB	0x20
-#define P_A_RT		0x40
-
+/* Activities: See P_A_* values in sa_task.h */
 #define DISPLAY_CPU(m)		(((m) & P_A_CPU) == P_A_CPU)
 #define DISPLAY_MEM(m)		(((m) & P_A_MEM) == P_A_MEM)
 #define DISPLAY_IO(m)		(((m) & P_A_IO) == P_A_IO)
@@ -48,6 +52,8 @@
 #define DISPLAY_STACK(m)	(((m) & P_A_STACK) == P_A_STACK)
 #define DISPLAY_KTAB(m)		(((m) & P_A_KTAB) == P_A_KTAB)
 #define DISPLAY_RT(m)		(((m) & P_A_RT) == P_A_RT)
+/* Activities needing other files than /proc/#/task/##/stat and schedstat */
+#define DISPLAY_ALL_THREAD_FILES(m)	((m) & (P_A_IO + P_A_CTXSW + P_A_STACK + P_A_KTAB))
 
 /* TASK/CHILD */
 #define P_NULL		0x00
@@ -71,6 +77,11 @@
 #define P_D_UNIT	0x0800
 #define P_D_SEC_EPOCH	0x1000
 #define P_F_EXEC_PGM	0x2000
+#define P_F_LAZY	0x4000
+#define P_D_CGROUP	0x8000
+#define P_F_OFILE	0x10000
+#define P_F_STACK_RES	0x20000
+#define P_F_FAST_THR	0x40000
 
 #define DISPLAY_PID(m)		(((m) & P_D_PID) == P_D_PID)
 #define DISPLAY_ALL_PID(m)	(((m) & P_D_ALL_PID) == P_D_ALL_PID)
@@ -86,15 +97,26 @@
 #define DISPLAY_UNIT(m)		(((m) & P_D_UNIT) == P_D_UNIT)
 #define PRINT_SEC_EPOCH(m)	(((m) & P_D_SEC_EPOCH) == P_D_SEC_EPOCH)
 #define EXEC_PGM(m)		(((m) & P_F_EXEC_PGM) == P_F_EXEC_PGM)
+#define LAZY_READ(m)		(((m) & P_F_LAZY) == P_F_LAZY)
+#define DISPLAY_CGROUP(m)	(((m) & P_D_CGROUP) == P_D_CGROUP)
+#define SAVE_TO_FILE(m)		(((m) & P_F_OFILE) == P_F_OFILE)
+#define STACK_RESIDENT(m)	(((m) & P_F_STACK_RES) == P_F_STACK_RES)
+#define FAST_THREADS(m)		(((m) & P_F_FAST_THR) == P_F_FAST_THR)
 
 /* Per-process flags */
 #define F_NO_PID_IO	0x01
 #define F_NO_PID_FD	0x02
 #define F_PID_DISPLAYED	0x04
+#define F_PID_FULL_READ	0x08
+#define F_CMDLINE_READ	0x10
+#define F_PID_TOP	0x20
 
 #define NO_PID_IO(m)		(((m) & F_NO_PID_IO) == F_NO_PID_IO)
 #define NO_PID_FD(m)		(((m) & F_NO_PID_FD) == F_NO_PID_FD)
 #define IS_PID_DISPLAYED(m)	(((m) & F_PID_DISPLAYED) == F_PID_DISPLAYED)
+#define IS_PID_FULL_READ(m)	(((m) & F_PID_FULL_READ) == F_PID_FULL_READ)
+#define IS_CMDLINE_READ(m)	(((m) & F_CMDLINE_READ) == F_CMDLINE_READ)
+#define IS_PID_TOP(m)		(((m) & F_PID_TOP) == F_PID_TOP)
 
 
 #define PROC		PRE "/proc"
@@ -106,6 +128,18 @@
 #define PID_SMAP	PRE "/proc/%u/smaps"
 #define PID_FD		PRE "/proc/%u/fd"
 #define PID_SCHED	PRE "/proc/%u/schedstat"
+#define PID_MAPS	PRE "/proc/%u/maps"
+#define PID_PAGEMAP	PRE "/proc/%u/pagemap"
+
+#define CGROUP_ROOT	PRE "/sys/fs/cgroup"
+
+#define CG_CPU_STAT	"cpu.stat"
+#define CG_CPU_PRESSURE	"cpu.pressure"
+#define CG_MEM_CURRENT	"memory.current"
+#define CG_MEM_STAT	"memory.stat"
+#define CG_MEM_PRESSURE	"memory.pressure"
+#define CG_IO_STAT	"io.stat"
+#define CG_IO_PRESSURE	"io.pressure"
 
 #define PROC_TASK	PRE "/proc/%u/task"
 #define TASK_STAT	PRE "/proc/%u/task/%u/stat"
@@ -114,6 +148,8 @@
 #define TASK_IO		PRE "/proc/%u/task/%u/io"
 #define TASK_CMDLINE	PRE "/proc/%u/task/%u/cmdline"
 #define TASK_SMAP	PRE "/proc/%u/task/%u/smaps"
+#define TASK_MAPS	PRE "/proc/%u/task/%u/maps"
+#define TASK_PAGEMAP	PRE "/proc/%u/task/%u/pagemap"
 #define TASK_FD		PRE "/proc/%u/task/%u/fd"
 
 #define PRINT_ID_HDR(_timestamp_, _flag_)	do {						\
@@ -132,6 +168,20 @@
 							}					\
 						} while (0)
 
+/* Normally defined in <linux/magic.h> */
+#ifndef PROC_SUPER_MAGIC
+#define PROC_SUPER_MAGIC	0x9fa0
+#endif
+
+/* Size of the buffer used to read directory entries with getdents64() */
+#define DENTS_BUF_SIZE	(256 * 1024)
+
+/*
+ * Max time (in microseconds) spent counting the entries of one
+ * /proc/#/fd directory. Once exceeded, last known value is used instead.
+ */
+#define FD_NR_BUDGET	20000
+
 /* Normally defined in <linux/sched.h> */
 #ifndef SCHED_NORMAL
 #define SCHED_NORMAL	0
@@ -184,6 +234,9 @@ struct pid_stats {
 	unsigned long      nivcsw			__attribute__ ((packed));
 	unsigned long      stack_size			__attribute__ ((packed));
 	unsigned long      stack_ref			__attribute__ ((packed));
+	unsigned long      stack_res			__attribute__ ((packed));
+	/* Uptime when the values not read from /proc/#[/task/##]/stat were read */
+	unsigned long long rd_uptime			__attribute__ ((packed));
 	unsigned int       processor			__attribute__ ((packed));
 	unsigned int       priority			__attribute__ ((packed));
 	unsigned int       policy			__attribute__ ((packed));
@@ -193,28 +246,123 @@ struct pid_stats {
 
 #define PID_STATS_SIZE	(sizeof(struct pid_stats))
 
+/* Present bit of a /proc/#/pagemap entry */
+#define PM_PRESENT	(1ULL << 63)
+
+/* Entry of the heap used to select the tasks to display with option --top */
+struct top_ent {
+	unsigned long long value;
+	struct st_pid	  *plist;
+};
+
+/* Directory entry as returned by getdents64() system call */
+struct linux_dirent64 {
+	unsigned long long d_ino;
+	long long	   d_off;
+	unsigned short	   d_reclen;
+	unsigned char	   d_type;
+	char		   d_name[];
+};
+
+/*
+ * Structure for a task.
+ * Members used when walking the list of tasks come first. Statistics for
+ * the three samples are stored in the structure itself, one after the other.
+ * Command name and command line are shared strings (see intern_string()).
+ */
 struct st_pid {
+	struct st_pid	  *next;
+	struct st_pid	  *tgid;	/* If current task is a TID, pointer to its TGID. NULL otherwise. */
+	struct st_pid	 **thr_hash;	/* Hash table of the threads of a TGID (option -t), or NULL */
+	struct st_pid	  *hnext;	/* Next thread in the same bucket of its TGID's hash table */
+	struct pid_stats  *pstats[3];	/* Pointers on stats[] below */
+	pid_t		   pid;
+	uid_t		   uid;
+	int		   exist;	/* TRUE if PID exists */
+	unsigned int	   flags;
+	char		  *comm;
+	char		  *cmdline;
 	unsigned long long total_vsz;
 	unsigned long long total_rss;
 	unsigned long long total_stack_size;
 	unsigned long long total_stack_ref;
+	unsigned long long total_stack_res;
 	unsigned long long total_threads;
 	unsigned long long total_fd_nr;
-	pid_t		   pid;
-	uid_t		   uid;
-	int		   exist;	/* TRUE if PID exists */
-	unsigned int	   flags;
+	unsigned long long startstack;	/* Address of the start of the stack, from /proc/#/stat */
+	unsigned long long starttime;	/* Time the task started after boot, from /proc/#/stat */
 	unsigned int	   rt_asum_count;
 	unsigned int	   rc_asum_count;
 	unsigned int	   uc_asum_count;
 	unsigned int	   tf_asum_count;
 	unsigned int	   sk_asum_count;
 	unsigned int	   delay_asum_count;
-	struct pid_stats  *pstats[3];
-	struct st_pid	  *tgid;	/* If current task is a TID, pointer to its TGID. NULL otherwise. */
-	struct st_pid	  *next;
-	char		   comm[MAX_COMM_LEN];
-	char		   cmdline[MAX_CMDLINE_LEN];
+	unsigned int	   last_fd_nr;	/* Last fd count which could be completed */
+	struct pid_stats   stats[3];
+};
+
+/* Statistics for a cgroup (cgroup v2) */
+struct cg_stats {
+	unsigned long long usage_usec;
+	unsigned long long user_usec;
+	unsigned long long system_usec;
+	unsigned long long cpu_some_usec;
+	unsigned long long mem_current;
+	unsigned long long mem_anon;
+	unsigned long long mem_file;
+	unsigned long long mem_some_usec;
+	unsigned long long rbytes;
+	unsigned long long wbytes;
+	unsigned long long io_some_usec;
+};
+
+#define CG_STATS_SIZE	(sizeof(struct cg_stats))
+
+/*
+ * Max number of descriptors kept open on cgroup directories. Directories
+ * of the other cgroups are opened again at each sample.
+ */
+#define CG_FD_MAX	256
+
+/* Number of buckets of the hash table containing the cgroups */
+#define CG_HASH_SIZE	1024
+
+/*
+ * Structure for a cgroup. Cgroups are saved as a tree which reproduces
+ * the cgroup hierarchy. They are also saved in a hash table, so that
+ * a cgroup can be found quickly from its parent and its name.
+ */
+struct st_cgroup {
+	struct st_cgroup  *parent;	/* Parent cgroup, or NULL for the root cgroup */
+	struct st_cgroup  *child;	/* First child cgroup */
+	struct st_cgroup  *sibling;	/* Next cgroup with the same parent */
+	struct st_cgroup  *hnext;	/* Next cgroup in the same hash bucket */
+	char		  *path;	/* Path relative to cgroup root directory */
+	char		  *name;	/* Last component of the path */
+	unsigned int	   hash;	/* Hash value computed from parent and name */
+	int		   dirfd;	/* Descriptor kept open on cgroup directory, or -1 */
+	ino_t		   ino;		/* Inode number of cgroup directory */
+	int		   exist;	/* TRUE if cgroup exists */
+	int		   in_use;	/* TRUE while the cgroup and its children are being read */
+	unsigned long long total_mem_current;
+	unsigned long long total_mem_anon;
+	unsigned long long total_mem_file;
+	unsigned int	   mem_asum_count;
+	struct cg_stats	   cstats[3];
+};
+
+/* Number of buckets of the hash table containing the threads of a TGID */
+#define THR_HASH_SIZE	512
+
+/* Number of buckets of the hash table containing shared strings */
+#define PSTR_HASH_SIZE	4096
+
+/* Shared string (command name or command line) */
+struct pstr {
+	struct pstr	  *next;
+	unsigned int	   hash;
+	unsigned int	   refcnt;
+	char		   str[];
 };
 
 #endif  /* _PIDSTAT_H */
@@ -143,86 +143,43 @@ void print_hdr_line(char *p_timestamp, struct activity *a, int pos, int iwidth,
  * IN:
  * @a			Activity structure with statistics.
  * @cpu			CPU number (0 for CPU "all").
- * @deltot_jiffies	Interval in jiffies.
- * @scc			Current statistics sample.
- * @scp			Previous statistics sample.
+ * @pct			CPU utilization percentages for this CPU (see
+ *			get_cpu_pct_table()).
  ***************************************************************************
  */
-void save_cpu_xstats(struct activity *a, int cpu, unsigned long long deltot_jiffies,
-		     struct stats_cpu *scc, struct stats_cpu *scp)
+void save_cpu_xstats(struct activity *a, int cpu, double *pct)
 {
-	if (!cpu && !deltot_jiffies) {
-		int j, k;
-
-		/* Current CPU (which is not CPU "all") is tickless */
-		if (DISPLAY_CPU_DEF(a->opt_flags)) {
-			j  = 5;	/* -u */
-		}
-		else {	/* DISPLAY_CPU_ALL(a->opt_flags) */
-			j = 9;	/* -u ALL */
-		}
-		for (k = 0; k < j; k++) {
-			save_minmax(a, cpu * a->xnr + k, 0.0);
-		}
-		/* %idle = 100% */
-		save_minmax(a, cpu * a->xnr + 9, 100.0);
-
-		return;
-	}
-
 	if (DISPLAY_CPU_DEF(a->opt_flags)) {
 		/* %user */
-		save_minmax(a, cpu * a->xnr,
-			    ll_sp_value(scp->cpu_user, scc->cpu_user, deltot_jiffies));
+		save_minmax(a, cpu * a->xnr, pct[CPU_PCT_USER]);
 		/* %nice */
-		save_minmax(a, cpu * a->xnr + 1,
-			    ll_sp_value(scp->cpu_nice, scc->cpu_nice, deltot_jiffies));
+		save_minmax(a, cpu * a->xnr + 1, pct[CPU_PCT_NICE_G]);
 		/* %system */
-		save_minmax(a, cpu * a->xnr + 2,
-			    ll_sp_value(scp->cpu_sys + scp->cpu_hardirq + scp->cpu_softirq,
-					scc->cpu_sys + scc->cpu_hardirq + scc->cpu_softirq,
-		   deltot_jiffies));
+		save_minmax(a, cpu * a->xnr + 2, pct[CPU_PCT_SYSTEM]);
 	}
 	else {  /* DISPLAY_CPU_ALL(a->opt_flags) */
 		/* %usr */
-		save_minmax(a, cpu * a->xnr,
-			    (scc->cpu_user - scc->cpu_guest) < (scp->cpu_user - scp->cpu_guest) ?
-			    0.0 :
-			    ll_sp_value(scp->cpu_user - scp->cpu_guest,
-					scc->cpu_user - scc->cpu_guest, deltot_jiffies));
+		save_minmax(a, cpu * a->xnr, pct[CPU_PCT_USR]);
 		/* %nice */
-		save_minmax(a, cpu * a->xnr + 1,
-			    (scc->cpu_nice - scc->cpu_guest_nice) < (scp->cpu_nice - scp->cpu_guest_nice) ?
-			    0.0 :
-			    ll_sp_value(scp->cpu_nice - scp->cpu_guest_nice,
-					scc->cpu_nice - scc->cpu_guest_nice, deltot_jiffies));
+		save_minmax(a, cpu * a->xnr + 1, pct[CPU_PCT_NICE]);
 		/* %sys */
-		save_minmax(a, cpu * a->xnr + 2,
-			    ll_sp_value(scp->cpu_sys, scc->cpu_sys, deltot_jiffies));
+		save_minmax(a, cpu * a->xnr + 2, pct[CPU_PCT_SYS]);
 		/* %irq */
-		save_minmax(a, cpu * a->xnr + 5,
-			    ll_sp_value(scp->cpu_hardirq, scc->cpu_hardirq, deltot_jiffies));
+		save_minmax(a, cpu * a->xnr + 5, pct[CPU_PCT_IRQ]);
 		/* %soft */
-		save_minmax(a, cpu * a->xnr + 6,
-			    ll_sp_value(scp->cpu_softirq, scc->cpu_softirq, deltot_jiffies));
+		save_minmax(a, cpu * a->xnr + 6, pct[CPU_PCT_SOFT]);
 		/* %guest */
-		save_minmax(a, cpu * a->xnr + 7,
-			    ll_sp_value(scp->cpu_guest, scc->cpu_guest, deltot_jiffies));
+		save_minmax(a, cpu * a->xnr + 7, pct[CPU_PCT_GUEST]);
 		/* %gnice */
-		save_minmax(a, cpu * a->xnr + 8,
-			    ll_sp_value(scp->cpu_guest_nice, scc->cpu_guest_nice, deltot_jiffies));
+		save_minmax(a, cpu * a->xnr + 8, pct[CPU_PCT_GNICE]);
 	}
 
 	/* %iowait */
-	save_minmax(a, cpu * a->xnr + 3,
-		    ll_sp_value(scp->cpu_iowait, scc->cpu_iowait, deltot_jiffies));
+	save_minmax(a, cpu * a->xnr + 3, pct[CPU_PCT_IOWAIT]);
 	/* %steal */
-	save_minmax(a, cpu * a->xnr + 4,
-		    ll_sp_value(scp->cpu_steal, scc->cpu_steal, deltot_jiffies));
+	save_minmax(a, cpu * a->xnr + 4, pct[CPU_PCT_STEAL]);
 	/* %idle */
-	save_minmax(a, cpu * a->xnr + 9,
-		    (scc->cpu_idle < scp->cpu_idle ? 0.0 :
-		    ll_sp_value(scp->cpu_idle, scc->cpu_idle, deltot_jiffies)));
+	save_minmax(a, cpu * a->xnr + 9, pct[CPU_PCT_IDLE]);
 }
 
 /*
@@ -233,12 +190,12 @@ void save_cpu_xstats(struct activity *a, int cpu, unsigned long long deltot_jiff
  * @a			Activity structure with statistics.
  * @cpu			CPU number (0 for CPU "all").
  * @deltot_jiffies	Interval in jiffies.
- * @scc			Current statistics sample.
- * @scp			Previous statistics sample.
+ * @pct			CPU utilization percentages for this CPU (see
+ *			get_cpu_pct_table()).
  ***************************************************************************
  */
 void print_oneline_cpu_stats(struct activity *a, int cpu, unsigned long long deltot_jiffies,
-			     struct stats_cpu *scc, struct stats_cpu *scp)
+			     double *pct)
 {
 	if (cpu == 0) {
 		/* This is CPU "all" */
@@ -275,42 +232,16 @@ void print_oneline_cpu_stats(struct activity *a, int cpu, unsigned long long del
 
 	if (DISPLAY_CPU_DEF(a->opt_flags)) {
 		cprintf_xpc(DISPLAY_UNIT(flags), XHIGH, 5, 9, 2,
-			    ll_sp_value(scp->cpu_user, scc->cpu_user, deltot_jiffies),
-			    ll_sp_value(scp->cpu_nice, scc->cpu_nice, deltot_jiffies),
-			    ll_sp_value(scp->cpu_sys + scp->cpu_hardirq + scp->cpu_softirq,
-					scc->cpu_sys + scc->cpu_hardirq + scc->cpu_softirq,
-					deltot_jiffies),
-			    ll_sp_value(scp->cpu_iowait, scc->cpu_iowait, deltot_jiffies),
-			    ll_sp_value(scp->cpu_steal, scc->cpu_steal, deltot_jiffies));
-
-		cprintf_xpc(DISPLAY_UNIT(flags), XLOW, 1, 9, 2,
-			    scc->cpu_idle < scp->cpu_idle ?
-			    0.0 :
-			    ll_sp_value(scp->cpu_idle, scc->cpu_idle, deltot_jiffies));
+			    pct[CPU_PCT_USER], pct[CPU_PCT_NICE_G], pct[CPU_PCT_SYSTEM],
+			    pct[CPU_PCT_IOWAIT], pct[CPU_PCT_STEAL]);
 	}
 	else { /* DISPLAY_CPU_ALL(a->opt_flags) */
 		cprintf_xpc(DISPLAY_UNIT(flags), XHIGH, 9, 9, 2,
-			    (scc->cpu_user - scc->cpu_guest) < (scp->cpu_user - scp->cpu_guest) ?
-			    0.0 :
-			    ll_sp_value(scp->cpu_user - scp->cpu_guest,
-					scc->cpu_user - scc->cpu_guest, deltot_jiffies),
-			    (scc->cpu_nice - scc->cpu_guest_nice) < (scp->cpu_nice - scp->cpu_guest_nice) ?
-			    0.0 :
-			    ll_sp_value(scp->cpu_nice - scp->cpu_guest_nice,
-					scc->cpu_nice - scc->cpu_guest_nice, deltot_jiffies),
-			    ll_sp_value(scp->cpu_sys, scc->cpu_sys, deltot_jiffies),
-			    ll_sp_value(scp->cpu_iowait, scc->cpu_iowait, deltot_jiffies),
-			    ll_sp_value(scp->cpu_steal, scc->cpu_steal, deltot_jiffies),
-			    ll_sp_value(scp->cpu_hardirq, scc->cpu_hardirq, deltot_jiffies),
-			    ll_sp_value(scp->cpu_softirq, scc->cpu_softirq, deltot_jiffies),
-			    ll_sp_value(scp->cpu_guest, scc->cpu_guest, deltot_jiffies),
-			    ll_sp_value(scp->cpu_guest_nice, scc->cpu_guest_nice, deltot_jiffies));
-
-		cprintf_xpc(DISPLAY_UNIT(flags), XLOW, 1, 9, 2,
-			    scc->cpu_idle < scp->cpu_idle ?
-			    0.0 :
-			    ll_sp_value(scp->cpu_idle, scc->cpu_idle, deltot_jiffies));
+			    pct[CPU_PCT_USR], pct[CPU_PCT_NICE], pct[CPU_PCT_SYS],
+			    pct[CPU_PCT_IOWAIT], pct[CPU_PCT_STEAL], pct[CPU_PCT_IRQ],
+			    pct[CPU_PCT_SOFT], pct[CPU_PCT_GUEST], pct[CPU_PCT_GNICE]);
 	}
+	cprintf_xpc(DISPLAY_UNIT(flags), XLOW, 1, 9, 2, pct[CPU_PCT_IDLE]);
 	printf("\n");
 }
 
@@ -333,9 +264,11 @@ void print_oneline_cpu_stats(struct activity *a, int cpu, unsigned long long del
 __print_funct_t print_cpu_stats(struct activity *a, int prev, int curr,
 				unsigned long long itv)
 {
-	int i;
+	static double *cpu_pct = NULL;
+	static unsigned long long *cpu_itv = NULL;
+	static int cpu_pct_nr = 0;
+	int i, nr;
 	unsigned long long deltot_jiffies = 1;
-	struct stats_cpu *scc, *scp;
 	unsigned char offline_cpu_bitmap[BITMAP_SIZE(NR_CPUS)] = {0};
 
 	if (xinit && a->nr_spalloc) {
@@ -374,53 +307,60 @@ __print_funct_t print_cpu_stats(struct activity *a, int prev, int curr,
 		deltot_jiffies = get_global_cpu_statistics(a, prev, curr,
 							   flags, offline_cpu_bitmap);
 	}
+	else {
+		/*
+		 * This is a UP machine. In this case
+		 * interval has still not been calculated.
+		 */
+		deltot_jiffies = get_per_cpu_interval((struct stats_cpu *) a->buf[curr],
+						      (struct stats_cpu *) a->buf[prev]);
+	}
+	if (!deltot_jiffies) {
+		/* CPU "all" cannot be tickless */
+		deltot_jiffies = 1;
+	}
+
+	/*
+	 * Note: @nr[curr] is in [1, NR_CPUS + 1].
+	 * Bitmap size is provided for (NR_CPUS + 1) CPUs.
+	 * Anyway, NR_CPUS may vary between the version of sysstat
+	 * used by sadc to create a file, and the version of sysstat
+	 * used by sar to read it...
+	 */
+	nr = MINIMUM(a->nr_ini, a->bitmap->b_size + 1);
+	if (nr > cpu_pct_nr) {
+		SREALLOC(cpu_pct, double, sizeof(double) * CPU_PCT_NR * nr);
+		SREALLOC(cpu_itv, unsigned long long, sizeof(unsigned long long) * nr);
+		cpu_pct_nr = nr;
+	}
+
+	/* Compute CPU utilization for every CPU to display (including CPU "all") */
+	get_cpu_pct_table((struct stats_cpu *) a->buf[curr], (struct stats_cpu *) a->buf[prev],
+			  a->msize, nr, a->bitmap->b_array, offline_cpu_bitmap,
+			  deltot_jiffies, cpu_itv, cpu_pct);
 
 	/*
 	 * Now display CPU statistics (including CPU "all"),
 	 * except for offline CPU or CPU that the user doesn't want to see.
 	 */
-	for (i = 0; (i < a->nr_ini) && (i < a->bitmap->b_size + 1); i++) {
+	for (i = 0; i < nr; i++) {
 
-		/*
-		 * Should current CPU (including CPU "all") be displayed?
-		 * Note: @nr[curr] is in [1, NR_CPUS + 1].
-		 * Bitmap size is provided for (NR_CPUS + 1) CPUs.
-		 * Anyway, NR_CPUS may vary between the version of sysstat
-		 * used by sadc to create a file, and the version of sysstat
-		 * used by sar to read it...
-		 */
+		/* Should current CPU (including CPU "all") be displayed? */
 		if (!IS_CPU_SELECTED(a->bitmap->b_array, i) ||
 		    IS_CPU_OFFLINE(offline_cpu_bitmap, i))
 			/* Don't display CPU */
 			continue;
 
-		scc = (struct stats_cpu *) ((char *) a->buf[curr] + i * a->msize);
-		scp = (struct stats_cpu *) ((char *) a->buf[prev] + i * a->msize);
-
-		if (i == 0) {
-			/* This is CPU "all" */
-			if (a->nr_ini == 1) {
-				/*
-				 * This is a UP machine. In this case
-				 * interval has still not been calculated.
-				 */
-				deltot_jiffies = get_per_cpu_interval(scc, scp);
-			}
-			if (!deltot_jiffies) {
-				/* CPU "all" cannot be tickless */
-				deltot_jiffies = 1;
-			}
-		}
-		else {
-			/* Recalculate interval for current proc */
-			deltot_jiffies = get_per_cpu_interval(scc, scp);
-		}
-
 		/* Check if min and max values should be displayed */
 		if (DISPLAY_MINMAX(flags)) {
 			if (prev != 2) {
-				/* Save min and max values */
-				save_cpu_xstats(a, i, deltot_jiffies, scc, scp);
+				/*
+				 * Save min and max values.
+				 * Samples where the CPU is tickless are not taken into account.
+				 */
+				if (!i || cpu_itv[i]) {
+					save_cpu_xstats(a, i, cpu_pct + i * CPU_PCT_NR);
+				}
 			}
 			else if ((*(a->spmin + i * a->xnr) != DBL_MAX) &&
 				 (*(a->spmax + i * a->xnr) != -DBL_MAX)) {
@@ -441,7 +381,7 @@ __print_funct_t print_cpu_stats(struct activity *a, int prev, int curr,
 		printf("%-11s", timestamp[curr]);
 
 		/* Print CPU stats */
-		print_oneline_cpu_stats(a, i, deltot_jiffies, scc, scp);
+		print_oneline_cpu_stats(a, i, cpu_itv[i], cpu_pct + i * CPU_PCT_NR);
 	}
 }
 
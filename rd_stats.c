@@ -25,14 +25,34 @@
 #include <errno.h>
 #include <dirent.h>
 #include <ctype.h>
+#include <fnmatch.h>
+#include <pthread.h>
+#include <signal.h>
+#include <stdint.h>
 #include <sys/types.h>
 #include <sys/stat.h>
 #include <sys/statvfs.h>
+#include <sys/socket.h>
+#include <sys/syscall.h>
+#include <poll.h>
 #include <unistd.h>
+#include <fcntl.h>
+#include <linux/netlink.h>
+#include <linux/rtnetlink.h>
 
 #include "common.h"
 #include "rd_stats.h"
 
+#ifndef __NR_listmount
+/* listmount() and statmount() system calls numbers, if not known by libc headers */
+#if (defined(__x86_64__) && !defined(__ILP32__)) || defined(__i386__) || \
+    defined(__aarch64__) || defined(__arm__) || defined(__riscv) || \
+    defined(__powerpc__) || defined(__s390__) || defined(__loongarch__)
+#define __NR_statmount	457
+#define __NR_listmount	458
+#endif
+#endif
+
 #ifdef USE_NLS
 #include <locale.h>
 #include <libintl.h>
@@ -41,6 +61,10 @@
 #define _(string) (string)
 #endif
 
+#ifdef TEST
+extern unsigned int __root_gen;
+#endif
+
 /* Generic PSI structure */
 struct stats_psi {
 	unsigned long long total;
@@ -552,6 +576,121 @@ unsigned long long get_per_cpu_interval(struct stats_cpu *scc,
 		 ishift);
 }
 
+/*
+ ***************************************************************************
+ * Compute CPU utilization percentages for a whole set of CPU.
+ * Counters of every CPU are first gathered as a table of deltas (one row
+ * of CPU_PCT_NR values per CPU), then each row is scaled by the interval
+ * of its CPU in a single pass which the compiler can vectorize.
+ *
+ * IN:
+ * @scc_0	Current sample statistics for CPU "all". Other CPU follow.
+ * @scp_0	Previous sample statistics for CPU "all". Other CPU follow.
+ *		Previous idle and iowait values may be modified here
+ *		(see get_per_cpu_interval()).
+ * @msize	Size of each structure in previous arrays. May be greater
+ *		than STATS_CPU_SIZE when statistics are read from a file.
+ * @nr		Number of CPU (including CPU "all").
+ * @sel_bitmap	Bitmap of selected CPU.
+ * @offline_cpu_bitmap
+ *		Bitmap of offline CPU. Percentages are computed only for
+ *		CPU which are selected and not offline.
+ * @deltot_all	Interval for CPU "all", expressed in jiffies.
+ *
+ * OUT:
+ * @deltot	Interval of time for each CPU, expressed in jiffies. A zero
+ *		value means that the CPU is tickless.
+ * @pct		CPU_PCT_NR percentages for each CPU. A tickless CPU is 100%
+ *		idle.
+ *
+ * USED BY:
+ * sar, mpstat
+ ***************************************************************************
+ */
+void get_cpu_pct_table(struct stats_cpu *scc_0, struct stats_cpu *scp_0, size_t msize,
+		       int nr, const unsigned char sel_bitmap[],
+		       const unsigned char offline_cpu_bitmap[],
+		       unsigned long long deltot_all, unsigned long long deltot[],
+		       double pct[])
+{
+	struct stats_cpu *scc, *scp;
+	unsigned long long c[CPU_PCT_NR], p[CPU_PCT_NR];
+	double *d, itv;
+	int i, k;
+
+	for (i = 0; i < nr; i++) {
+
+		if (!IS_CPU_SELECTED(sel_bitmap, i) || IS_CPU_OFFLINE(offline_cpu_bitmap, i))
+			continue;
+
+		scc = (struct stats_cpu *) ((char *) scc_0 + i * msize);
+		scp = (struct stats_cpu *) ((char *) scp_0 + i * msize);
+
+		deltot[i] = i ? get_per_cpu_interval(scc, scp) : deltot_all;
+
+		/* Gather the counters of current CPU... */
+		c[CPU_PCT_USR]    = scc->cpu_user - scc->cpu_guest;
+		p[CPU_PCT_USR]    = scp->cpu_user - scp->cpu_guest;
+		c[CPU_PCT_NICE]   = scc->cpu_nice - scc->cpu_guest_nice;
+		p[CPU_PCT_NICE]   = scp->cpu_nice - scp->cpu_guest_nice;
+		c[CPU_PCT_SYS]    = scc->cpu_sys;
+		p[CPU_PCT_SYS]    = scp->cpu_sys;
+		c[CPU_PCT_IOWAIT] = scc->cpu_iowait;
+		p[CPU_PCT_IOWAIT] = scp->cpu_iowait;
+		c[CPU_PCT_IRQ]    = scc->cpu_hardirq;
+		p[CPU_PCT_IRQ]    = scp->cpu_hardirq;
+		c[CPU_PCT_SOFT]   = scc->cpu_softirq;
+		p[CPU_PCT_SOFT]   = scp->cpu_softirq;
+		c[CPU_PCT_STEAL]  = scc->cpu_steal;
+		p[CPU_PCT_STEAL]  = scp->cpu_steal;
+		c[CPU_PCT_GUEST]  = scc->cpu_guest;
+		p[CPU_PCT_GUEST]  = scp->cpu_guest;
+		c[CPU_PCT_GNICE]  = scc->cpu_guest_nice;
+		p[CPU_PCT_GNICE]  = scp->cpu_guest_nice;
+		c[CPU_PCT_IDLE]   = scc->cpu_idle;
+		p[CPU_PCT_IDLE]   = scp->cpu_idle;
+		c[CPU_PCT_USER]   = scc->cpu_user;
+		p[CPU_PCT_USER]   = scp->cpu_user;
+		c[CPU_PCT_NICE_G] = scc->cpu_nice;
+		p[CPU_PCT_NICE_G] = scp->cpu_nice;
+		c[CPU_PCT_SYSTEM] = scc->cpu_sys + scc->cpu_hardirq + scc->cpu_softirq;
+		p[CPU_PCT_SYSTEM] = scp->cpu_sys + scp->cpu_hardirq + scp->cpu_softirq;
+
+		/*
+		 * ...and save their deltas. Dyn-tick kernels may make
+		 * counters go backward: Use zero in this case.
+		 */
+		d = pct + i * CPU_PCT_NR;
+		for (k = 0; k < CPU_PCT_NR; k++) {
+			d[k] = (c[k] < p[k]) ? 0.0 : (double) (c[k] - p[k]);
+		}
+	}
+
+	/* Now scale deltas to percentages */
+	for (i = 0; i < nr; i++) {
+
+		if (!IS_CPU_SELECTED(sel_bitmap, i) || IS_CPU_OFFLINE(offline_cpu_bitmap, i))
+			continue;
+
+		d = pct + i * CPU_PCT_NR;
+
+		if (!deltot[i]) {
+			/*
+			 * If the CPU is tickless then there is no change in CPU values
+			 * but the sum of values is not zero.
+			 */
+			memset(d, 0, sizeof(double) * CPU_PCT_NR);
+			d[CPU_PCT_IDLE] = 100.0;
+			continue;
+		}
+
+		itv = (double) deltot[i];
+		for (k = 0; k < CPU_PCT_NR; k++) {
+			d[k] = d[k] / itv * 100;
+		}
+	}
+}
+
 #ifdef SOURCE_SADC
 /*---------------- BEGIN: FUNCTIONS USED BY SADC ONLY ---------------------*/
 
@@ -875,6 +1014,44 @@ __nr_t read_diskstats_io(struct stats_io *st_io)
 	return 1;
 }
 
+/*
+ ***************************************************************************
+ * Tell if an item (interface, device or filesystem) should be collected.
+ * An item is collected if one of its names matches one of the patterns of
+ * the include list (or if this list is empty) and none of its names matches
+ * one of the patterns of the exclude list.
+ *
+ * IN:
+ * @gf		Include and exclude lists of glob patterns.
+ * @name	Name of the item.
+ * @name2	Other name of the item (e.g. filesystem mount point), or NULL.
+ *
+ * RETURNS:
+ * TRUE if the item should be collected, FALSE otherwise.
+ ***************************************************************************
+ */
+int pass_glob_filter(struct glob_filter *gf, const char *name, const char *name2)
+{
+	int i;
+
+	for (i = 0; i < gf->exclude_nr; i++) {
+		if (!fnmatch(gf->exclude[i], name, 0) ||
+		    (name2 && !fnmatch(gf->exclude[i], name2, 0)))
+			return FALSE;
+	}
+
+	if (!gf->include_nr)
+		return TRUE;
+
+	for (i = 0; i < gf->include_nr; i++) {
+		if (!fnmatch(gf->include[i], name, 0) ||
+		    (name2 && !fnmatch(gf->include[i], name2, 0)))
+			return TRUE;
+	}
+
+	return FALSE;
+}
+
 /*
  ***************************************************************************
  * Read block devices statistics from /proc/diskstats.
@@ -884,6 +1061,7 @@ __nr_t read_diskstats_io(struct stats_io *st_io)
  * @nr_alloc	Total number of structures allocated. Value is >= 1.
  * @read_part	True if disks *and* partitions should be read; False if only
  * 		disks are read.
+ * @dev_filter	Devices to collect (NULL or empty to collect all of them).
  *
  * OUT:
  * @st_disk	Structure with statistics.
@@ -894,7 +1072,7 @@ __nr_t read_diskstats_io(struct stats_io *st_io)
  ***************************************************************************
  */
 __nr_t read_diskstats_disk(struct stats_disk *st_disk, __nr_t nr_alloc,
-			   int read_part)
+			   int read_part, struct glob_filter *dev_filter)
 {
 	FILE *fp;
 	char line[1024];
@@ -928,6 +1106,9 @@ __nr_t read_diskstats_disk(struct stats_disk *st_disk, __nr_t nr_alloc,
 			if (!rd_ios && !wr_ios && !dc_ios)
 				/* Unused device: Ignore it */
 				continue;
+			if (dev_filter && !pass_glob_filter(dev_filter, dev_name, NULL))
+				/* Device not selected */
+				continue;
 			if (read_part || is_device(SLASH_SYS, dev_name, ACCEPT_VIRTUAL_DEVICES)) {
 
 				if (dsk_read + 1 > nr_alloc) {
@@ -1167,70 +1348,290 @@ __nr_t read_net_dev(struct stats_net_dev *st_net_dev, __nr_t nr_alloc)
 	return dev_read;
 }
 
+/* Speed and duplex of network interfaces, indexed by interface name */
+static struct if_info_ent *if_info_cache[IF_INFO_CACHE_SIZE];
+#ifndef TEST
+/* rtnetlink socket receiving link notifications (-2 if not opened yet) */
+static int if_info_nlfd = -2;
+#endif
+
 /*
  ***************************************************************************
- * Read duplex and speed data for network interface cards.
+ * Read duplex and speed data for a network interface card from sysfs.
  *
  * IN:
  * @st_net_dev	Structure where stats will be saved.
- * @nbr		Number of network interfaces to read.
  *
  * OUT:
  * @st_net_dev	Structure with statistics.
  ***************************************************************************
  */
-void read_if_info(struct stats_net_dev *st_net_dev, int nbr)
+void read_if_speed_duplex(struct stats_net_dev *st_net_dev)
 {
 	FILE *fp;
-	struct stats_net_dev *st_net_dev_i;
 	char filename[128], duplex[32];
-	int dev, n;
+	int n;
 
-	for (dev = 0; dev < nbr; dev++) {
+	/* Read duplex info */
+	sprintf(filename, IF_DUPLEX, st_net_dev->interface);
 
-		st_net_dev_i = st_net_dev + dev;
+	if ((fp = fopen(filename, "r")) == NULL)
+		/* Cannot read NIC duplex */
+		return;
 
-		/* Read speed info */
-		sprintf(filename, IF_DUPLEX, st_net_dev_i->interface);
+	n = fscanf(fp, "%31s", duplex);
 
-		if ((fp = fopen(filename, "r")) == NULL)
-			/* Cannot read NIC duplex */
-			continue;
+	fclose(fp);
 
-		n = fscanf(fp, "%31s", duplex);
+	if (n != 1)
+		/* Cannot read NIC duplex */
+		return;
 
-		fclose(fp);
+	if (!strcmp(duplex, K_DUPLEX_FULL)) {
+		st_net_dev->duplex = C_DUPLEX_FULL;
+	}
+	else if (!strcmp(duplex, K_DUPLEX_HALF)) {
+		st_net_dev->duplex = C_DUPLEX_HALF;
+	}
+	else
+		return;
 
-		if (n != 1)
-			/* Cannot read NIC duplex */
-			continue;
+	/* Read speed info */
+	sprintf(filename, IF_SPEED, st_net_dev->interface);
 
-		if (!strcmp(duplex, K_DUPLEX_FULL)) {
-			st_net_dev_i->duplex = C_DUPLEX_FULL;
-		}
-		else if (!strcmp(duplex, K_DUPLEX_HALF)) {
-			st_net_dev_i->duplex = C_DUPLEX_HALF;
+	if ((fp = fopen(filename, "r")) == NULL)
+		/* Cannot read NIC speed */
+		return;
+
+	n = fscanf(fp, "%u", &st_net_dev->speed);
+
+	fclose(fp);
+
+	if (n != 1) {
+		st_net_dev->speed = 0;
+	}
+}
+
+/*
+ ***************************************************************************
+ * Compute the bucket number of a network interface in the speed and duplex
+ * cache (FNV-1a hash).
+ *
+ * IN:
+ * @name	Interface name.
+ *
+ * RETURNS:
+ * Bucket number.
+ ***************************************************************************
+ */
+unsigned int hash_if_name(const char *name)
+{
+	unsigned int hash = 2166136261U;
+	int i;
+
+	for (i = 0; name[i] && (i < MAX_IFACE_LEN); i++) {
+		hash = (hash ^ (unsigned char) name[i]) * 16777619U;
+	}
+
+	return hash % IF_INFO_CACHE_SIZE;
+}
+
+/*
+ ***************************************************************************
+ * Remove a network interface from the speed and duplex cache, so that its
+ * values will be read again from sysfs.
+ *
+ * IN:
+ * @name	Interface name, or NULL to empty the whole cache.
+ ***************************************************************************
+ */
+void drop_if_info(const char *name)
+{
+	struct if_info_ent *ie, **pie;
+	unsigned int h, h_end;
+
+	if (name) {
+		h = hash_if_name(name);
+		h_end = h + 1;
+	}
+	else {
+		h = 0;
+		h_end = IF_INFO_CACHE_SIZE;
+	}
+
+	for (; h < h_end; h++) {
+		for (pie = &if_info_cache[h]; (ie = *pie) != NULL; ) {
+			if (!name || !strncmp(ie->interface, name, MAX_IFACE_LEN - 1)) {
+				*pie = ie->hnext;
+				free(ie);
+			}
+			else {
+				pie = &ie->hnext;
+			}
 		}
-		else
-			continue;
+	}
+}
+
+/*
+ ***************************************************************************
+ * Open a local rtnetlink socket subscribed to link notifications. Such a
+ * notification is sent by the kernel whenever the state of an interface
+ * changes (including its speed and duplex) or an interface is removed.
+ *
+ * RETURNS:
+ * Socket descriptor, or -1 if it cannot be opened.
+ ***************************************************************************
+ */
+int open_link_notifications(void)
+{
+	struct sockaddr_nl snl;
+	int fd;
 
-		/* Read speed info */
-		sprintf(filename, IF_SPEED, st_net_dev_i->interface);
+	if ((fd = socket(AF_NETLINK, SOCK_RAW | SOCK_NONBLOCK | SOCK_CLOEXEC,
+			 NETLINK_ROUTE)) < 0)
+		return -1;
 
-		if ((fp = fopen(filename, "r")) == NULL)
-			/* Cannot read NIC speed */
-			continue;
+	memset(&snl, 0, sizeof(snl));
+	snl.nl_family = AF_NETLINK;
+	snl.nl_groups = RTMGRP_LINK;
 
-		n = fscanf(fp, "%u", &st_net_dev_i->speed);
+	if (bind(fd, (struct sockaddr *) &snl, sizeof(snl)) < 0) {
+		close(fd);
+		return -1;
+	}
 
-		fclose(fp);
+	return fd;
+}
+
+/*
+ ***************************************************************************
+ * Read pending link notifications from rtnetlink socket and remove the
+ * interfaces they relate to from the speed and duplex cache.
+ *
+ * IN:
+ * @fd	rtnetlink socket descriptor.
+ ***************************************************************************
+ */
+void check_link_notifications(int fd)
+{
+	char buf[8192] __attribute__ ((aligned(NLMSG_ALIGNTO)));
+	struct nlmsghdr *nlh;
+	struct ifinfomsg *ifi;
+	struct rtattr *rta;
+	int len, alen;
+
+	while ((len = recv(fd, buf, sizeof(buf), MSG_DONTWAIT)) != 0) {
+
+		if (len < 0) {
+			if (errno == EINTR)
+				continue;
+			if (errno == ENOBUFS) {
+				/* Some notifications have been lost */
+				drop_if_info(NULL);
+				continue;
+			}
+			/* No more notifications (EAGAIN) */
+			break;
+		}
+
+		for (nlh = (struct nlmsghdr *) buf; NLMSG_OK(nlh, len); nlh = NLMSG_NEXT(nlh, len)) {
+
+			if ((nlh->nlmsg_type != RTM_NEWLINK) && (nlh->nlmsg_type != RTM_DELLINK))
+				continue;
+
+			ifi = (struct ifinfomsg *) NLMSG_DATA(nlh);
+			alen = IFLA_PAYLOAD(nlh);
 
-		if (n != 1) {
-			st_net_dev_i->speed = 0;
+			for (rta = IFLA_RTA(ifi); RTA_OK(rta, alen); rta = RTA_NEXT(rta, alen)) {
+				if (rta->rta_type == IFLA_IFNAME) {
+					drop_if_info((char *) RTA_DATA(rta));
+					break;
+				}
+			}
 		}
 	}
 }
 
+/*
+ ***************************************************************************
+ * Read duplex and speed data for network interface cards.
+ * Values are read from sysfs the first time an interface is seen, then
+ * saved and used again until an rtnetlink notification is received for
+ * that interface. Values are always read from sysfs if the rtnetlink socket
+ * cannot be opened. In TEST mode, no notifications are received, and the
+ * cache is emptied each time the test root directory is switched.
+ *
+ * IN:
+ * @st_net_dev	Structure where stats will be saved.
+ * @nbr		Number of network interfaces to read.
+ *
+ * OUT:
+ * @st_net_dev	Structure with statistics.
+ ***************************************************************************
+ */
+void read_if_info(struct stats_net_dev *st_net_dev, int nbr)
+{
+	struct stats_net_dev *st_net_dev_i;
+	struct if_info_ent *ie;
+	unsigned int h;
+	int dev, use_cache;
+#ifdef TEST
+	static unsigned int root_gen = 0;
+
+	if (root_gen != __root_gen) {
+		root_gen = __root_gen;
+		drop_if_info(NULL);
+	}
+	use_cache = TRUE;
+#else
+	if (if_info_nlfd == -2) {
+		/*
+		 * Open socket before reading sysfs for the first time, so
+		 * that no change can be missed.
+		 */
+		if_info_nlfd = open_link_notifications();
+	}
+	if (if_info_nlfd >= 0) {
+		check_link_notifications(if_info_nlfd);
+	}
+	use_cache = (if_info_nlfd >= 0);
+#endif
+
+	for (dev = 0; dev < nbr; dev++) {
+
+		st_net_dev_i = st_net_dev + dev;
+
+		if (use_cache) {
+			h = hash_if_name(st_net_dev_i->interface);
+			for (ie = if_info_cache[h]; ie != NULL; ie = ie->hnext) {
+				if (!strncmp(ie->interface, st_net_dev_i->interface, MAX_IFACE_LEN - 1))
+					break;
+			}
+			if (ie != NULL) {
+				/* Use values saved in cache */
+				st_net_dev_i->speed = ie->speed;
+				st_net_dev_i->duplex = ie->duplex;
+				continue;
+			}
+
+			read_if_speed_duplex(st_net_dev_i);
+
+			/* Save values in cache */
+			if ((ie = (struct if_info_ent *) malloc(sizeof(struct if_info_ent))) == NULL) {
+				perror("malloc");
+				exit(4);
+			}
+			strncpy(ie->interface, st_net_dev_i->interface, sizeof(ie->interface));
+			ie->interface[sizeof(ie->interface) - 1] = '\0';
+			ie->speed = st_net_dev_i->speed;
+			ie->duplex = st_net_dev_i->duplex;
+			ie->hnext = if_info_cache[h];
+			if_info_cache[h] = ie;
+			continue;
+		}
+		read_if_speed_duplex(st_net_dev_i);
+	}
+}
 
 /*
  ***************************************************************************
@@ -1292,88 +1693,415 @@ __nr_t read_net_edev(struct stats_net_edev *st_net_edev, __nr_t nr_alloc)
 	return dev_read;
 }
 
+/* Interface counters read from rtnetlink */
+static struct if_link_stats *link_stats = NULL;
+static __nr_t link_stats_nr = 0, link_stats_alloc = 0;
+/* Activities (RTNL_NET_DEV, RTNL_NET_EDEV) which have used current counters */
+static unsigned int link_stats_used = 0;
+
 /*
  ***************************************************************************
- * Read NFS client statistics from /proc/net/rpc/nfs.
+ * Send a RTM_GETLINK request to the kernel.
  *
  * IN:
- * @st_net_nfs	Structure where stats will be saved.
- *
- * OUT:
- * @st_net_nfs	Structure with statistics.
+ * @fd		rtnetlink socket descriptor.
+ * @seq		Sequence number of the request.
+ * @iface	Name or index of the interface to get, or NULL to dump all
+ *		the interfaces.
  *
  * RETURNS:
- * 1 on success, 0 otherwise.
+ * 0 on success, -1 otherwise.
  ***************************************************************************
  */
-__nr_t read_net_nfs(struct stats_net_nfs *st_net_nfs)
+int send_rtnl_getlink(int fd, unsigned int seq, char *iface)
 {
-	FILE *fp;
-	char line[256];
-	unsigned int getattcnt = 0, accesscnt = 0, readcnt = 0, writecnt = 0;
-
-	if ((fp = fopen(NET_RPC_NFS, "r")) == NULL)
-		return 0;
-
-	memset(st_net_nfs, 0, STATS_NET_NFS_SIZE);
-
-	while (fgets(line, sizeof(line), fp) != NULL) {
+	struct {
+		struct nlmsghdr nlh;
+		struct ifinfomsg ifi;
+		char attr[RTA_SPACE(MAX_IFACE_LEN)];
+	} req;
+	struct rtattr *rta;
+	size_t len;
+
+	memset(&req, 0, sizeof(req));
+	req.nlh.nlmsg_len = NLMSG_LENGTH(sizeof(struct ifinfomsg));
+	req.nlh.nlmsg_type = RTM_GETLINK;
+	req.nlh.nlmsg_flags = NLM_F_REQUEST;
+	req.nlh.nlmsg_seq = seq;
+	req.ifi.ifi_family = AF_UNSPEC;
+
+	if (!iface) {
+		req.nlh.nlmsg_flags |= NLM_F_DUMP;
+	}
+	else if (strspn(iface, DIGITS) == strlen(iface)) {
+		/* Interface selected by its index */
+		req.ifi.ifi_index = atoi(iface);
+	}
+	else {
+		/* Interface selected by its name */
+		len = MINIMUM(strlen(iface), MAX_IFACE_LEN - 1);
+		rta = (struct rtattr *) ((char *) &req + NLMSG_ALIGN(req.nlh.nlmsg_len));
+		rta->rta_type = IFLA_IFNAME;
+		rta->rta_len = RTA_LENGTH(len + 1);
+		memcpy(RTA_DATA(rta), iface, len);
+		req.nlh.nlmsg_len = NLMSG_ALIGN(req.nlh.nlmsg_len) + RTA_ALIGN(rta->rta_len);
+	}
 
-		if (!strncmp(line, "rpc ", 4)) {
-			sscanf(line + 4, "%u %u",
-			       &st_net_nfs->nfs_rpccnt, &st_net_nfs->nfs_rpcretrans);
-		}
-		else if (!strncmp(line, "proc3 ", 6)) {
-			sscanf(line + 6, "%*u %*u %u %*u %*u %u %*u %u %u",
-			       &getattcnt, &accesscnt, &readcnt, &writecnt);
+	if (send(fd, &req, req.nlh.nlmsg_len, 0) < 0)
+		return -1;
 
-			st_net_nfs->nfs_getattcnt += getattcnt;
-			st_net_nfs->nfs_accesscnt += accesscnt;
-			st_net_nfs->nfs_readcnt   += readcnt;
-			st_net_nfs->nfs_writecnt  += writecnt;
-		}
-		else if (!strncmp(line, "proc4 ", 6)) {
-			sscanf(line + 6, "%*u %*u %u %u "
-			       "%*u %*u %*u %*u %*u %*u %*u %*u %*u %*u %*u %*u %*u %*u %u %u",
-			       &readcnt, &writecnt, &accesscnt, &getattcnt);
+	return 0;
+}
 
-			st_net_nfs->nfs_getattcnt += getattcnt;
-			st_net_nfs->nfs_accesscnt += accesscnt;
-			st_net_nfs->nfs_readcnt   += readcnt;
-			st_net_nfs->nfs_writecnt  += writecnt;
+/*
+ ***************************************************************************
+ * Save the counters of an interface contained in a RTM_NEWLINK message.
+ * Counters are saved so that they have the same meaning as those displayed
+ * in /proc/net/dev.
+ *
+ * IN:
+ * @nlh		RTM_NEWLINK message.
+ ***************************************************************************
+ */
+void save_rtnl_link_stats(struct nlmsghdr *nlh)
+{
+	struct ifinfomsg *ifi = (struct ifinfomsg *) NLMSG_DATA(nlh);
+	struct rtattr *rta;
+	struct rtnl_link_stats64 st;
+	struct if_link_stats *ls;
+	char *name = NULL;
+	int alen = IFLA_PAYLOAD(nlh), has_stats = FALSE;
+
+	for (rta = IFLA_RTA(ifi); RTA_OK(rta, alen); rta = RTA_NEXT(rta, alen)) {
+		if (rta->rta_type == IFLA_IFNAME) {
+			name = (char *) RTA_DATA(rta);
+		}
+		else if (rta->rta_type == IFLA_STATS64) {
+			/* Attribute may be shorter (older kernel) and is not 64-bit aligned */
+			memset(&st, 0, sizeof(st));
+			memcpy(&st, RTA_DATA(rta), MINIMUM((size_t) RTA_PAYLOAD(rta), sizeof(st)));
+			has_stats = TRUE;
 		}
 	}
+	if (!name || !has_stats)
+		return;
 
-	fclose(fp);
-	return 1;
+	if (link_stats_nr >= link_stats_alloc) {
+		link_stats_alloc = link_stats_alloc ? link_stats_alloc * 2 : 64;
+		SREALLOC(link_stats, struct if_link_stats,
+			 sizeof(struct if_link_stats) * link_stats_alloc);
+	}
+	ls = link_stats + link_stats_nr++;
+
+	strncpy(ls->interface, name, sizeof(ls->interface));
+	ls->interface[sizeof(ls->interface) - 1] = '\0';
+	ls->rx_bytes          = st.rx_bytes;
+	ls->rx_packets        = st.rx_packets;
+	ls->rx_errors         = st.rx_errors;
+	ls->rx_dropped        = st.rx_dropped + st.rx_missed_errors;
+	ls->rx_fifo_errors    = st.rx_fifo_errors;
+	ls->rx_frame_errors   = st.rx_length_errors + st.rx_over_errors +
+				st.rx_crc_errors + st.rx_frame_errors;
+	ls->rx_compressed     = st.rx_compressed;
+	ls->multicast         = st.multicast;
+	ls->tx_bytes          = st.tx_bytes;
+	ls->tx_packets        = st.tx_packets;
+	ls->tx_errors         = st.tx_errors;
+	ls->tx_dropped        = st.tx_dropped;
+	ls->tx_fifo_errors    = st.tx_fifo_errors;
+	ls->collisions        = st.collisions;
+	ls->tx_carrier_errors = st.tx_carrier_errors + st.tx_aborted_errors +
+				st.tx_window_errors + st.tx_heartbeat_errors;
+	ls->tx_compressed     = st.tx_compressed;
 }
 
 /*
  ***************************************************************************
- * Read NFS server statistics from /proc/net/rpc/nfsd.
+ * Read network interfaces counters from rtnetlink: All the interfaces are
+ * read with a single RTM_GETLINK dump request, or only the selected ones
+ * are requested from the kernel.
+ * Counters are read only once per sample for activities A_NET_DEV and
+ * A_NET_EDEV: The second activity uses the counters read for the first one.
  *
  * IN:
- * @st_net_nfsd	Structure where stats will be saved.
- *
- * OUT:
- * @st_net_nfsd	Structure with statistics.
+ * @act_bit	Activity for which counters are read (RTNL_NET_DEV or
+ *		RTNL_NET_EDEV).
+ * @iface_list	Names or indexes of selected interfaces.
+ * @iface_nr	Number of selected interfaces (0 for all the interfaces).
  *
  * RETURNS:
- * 1 on success, 0 otherwise.
+ * Number of interfaces read, -1 if counters couldn't be read this time
+ * (e.g. a request failed), or -2 if rtnetlink cannot be used at all.
  ***************************************************************************
  */
-__nr_t read_net_nfsd(struct stats_net_nfsd *st_net_nfsd)
+__nr_t read_rtnl_link_stats(unsigned int act_bit, char **iface_list, int iface_nr)
 {
-	FILE *fp;
-	char line[256];
-	unsigned int getattcnt = 0, accesscnt = 0, readcnt = 0, writecnt = 0;
+	static int fd = -1;
+	static unsigned int seq = 0;
+	static char *buf = NULL;
+	struct nlmsghdr *nlh;
+	struct nlmsgerr *err;
+	int i = 0, len, done;
+
+#ifdef TEST
+	/* Counters of the test root directory cannot be read that way */
+	return -2;
+#endif
 
-	if ((fp = fopen(NET_RPC_NFSD, "r")) == NULL)
-		return 0;
+	if (link_stats_used && !(link_stats_used & act_bit))
+		/* Counters already read for current sample */
+		return link_stats_nr;
 
-	memset(st_net_nfsd, 0, STATS_NET_NFSD_SIZE);
+	link_stats_used = 0;
+	link_stats_nr = 0;
 
-	while (fgets(line, sizeof(line), fp) != NULL) {
+	if (fd < 0) {
+		if ((fd = socket(AF_NETLINK, SOCK_RAW | SOCK_CLOEXEC, NETLINK_ROUTE)) < 0)
+			return ((errno == EMFILE) || (errno == ENFILE) || (errno == ENOBUFS) ||
+				(errno == ENOMEM)) ? -1 : -2;
+	}
+	if (!buf) {
+		SREALLOC(buf, char, RTNL_BUF_SIZE);
+	}
+
+	do {
+		/* Dump all the interfaces, or get only current selected one */
+		if (send_rtnl_getlink(fd, ++seq, iface_nr ? iface_list[i] : NULL) < 0)
+			goto error;
+
+		done = FALSE;
+		while (!done) {
+			if ((len = recv(fd, buf, RTNL_BUF_SIZE, 0)) <= 0) {
+				if ((len < 0) && (errno == EINTR))
+					continue;
+				goto error;
+			}
+
+			for (nlh = (struct nlmsghdr *) buf; NLMSG_OK(nlh, len) && !done;
+			     nlh = NLMSG_NEXT(nlh, len)) {
+
+				if (nlh->nlmsg_seq != seq)
+					/* Reply to a previous request */
+					continue;
+
+				switch (nlh->nlmsg_type) {
+
+				case NLMSG_DONE:
+					/* End of dump */
+					done = TRUE;
+					break;
+
+				case NLMSG_ERROR:
+					err = (struct nlmsgerr *) NLMSG_DATA(nlh);
+					if (!iface_nr || (err->error != -ENODEV))
+						goto error;
+					/* Selected interface doesn't exist */
+					done = TRUE;
+					break;
+
+				case RTM_NEWLINK:
+					save_rtnl_link_stats(nlh);
+					/* Only one reply if the interface has been selected */
+					done = (iface_nr > 0);
+					break;
+				}
+			}
+		}
+	}
+	while (++i < iface_nr);
+
+	return link_stats_nr;
+
+error:
+	close(fd);
+	fd = -1;
+	return -1;
+}
+
+/*
+ ***************************************************************************
+ * Read network interfaces statistics from rtnetlink.
+ *
+ * IN:
+ * @st_net_dev	Structure where stats will be saved.
+ * @nr_alloc	Total number of structures allocated. Value is >= 1.
+ * @iface_list	Names or indexes of selected interfaces.
+ * @iface_nr	Number of selected interfaces (0 for all the interfaces).
+ *
+ * OUT:
+ * @st_net_dev	Structure with statistics.
+ *
+ * RETURNS:
+ * Number of interfaces read, or -1 if the buffer was too small and
+ * needs to be reallocated, -2 if counters couldn't be read this time,
+ * or -3 if rtnetlink cannot be used at all.
+ ***************************************************************************
+ */
+__nr_t read_net_dev_rtnl(struct stats_net_dev *st_net_dev, __nr_t nr_alloc,
+			 char **iface_list, int iface_nr)
+{
+	struct stats_net_dev *st_net_dev_i;
+	struct if_link_stats *ls;
+	__nr_t dev, rc;
+
+	if ((rc = read_rtnl_link_stats(RTNL_NET_DEV, iface_list, iface_nr)) < 0)
+		return rc - 1;
+
+	if (link_stats_nr > nr_alloc)
+		return -1;
+
+	for (dev = 0; dev < link_stats_nr; dev++) {
+		st_net_dev_i = st_net_dev + dev;
+		ls = link_stats + dev;
+
+		strcpy(st_net_dev_i->interface, ls->interface);
+		st_net_dev_i->rx_bytes = ls->rx_bytes;
+		st_net_dev_i->rx_packets = ls->rx_packets;
+		st_net_dev_i->rx_compressed = ls->rx_compressed;
+		st_net_dev_i->multicast = ls->multicast;
+		st_net_dev_i->tx_bytes = ls->tx_bytes;
+		st_net_dev_i->tx_packets = ls->tx_packets;
+		st_net_dev_i->tx_compressed = ls->tx_compressed;
+	}
+	link_stats_used |= RTNL_NET_DEV;
+
+	return link_stats_nr;
+}
+
+/*
+ ***************************************************************************
+ * Read network interfaces errors statistics from rtnetlink.
+ *
+ * IN:
+ * @st_net_edev	Structure where stats will be saved.
+ * @nr_alloc	Total number of structures allocated. Value is >= 1.
+ * @iface_list	Names or indexes of selected interfaces.
+ * @iface_nr	Number of selected interfaces (0 for all the interfaces).
+ *
+ * OUT:
+ * @st_net_edev	Structure with statistics.
+ *
+ * RETURNS:
+ * Number of interfaces read, or -1 if the buffer was too small and
+ * needs to be reallocated, -2 if counters couldn't be read this time,
+ * or -3 if rtnetlink cannot be used at all.
+ ***************************************************************************
+ */
+__nr_t read_net_edev_rtnl(struct stats_net_edev *st_net_edev, __nr_t nr_alloc,
+			  char **iface_list, int iface_nr)
+{
+	struct stats_net_edev *st_net_edev_i;
+	struct if_link_stats *ls;
+	__nr_t dev, rc;
+
+	if ((rc = read_rtnl_link_stats(RTNL_NET_EDEV, iface_list, iface_nr)) < 0)
+		return rc - 1;
+
+	if (link_stats_nr > nr_alloc)
+		return -1;
+
+	for (dev = 0; dev < link_stats_nr; dev++) {
+		st_net_edev_i = st_net_edev + dev;
+		ls = link_stats + dev;
+
+		strcpy(st_net_edev_i->interface, ls->interface);
+		st_net_edev_i->rx_errors = ls->rx_errors;
+		st_net_edev_i->rx_dropped = ls->rx_dropped;
+		st_net_edev_i->rx_fifo_errors = ls->rx_fifo_errors;
+		st_net_edev_i->rx_frame_errors = ls->rx_frame_errors;
+		st_net_edev_i->tx_errors = ls->tx_errors;
+		st_net_edev_i->tx_dropped = ls->tx_dropped;
+		st_net_edev_i->tx_fifo_errors = ls->tx_fifo_errors;
+		st_net_edev_i->collisions = ls->collisions;
+		st_net_edev_i->tx_carrier_errors = ls->tx_carrier_errors;
+	}
+	link_stats_used |= RTNL_NET_EDEV;
+
+	return link_stats_nr;
+}
+
+/*
+ ***************************************************************************
+ * Read NFS client statistics from /proc/net/rpc/nfs.
+ *
+ * IN:
+ * @st_net_nfs	Structure where stats will be saved.
+ *
+ * OUT:
+ * @st_net_nfs	Structure with statistics.
+ *
+ * RETURNS:
+ * 1 on success, 0 otherwise.
+ ***************************************************************************
+ */
+__nr_t read_net_nfs(struct stats_net_nfs *st_net_nfs)
+{
+	FILE *fp;
+	char line[256];
+	unsigned int getattcnt = 0, accesscnt = 0, readcnt = 0, writecnt = 0;
+
+	if ((fp = fopen(NET_RPC_NFS, "r")) == NULL)
+		return 0;
+
+	memset(st_net_nfs, 0, STATS_NET_NFS_SIZE);
+
+	while (fgets(line, sizeof(line), fp) != NULL) {
+
+		if (!strncmp(line, "rpc ", 4)) {
+			sscanf(line + 4, "%u %u",
+			       &st_net_nfs->nfs_rpccnt, &st_net_nfs->nfs_rpcretrans);
+		}
+		else if (!strncmp(line, "proc3 ", 6)) {
+			sscanf(line + 6, "%*u %*u %u %*u %*u %u %*u %u %u",
+			       &getattcnt, &accesscnt, &readcnt, &writecnt);
+
+			st_net_nfs->nfs_getattcnt += getattcnt;
+			st_net_nfs->nfs_accesscnt += accesscnt;
+			st_net_nfs->nfs_readcnt   += readcnt;
+			st_net_nfs->nfs_writecnt  += writecnt;
+		}
+		else if (!strncmp(line, "proc4 ", 6)) {
+			sscanf(line + 6, "%*u %*u %u %u "
+			       "%*u %*u %*u %*u %*u %*u %*u %*u %*u %*u %*u %*u %*u %*u %u %u",
+			       &readcnt, &writecnt, &accesscnt, &getattcnt);
+
+			st_net_nfs->nfs_getattcnt += getattcnt;
+			st_net_nfs->nfs_accesscnt += accesscnt;
+			st_net_nfs->nfs_readcnt   += readcnt;
+			st_net_nfs->nfs_writecnt  += writecnt;
+		}
+	}
+
+	fclose(fp);
+	return 1;
+}
+
+/*
+ ***************************************************************************
+ * Read NFS server statistics from /proc/net/rpc/nfsd.
+ *
+ * IN:
+ * @st_net_nfsd	Structure where stats will be saved.
+ *
+ * OUT:
+ * @st_net_nfsd	Structure with statistics.
+ *
+ * RETURNS:
+ * 1 on success, 0 otherwise.
+ ***************************************************************************
+ */
+__nr_t read_net_nfsd(struct stats_net_nfsd *st_net_nfsd)
+{
+	FILE *fp;
+	char line[256];
+	unsigned int getattcnt = 0, accesscnt = 0, readcnt = 0, writecnt = 0;
+
+	if ((fp = fopen(NET_RPC_NFSD, "r")) == NULL)
+		return 0;
+
+	memset(st_net_nfsd, 0, STATS_NET_NFSD_SIZE);
+
+	while (fgets(line, sizeof(line), fp) != NULL) {
 
 		if (!strncmp(line, "rc ", 3)) {
 			sscanf(line + 3, "%u %u",
@@ -2282,6 +3010,190 @@ __nr_t read_cpuinfo(struct stats_pwr_cpufreq *st_pwr_cpufreq, __nr_t nr_alloc)
 	return cpu_read;
 }
 
+/*
+ ***************************************************************************
+ * Close descriptors kept open on per-CPU files until no more than @max
+ * are left open. Descriptors of the CPU with the highest numbers are
+ * closed first.
+ *
+ * IN:
+ * @fd		Descriptors kept open for each CPU (or -1).
+ * @fd_nr	Number of entries in @fd.
+ * @fd_open	Number of descriptors open in @fd.
+ * @max		Max number of descriptors that may be kept open.
+ *
+ * OUT:
+ * @fd		Descriptors still kept open (or -1).
+ * @fd_open	Number of descriptors still open in @fd.
+ ***************************************************************************
+ */
+void shrink_cpu_fds(int fd[], int fd_nr, int *fd_open, int max)
+{
+	int cpu;
+
+	for (cpu = fd_nr - 1; (cpu >= 0) && (*fd_open > max); cpu--) {
+		if (fd[cpu] >= 0) {
+			close(fd[cpu]);
+			fd[cpu] = -1;
+			(*fd_open)--;
+		}
+	}
+}
+
+/*
+ ***************************************************************************
+ * Read current CPU frequencies from cpufreq/scaling_cur_freq files in sysfs.
+ * Contrary to /proc/cpuinfo, whose generation may interrupt every CPU to
+ * compute its frequency, reading these files doesn't disturb the machine.
+ * Files are kept open from one sample to the next, up to CPU_FD_MAX of them
+ * (fewer if we run out of descriptors). The others are opened each time.
+ *
+ * IN:
+ * @st_pwr_cpufreq	Structure where stats will be saved.
+ * @nr_alloc		Total number of structures allocated. Value is >= 1.
+ * @subset		Read the frequency of one CPU out of @subset at each
+ *			call, rotating among CPU. Frequencies of other CPU are
+ *			those read during previous calls. A value of 1 means
+ *			that the frequency of every CPU is read.
+ *
+ * OUT:
+ * @st_pwr_cpufreq	Structure with statistics.
+ *
+ * RETURNS:
+ * Highest CPU number for which statistics have been read.
+ * 1 means CPU "all", 2 means CPU 0, 3 means CPU 1, etc.
+ * Or -1 if the buffer was too small and needs to be reallocated,
+ * or 0 if no scaling_cur_freq files are available (read_cpuinfo() should
+ * be used instead).
+ ***************************************************************************
+ */
+__nr_t read_cpu_cur_freq(struct stats_pwr_cpufreq *st_pwr_cpufreq, __nr_t nr_alloc,
+			 int subset)
+{
+	static int *fd = NULL;
+	static unsigned long *freq = NULL;
+	static int fd_nr = 0, round = 0, fd_open = 0, fd_max = CPU_FD_MAX;
+	struct stats_pwr_cpufreq *st_pwr_cpufreq_i;
+	char filename[MAX_PF_NAME], line[64];
+	int cpu, nr = 0, avail = FALSE;
+	__nr_t cpu_read = 1;	/* For CPU "all" */
+	ssize_t n;
+
+	/* Check that there is no CPU beyond those for which buffer is allocated */
+	snprintf(filename, sizeof(filename), "%s/cpu%d", SYSFS_DEVCPU, nr_alloc - 1);
+	filename[sizeof(filename) - 1] = '\0';
+	if (!access(filename, F_OK))
+		return -1;
+
+	if (nr_alloc - 1 > fd_nr) {
+		/* New CPU (or first call): Their files will be opened below */
+		SREALLOC(fd, int, sizeof(int) * (nr_alloc - 1));
+		SREALLOC(freq, unsigned long, sizeof(unsigned long) * (nr_alloc - 1));
+		for (cpu = fd_nr; cpu < nr_alloc - 1; cpu++) {
+			fd[cpu] = -1;
+			freq[cpu] = 0;
+		}
+		fd_nr = nr_alloc - 1;
+		/* Read every CPU this time */
+		round = 0;
+	}
+	if (subset < 1) {
+		subset = 1;
+	}
+
+	for (cpu = 0; cpu < fd_nr; cpu++) {
+
+		/* Read frequency of all CPU for first call, then only a subset of them */
+		if (round && (cpu % subset != round % subset)) {
+			if (freq[cpu] || (fd[cpu] >= 0)) {
+				avail = TRUE;
+			}
+			continue;
+		}
+
+		if (fd[cpu] < 0) {
+			snprintf(filename, sizeof(filename), "%s/cpu%d/%s",
+				 SYSFS_DEVCPU, cpu, SYSFS_CUR_FREQ);
+			filename[sizeof(filename) - 1] = '\0';
+
+			/* May fail if CPU is offline or has no cpufreq support */
+			if (((fd[cpu] = open(filename, O_RDONLY)) < 0) &&
+			    ((errno == EMFILE) || (errno == ENFILE)) && fd_open) {
+				/* Out of descriptors: Keep fewer files open and try again */
+				fd_max = fd_open / 2;
+				shrink_cpu_fds(fd, fd_nr, &fd_open, fd_max);
+				fd[cpu] = open(filename, O_RDONLY);
+			}
+			if (fd[cpu] >= 0) {
+				fd_open++;
+			}
+			else if ((errno == EMFILE) || (errno == ENFILE)) {
+				/* CPU is not offline: Keep its previous frequency */
+				if (freq[cpu]) {
+					avail = TRUE;
+				}
+				continue;
+			}
+		}
+
+		freq[cpu] = 0;
+		if (fd[cpu] < 0)
+			continue;
+		avail = TRUE;
+
+		if ((n = pread(fd[cpu], line, sizeof(line) - 1, 0)) > 0) {
+			line[n] = '\0';
+			/* Frequency is given in kHz. Save it in MHz x 100 */
+			freq[cpu] = strtoul(line, NULL, 10) / 10;
+		}
+		else {
+			/* CPU has probably gone offline: Open its file again next time */
+			close(fd[cpu]);
+			fd[cpu] = -1;
+			fd_open--;
+		}
+#ifndef TEST
+		if ((fd[cpu] >= 0) && (fd_open > fd_max))
+#else
+		/* In test mode, files change at each time step */
+		if (fd[cpu] >= 0)
+#endif
+		{
+			/* Don't keep the file open */
+			close(fd[cpu]);
+			fd[cpu] = -1;
+			fd_open--;
+		}
+	}
+	round++;
+
+	if (!avail)
+		return 0;
+
+	st_pwr_cpufreq->cpufreq = 0;
+
+	for (cpu = 0; cpu < fd_nr; cpu++) {
+		if (!freq[cpu])
+			/* CPU offline or frequency unknown */
+			continue;
+
+		st_pwr_cpufreq_i = st_pwr_cpufreq + cpu + 1;
+		st_pwr_cpufreq_i->cpufreq = freq[cpu];
+
+		/* Also save it to compute an average CPU frequency */
+		st_pwr_cpufreq->cpufreq += freq[cpu];
+		nr++;
+
+		cpu_read = cpu + 2;
+	}
+
+	if (nr) {
+		/* Compute average CPU frequency for this machine */
+		st_pwr_cpufreq->cpufreq /= nr;
+	}
+	return cpu_read;
+}
+
 /*
  ***************************************************************************
  * Read hugepages statistics from /proc/meminfo.
@@ -2343,6 +3255,10 @@ __nr_t read_meminfo_huge(struct stats_huge *st_huge)
 /*
  ***************************************************************************
  * Read CPU average frequencies statistics.
+ * The time_in_state file of each CPU is opened once and then kept open
+ * (except in TEST mode): It is read again from offset 0 at each sample.
+ * No more than CPU_FD_MAX files are kept open (fewer if we run out of
+ * descriptors). The others are opened each time.
  *
  * IN:
  * @st_pwr_wghfreq	Structure where stats will be saved.
@@ -2358,33 +3274,83 @@ __nr_t read_meminfo_huge(struct stats_huge *st_huge)
  */
 int read_time_in_state(struct stats_pwr_wghfreq *st_pwr_wghfreq, int cpu_nr, int nbr)
 {
-	FILE *fp;
+	/* Buffer shared by all CPU: Only the file descriptor is saved per CPU */
+	static struct file_buf fb = {.fd = -1};
+	static int *fd = NULL;
+	static int fd_nr = 0, fd_open = 0, fd_max = CPU_FD_MAX;
 	struct stats_pwr_wghfreq *st_pwr_wghfreq_j;
 	char filename[MAX_PF_NAME];
-	char line[128];
-	int j = 0;
+	char *p, *q;
+	int i, j = 0, opened;
+	ssize_t n;
 	unsigned long freq;
 	unsigned long long time_in_state;
 
+	if (cpu_nr >= fd_nr) {
+		/* First call or new CPU */
+		SREALLOC(fd, int, sizeof(int) * (cpu_nr + 1));
+		for (i = fd_nr; i <= cpu_nr; i++) {
+			fd[i] = -1;
+		}
+		fd_nr = cpu_nr + 1;
+	}
+
 	snprintf(filename, MAX_PF_NAME, "%s/cpu%d/%s",
 		 SYSFS_DEVCPU, cpu_nr, SYSFS_TIME_IN_STATE);
-	if ((fp = fopen(filename, "r")) == NULL)
+
+	opened = (fd[cpu_nr] < 0);
+	fb.fd = fd[cpu_nr];
+	if (!opened) {
+		/* Descriptor is now managed by read_file_buf() */
+		fd[cpu_nr] = -1;
+		fd_open--;
+	}
+	if (((n = read_file_buf(filename, &fb)) < 0) && !opened) {
+		/*
+		 * File may have been removed then created again (CPU gone offline
+		 * then back online): Try to open it again once.
+		 */
+		n = read_file_buf(filename, &fb);
+	}
+	if ((n < 0) && ((errno == EMFILE) || (errno == ENFILE)) && fd_open) {
+		/* Out of descriptors: Keep fewer files open and try again */
+		fd_max = fd_open / 2;
+		shrink_cpu_fds(fd, fd_nr, &fd_open, fd_max);
+		n = read_file_buf(filename, &fb);
+	}
+	if (fb.fd >= 0) {
+		if (fd_open < fd_max) {
+			/* Keep the file open for next samples */
+			fd[cpu_nr] = fb.fd;
+			fd_open++;
+		}
+		else {
+			close(fb.fd);
+		}
+		fb.fd = -1;
+	}
+	if (n < 0)
 		return 0;
 
-	while (fgets(line, sizeof(line), fp) != NULL) {
+	/* Each line contains a frequency followed by the time spent at this frequency */
+	for (p = fb.buf; *p && (j < nbr); ) {
+		freq = strtoul(p, &q, 10);
+		if (q == p)
+			break;
+		time_in_state = strtoull(q, &p, 10);
 
-		sscanf(line, "%lu %llu", &freq, &time_in_state);
+		/* Save current frequency and time */
+		st_pwr_wghfreq_j = st_pwr_wghfreq + j;
+		st_pwr_wghfreq_j->freq = freq;
+		st_pwr_wghfreq_j->time_in_state = time_in_state;
+		j++;
 
-		if (j < nbr) {
-			/* Save current frequency and time */
-			st_pwr_wghfreq_j = st_pwr_wghfreq + j;
-			st_pwr_wghfreq_j->freq = freq;
-			st_pwr_wghfreq_j->time_in_state = time_in_state;
-			j++;
+		/* Go to next line */
+		while (*p && (*p != '\n')) {
+			p++;
 		}
 	}
 
-	fclose(fp);
 	return 1;
 }
 
@@ -2583,34 +3549,62 @@ __nr_t read_bus_usb_dev(struct stats_pwr_usb *st_pwr_usb, __nr_t nr_alloc)
 	return usb_read;
 }
 
+/* Filesystems read from the mount table, kept until the table changes */
+static struct fs_mount *mount_list = NULL;
+static int mount_nr = 0, mount_alloc = 0;
+
 /*
  ***************************************************************************
- * Read filesystems statistics.
+ * Add a filesystem to the list read from the mount table.
  *
  * IN:
- * @st_filesystem	Structure where stats will be saved.
- * @nr_alloc		Total number of structures allocated. Value is >= 0.
- *
- * OUT:
- * @st_filesystem	Structure with statistics.
- *
- * RETURNS:
- * Number of filesystems read, or -1 if the buffer was too small and
- * needs to be reallocated.
+ * @fs_name	Filesystem name.
+ * @mountp	Mount point of the filesystem.
+ * @fs_filter	Filesystems to collect (NULL or empty to collect all of them).
  ***************************************************************************
  */
-__nr_t read_filesystem(struct stats_filesystem *st_filesystem, __nr_t nr_alloc)
+void add_mount_list(char *fs_name, char *mountp, struct glob_filter *fs_filter)
 {
-	FILE *fp;
-	char line[512], fs_name[MAX_FS_LEN], mountp[256], type[128];
-	int skip, skip_next = 0, fs;
-	char *pos = 0, *pos2 = 0;
-	__nr_t fs_read = 0;
-	struct stats_filesystem *st_filesystem_i;
-	struct statvfs buf;
+	struct fs_mount *mnt_i;
+
+	if (fs_filter && !pass_glob_filter(fs_filter, fs_name, mountp))
+		/* Filesystem not selected */
+		return;
+
+	if (mount_nr >= mount_alloc) {
+		mount_alloc = mount_alloc ? mount_alloc * 2 : 64;
+		SREALLOC(mount_list, struct fs_mount, sizeof(struct fs_mount) * mount_alloc);
+	}
+	mnt_i = mount_list + mount_nr++;
+
+	strncpy(mnt_i->fs_name, fs_name, sizeof(mnt_i->fs_name));
+	mnt_i->fs_name[sizeof(mnt_i->fs_name) - 1] = '\0';
+	strncpy(mnt_i->mountp, mountp, sizeof(mnt_i->mountp));
+	mnt_i->mountp[sizeof(mnt_i->mountp) - 1] = '\0';
+	mnt_i->rc = -1;
+	mnt_i->stale = FALSE;
+}
+
+/*
+ ***************************************************************************
+ * Parse the mount table file and save the filesystems which may be
+ * displayed.
+ *
+ * IN:
+ * @fs_filter	Filesystems to collect (NULL or empty to collect all of them).
+ ***************************************************************************
+ */
+void parse_mount_table(struct glob_filter *fs_filter)
+{
+	FILE *fp;
+	char line[512], fs_name[MAX_FS_LEN], mountp[256], type[128];
+	int skip, skip_next = 0;
+	char *pos = 0, *pos2 = 0;
+
+	mount_nr = 0;
 
 	if ((fp = fopen(MTAB, "r")) == NULL)
-		return 0;
+		return;
 
 	while (fgets(line, sizeof(line), fp) != NULL) {
 		/*
@@ -2659,44 +3653,663 @@ __nr_t read_filesystem(struct stats_filesystem *st_filesystem, __nr_t nr_alloc)
 			/* Replace octal codes */
 			oct2chr(mountp);
 
+			add_mount_list(fs_name, mountp, fs_filter);
+		}
+	}
+
+	fclose(fp);
+}
+
+#if !defined(TEST) && defined(__NR_listmount)
+/*
+ ***************************************************************************
+ * Get the filesystems which may be displayed using listmount() and
+ * statmount() system calls. Unlike the mount table file, options of the
+ * filesystems (which may be very long for overlay filesystems) are not
+ * formatted by the kernel.
+ *
+ * IN:
+ * @fs_filter	Filesystems to collect (NULL or empty to collect all of them).
+ *
+ * RETURNS:
+ * 0 on success, -1 if the system calls are not supported by the kernel,
+ * -2 if they failed for another reason (the mount table file should then
+ * be read instead this time).
+ ***************************************************************************
+ */
+int list_mounts(struct glob_filter *fs_filter)
+{
+	static struct sa_statmount *sm = NULL;
+	struct sa_mnt_id_req req;
+	unsigned long long id[LISTMOUNT_BATCH];
+	unsigned long long mask = STATMOUNT_SB_SOURCE | STATMOUNT_MNT_POINT | STATMOUNT_FS_TYPE;
+	long i, n;
+
+	if (!sm) {
+		if ((sm = (struct sa_statmount *) malloc(STATMOUNT_BUF_SIZE)) == NULL) {
+			perror("malloc");
+			exit(4);
+		}
+	}
+
+	mount_nr = 0;
+	memset(&req, 0, sizeof(req));
+	req.size = MNT_ID_REQ_SIZE_VER0;
+	req.mnt_id = LSMT_ROOT;
+
+	do {
+		/* Get next mount IDs, starting after the last one we got */
+		if ((n = syscall(__NR_listmount, &req, id, LISTMOUNT_BATCH, 0)) < 0)
+			return ((errno == ENOSYS) || (errno == EINVAL)) ? -1 : -2;
+
+		for (i = 0; i < n; i++) {
+			struct sa_mnt_id_req sreq;
+
+			memset(&sreq, 0, sizeof(sreq));
+			sreq.size = MNT_ID_REQ_SIZE_VER0;
+			sreq.mnt_id = id[i];
+			sreq.param = mask;
+
+			if (syscall(__NR_statmount, &sreq, sm, STATMOUNT_BUF_SIZE, 0) < 0) {
+				if ((errno == ENOENT) || (errno == EOVERFLOW))
+					/* Filesystem unmounted in the meantime, or names too long */
+					continue;
+				return ((errno == ENOSYS) || (errno == EINVAL)) ? -1 : -2;
+			}
+			if ((sm->mask & mask) != mask)
+				/* Mount source not supported by this kernel */
+				return -1;
+
+			if ((sm->str[sm->sb_source] != '/') ||
+			    !strcmp(sm->str + sm->fs_type, "autofs"))
+				continue;
+
+			add_mount_list(sm->str + sm->sb_source, sm->str + sm->mnt_point,
+				       fs_filter);
+		}
+		if (n) {
+			req.param = id[n - 1];
+		}
+	}
+	while (n == LISTMOUNT_BATCH);
+
+	return 0;
+}
+#endif
+
+#ifndef TEST
+/*
+ ***************************************************************************
+ * Open the kernel's mount table, which can be polled to know when it has
+ * changed. This is possible only if the mount table file (/etc/mtab) is
+ * the kernel's one (usually a symbolic link to /proc/self/mounts).
+ *
+ * RETURNS:
+ * File descriptor to poll, or -1 if the mount table can't be polled.
+ ***************************************************************************
+ */
+int open_mount_table(void)
+{
+	struct stat st1, st2;
+
+	if ((stat(MTAB, &st1) < 0) || (stat(SELF_MOUNTS, &st2) < 0) ||
+	    (st1.st_dev != st2.st_dev) || (st1.st_ino != st2.st_ino))
+		return -1;
+
+	return open(SELF_MOUNTS, O_RDONLY);
+}
+#endif
+
+/*
+ ***************************************************************************
+ * Read the list of filesystems which may be displayed from the mount table.
+ * The list is kept from one call to the next, and read again only when the
+ * kernel signals that the mount table has changed (POLLPRI/POLLERR events
+ * on /proc/self/mounts). listmount() and statmount() system calls are then
+ * used if the kernel supports them.
+ * In TEST mode, the mount table file is read again each time the test root
+ * directory is switched.
+ * Filesystems not selected by @fs_filter are not saved in the list, so that
+ * statvfs() is never called for them. The same filter should be used at
+ * each call since the list may be kept.
+ *
+ * IN:
+ * @fs_filter	Filesystems to collect (NULL or empty to collect all of them).
+ *
+ * OUT:
+ * @mnt		List of filesystems.
+ *
+ * RETURNS:
+ * Number of filesystems in list.
+ ***************************************************************************
+ */
+int read_mount_list(struct fs_mount **mnt, struct glob_filter *fs_filter)
+{
+#ifndef TEST
+	static int mounts_fd = -2, use_listmount = TRUE;
+	struct pollfd pfd;
+#ifdef __NR_listmount
+	int rc = -1;
+#endif
+
+	if (mounts_fd == -2) {
+		/*
+		 * First call: Open the mount table before reading it
+		 * so that no change can be missed.
+		 */
+		mounts_fd = open_mount_table();
+	}
+	else if (mounts_fd >= 0) {
+		pfd.fd = mounts_fd;
+		pfd.events = POLLPRI;
+		pfd.revents = 0;
+
+		if (poll(&pfd, 1, 0) == 0) {
+			/* Mount table unchanged */
+			*mnt = mount_list;
+			return mount_nr;
+		}
+	}
+
+#ifdef __NR_listmount
+	if ((mounts_fd >= 0) && use_listmount &&
+	    ((rc = list_mounts(fs_filter)) == -1)) {
+		/* System calls not supported: Don't try them again */
+		use_listmount = FALSE;
+	}
+	if ((mounts_fd < 0) || (rc < 0)) {
+		parse_mount_table(fs_filter);
+	}
+#else
+	parse_mount_table(fs_filter);
+#endif
+#else
+	static unsigned int root_gen = 0;
+	static int mount_read = FALSE;
+
+	if (mount_read && (root_gen == __root_gen)) {
+		/* Test root directory not switched: Mount table unchanged */
+		*mnt = mount_list;
+		return mount_nr;
+	}
+	root_gen = __root_gen;
+	mount_read = TRUE;
+
+	parse_mount_table(fs_filter);
+#endif
+
+	*mnt = mount_list;
+	return mount_nr;
+}
+
+/*
+ ***************************************************************************
+ * Get the sizes of a filesystem.
+ *
+ * IN:
+ * @mountp	Mount point of the filesystem.
+ *
+ * OUT:
+ * @usage	Filesystem sizes.
+ *
+ * RETURNS:
+ * 0 on success, -1 otherwise.
+ ***************************************************************************
+ */
+int get_fs_usage(char *mountp, struct fs_usage *usage)
+{
+	struct statvfs buf;
+
+	/*
+	 * It's important to have read the whole mount point name
+	 * for statvfs() to work properly (see parse_mount_table()).
+	 */
+	if (__statvfs(mountp, &buf) < 0)
+		return -1;
+
+	usage->f_blocks = (unsigned long long) buf.f_blocks * (unsigned long long) buf.f_frsize;
+	usage->f_bfree  = (unsigned long long) buf.f_bfree * (unsigned long long) buf.f_frsize;
+	usage->f_bavail = (unsigned long long) buf.f_bavail * (unsigned long long) buf.f_frsize;
+	usage->f_files  = (unsigned long long) buf.f_files;
+	usage->f_ffree  = (unsigned long long) buf.f_ffree;
+
+	return 0;
+}
+
+#ifndef TEST
+/* Filesystems known by statvfs() helper threads, indexed by mount point */
+static struct fs_statvfs_ent *fs_statvfs_cache[FS_STATVFS_CACHE_SIZE];
+/* Protects the entries above and the jobs of helper threads */
+static pthread_mutex_t fs_statvfs_mutex = PTHREAD_MUTEX_INITIALIZER;
+/* Signaled each time a statvfs() call has been made by a helper thread */
+static pthread_cond_t fs_statvfs_cond;
+
+/*
+ ***************************************************************************
+ * Release a job used by statvfs() helper threads. The job is freed when
+ * no more threads use it. Must be called with fs_statvfs_mutex held.
+ *
+ * IN:
+ * @job		Job to release.
+ ***************************************************************************
+ */
+void put_fs_statvfs_job(struct fs_statvfs_job *job)
+{
+	if (--job->refcnt == 0) {
+		free(job->item);
+		free(job);
+	}
+}
+
+/*
+ ***************************************************************************
+ * statvfs() helper thread: Get the sizes of the filesystems of a job, one
+ * after the other, until the job is complete or the thread is no longer
+ * in charge of it (because the deadline of the sample has passed).
+ *
+ * IN:
+ * @arg		Job, followed by the identifier of the thread.
+ *
+ * RETURNS:
+ * NULL.
+ ***************************************************************************
+ */
+void *fs_statvfs_thread(void *arg)
+{
+	struct fs_statvfs_job *job = ((struct fs_statvfs_job **) arg)[0];
+	unsigned int owner = (unsigned int) (uintptr_t) ((void **) arg)[1];
+	struct fs_statvfs_item *item;
+	struct fs_usage usage;
+	int rc;
+
+	free(arg);
+
+	pthread_mutex_lock(&fs_statvfs_mutex);
+
+	while ((job->owner == owner) && (job->next < job->nr)) {
+		item = job->item + job->next++;
+		item->state = FS_ITEM_RUNNING;
+
+		pthread_mutex_unlock(&fs_statvfs_mutex);
+		rc = get_fs_usage(item->ent->mountp, &usage);
+		pthread_mutex_lock(&fs_statvfs_mutex);
+
+		if (item->state == FS_ITEM_ABANDONED) {
 			/*
-			 * It's important to have read the whole mount point name
-			 * for statvfs() to work properly (see above).
+			 * Main thread didn't wait for us: Save statistics now
+			 * so that they can be used at next sample.
 			 */
-			if ((__statvfs(mountp, &buf) < 0) || (!buf.f_blocks))
-				continue;
+			if (!rc) {
+				item->ent->usage = usage;
+			}
+			item->ent->valid = !rc;
+			item->ent->busy--;
+		}
+		else {
+			item->usage = usage;
+			item->rc = rc;
+			item->state = FS_ITEM_DONE;
+		}
+		pthread_cond_broadcast(&fs_statvfs_cond);
+	}
 
-			/* Check if it's a duplicate entry */
-			fs = fs_read - 1;
-			while (fs >= 0) {
-				st_filesystem_i = st_filesystem + fs;
-				if (!strcmp(st_filesystem_i->fs_name, fs_name))
-					break;
-				fs--;
+	put_fs_statvfs_job(job);
+	pthread_mutex_unlock(&fs_statvfs_mutex);
+
+	return NULL;
+}
+
+/*
+ ***************************************************************************
+ * Start a new statvfs() helper thread in charge of a job. All signals are
+ * blocked in the thread so that they are still delivered to the main one.
+ * Must be called with fs_statvfs_mutex held.
+ *
+ * IN:
+ * @job		Job to process.
+ *
+ * RETURNS:
+ * 0 on success, -1 if the thread couldn't be created.
+ ***************************************************************************
+ */
+int start_fs_statvfs_thread(struct fs_statvfs_job *job)
+{
+	pthread_t tid;
+	pthread_attr_t attr;
+	sigset_t set, oldset;
+	void **arg;
+	int rc;
+
+	if ((arg = (void **) malloc(2 * sizeof(void *))) == NULL) {
+		perror("malloc");
+		exit(4);
+	}
+	arg[0] = job;
+	arg[1] = (void *) (uintptr_t) ++job->owner;
+
+	pthread_attr_init(&attr);
+	pthread_attr_setdetachstate(&attr, PTHREAD_CREATE_DETACHED);
+	/* A helper thread doesn't need much stack */
+	pthread_attr_setstacksize(&attr, 64 * 1024);
+
+	/* The new thread inherits the signal mask of the calling one */
+	sigfillset(&set);
+	pthread_sigmask(SIG_SETMASK, &set, &oldset);
+
+	if ((rc = pthread_create(&tid, &attr, fs_statvfs_thread, arg)) == 0) {
+		job->refcnt++;
+	}
+	else {
+		free(arg);
+	}
+	pthread_sigmask(SIG_SETMASK, &oldset, NULL);
+	pthread_attr_destroy(&attr);
+
+	return rc ? -1 : 0;
+}
+
+/*
+ ***************************************************************************
+ * Get the entry describing the state of a filesystem for statvfs() helper
+ * threads, creating it if necessary. Must be called with fs_statvfs_mutex
+ * held.
+ *
+ * IN:
+ * @mountp	Mount point of the filesystem.
+ *
+ * RETURNS:
+ * Pointer on the filesystem entry.
+ ***************************************************************************
+ */
+struct fs_statvfs_ent *get_fs_statvfs_ent(char *mountp)
+{
+	struct fs_statvfs_ent *fe, **bucket;
+	unsigned int hash = 2166136261U;
+	char *c;
+
+	/* FNV-1a hash */
+	for (c = mountp; *c; c++) {
+		hash = (hash ^ (unsigned char) *c) * 16777619U;
+	}
+	bucket = &fs_statvfs_cache[hash % FS_STATVFS_CACHE_SIZE];
+
+	for (fe = *bucket; fe != NULL; fe = fe->hnext) {
+		if (!strcmp(fe->mountp, mountp))
+			return fe;
+	}
+
+	if ((fe = (struct fs_statvfs_ent *) calloc(1, sizeof(struct fs_statvfs_ent))) == NULL) {
+		perror("malloc");
+		exit(4);
+	}
+	strncpy(fe->mountp, mountp, sizeof(fe->mountp));
+	fe->mountp[sizeof(fe->mountp) - 1] = '\0';
+	fe->hnext = *bucket;
+	*bucket = fe;
+
+	return fe;
+}
+
+/*
+ ***************************************************************************
+ * Remove the filesystems which have not been seen in current sample from
+ * statvfs() helper threads hash table. Must be called with fs_statvfs_mutex
+ * held.
+ *
+ * IN:
+ * @gen		Current sample number.
+ ***************************************************************************
+ */
+void purge_fs_statvfs_cache(unsigned int gen)
+{
+	struct fs_statvfs_ent *fe, **pfe;
+	int h;
+
+	for (h = 0; h < FS_STATVFS_CACHE_SIZE; h++) {
+		for (pfe = &fs_statvfs_cache[h]; (fe = *pfe) != NULL; ) {
+			if ((fe->gen != gen) && !fe->busy) {
+				*pfe = fe->hnext;
+				free(fe);
 			}
-			if (fs >= 0)
-				/* Duplicate entry found! Ignore current entry */
-				continue;
+			else {
+				pfe = &fe->hnext;
+			}
+		}
+	}
+}
+#endif
 
-			if (fs_read + 1 > nr_alloc) {
-				fs_read = -1;
-				break;
+/*
+ ***************************************************************************
+ * Get the sizes of a list of filesystems.
+ * statvfs() is called by a helper thread, and all the filesystems are given
+ * FS_STATVFS_TIMEOUT milliseconds to answer. When this deadline has passed
+ * (e.g. because of a hung NFS or FUSE mount), the filesystems not read yet
+ * get their last known statistics and are flagged as stale, so that callers
+ * can tell them from current ones. The filesystem which was blocking is then
+ * not retried for a number of samples that doubles each time it times out
+ * (up to FS_STATVFS_MAX_BACKOFF), and never while the previous call is still
+ * blocked. The other ones are read again at next sample.
+ * In TEST mode, statvfs() is called directly.
+ *
+ * IN:
+ * @mnt		List of filesystems.
+ * @nr		Number of filesystems in list.
+ *
+ * OUT:
+ * @mnt		List of filesystems with their statistics.
+ ***************************************************************************
+ */
+void statvfs_mounts(struct fs_mount *mnt, int nr)
+{
+	int i;
+#ifndef TEST
+	static unsigned int gen = 0;
+	static int init = FALSE;
+	struct fs_statvfs_job *job;
+	struct fs_statvfs_item *item;
+	struct fs_statvfs_ent *fe;
+	struct timespec deadline;
+	pthread_condattr_t cattr;
+	int j, expired = FALSE, use_thread = TRUE;
+
+	if (!init) {
+		/* Deadlines are computed using a monotonic clock */
+		pthread_condattr_init(&cattr);
+		pthread_condattr_setclock(&cattr, CLOCK_MONOTONIC);
+		pthread_cond_init(&fs_statvfs_cond, &cattr);
+		pthread_condattr_destroy(&cattr);
+		init = TRUE;
+	}
+
+	if ((job = (struct fs_statvfs_job *) calloc(1, sizeof(struct fs_statvfs_job))) == NULL) {
+		perror("malloc");
+		exit(4);
+	}
+	if (nr && ((job->item = (struct fs_statvfs_item *)
+		    calloc(nr, sizeof(struct fs_statvfs_item))) == NULL)) {
+		perror("malloc");
+		exit(4);
+	}
+	job->refcnt = 1;
+
+	pthread_mutex_lock(&fs_statvfs_mutex);
+	gen++;
+
+	for (i = 0; i < nr; i++) {
+		mnt[i].stale = FALSE;
+		fe = get_fs_statvfs_ent(mnt[i].mountp);
+		fe->gen = gen;
+
+		if (fe->busy || fe->skip) {
+			/* Filesystem not retried yet: Use last known statistics */
+			if (fe->skip) {
+				fe->skip--;
+			}
+			mnt[i].usage = fe->usage;
+			mnt[i].rc = fe->valid ? 0 : -1;
+			mnt[i].stale = TRUE;
+			continue;
+		}
+		job->item[job->nr].mnt = i;
+		job->item[job->nr++].ent = fe;
+	}
+
+	/* One deadline for the whole sample, so that timeouts never add up */
+	clock_gettime(CLOCK_MONOTONIC, &deadline);
+	deadline.tv_sec += FS_STATVFS_TIMEOUT / 1000;
+	deadline.tv_nsec += (FS_STATVFS_TIMEOUT % 1000) * 1000000L;
+	if (deadline.tv_nsec >= 1000000000L) {
+		deadline.tv_sec++;
+		deadline.tv_nsec -= 1000000000L;
+	}
+
+	if (job->nr && (start_fs_statvfs_thread(job) < 0)) {
+		use_thread = FALSE;
+	}
+
+	for (j = 0; (j < job->nr) && use_thread; j++) {
+		item = job->item + j;
+
+		while (!expired &&
+		       ((item->state == FS_ITEM_PENDING) || (item->state == FS_ITEM_RUNNING))) {
+			if (pthread_cond_timedwait(&fs_statvfs_cond, &fs_statvfs_mutex,
+						   &deadline) == ETIMEDOUT) {
+				/* Deadline passed: Helper thread must stop after current filesystem */
+				expired = TRUE;
+				job->owner++;
 			}
+		}
+
+		if (item->state == FS_ITEM_RUNNING) {
+			/* Filesystem is blocked: Leave it to the helper thread */
+			item->state = FS_ITEM_ABANDONED;
+			item->ent->busy++;
+			item->ent->backoff = item->ent->backoff ?
+					     MINIMUM(item->ent->backoff * 2, FS_STATVFS_MAX_BACKOFF) : 1;
+			item->ent->skip = item->ent->backoff;
+#ifdef DEBUG
+			fprintf(stderr, "%s: statvfs(%s) timed out: Retry in %u samples\n",
+				__FUNCTION__, item->ent->mountp, item->ent->skip);
+#endif
+		}
 
-			st_filesystem_i = st_filesystem + fs_read++;
-			st_filesystem_i->f_blocks = (unsigned long long) buf.f_blocks * (unsigned long long) buf.f_frsize;
-			st_filesystem_i->f_bfree  = (unsigned long long) buf.f_bfree * (unsigned long long) buf.f_frsize;
-			st_filesystem_i->f_bavail = (unsigned long long) buf.f_bavail * (unsigned long long) buf.f_frsize;
-			st_filesystem_i->f_files  = (unsigned long long) buf.f_files;
-			st_filesystem_i->f_ffree  = (unsigned long long) buf.f_ffree;
-			strncpy(st_filesystem_i->fs_name, fs_name, sizeof(st_filesystem_i->fs_name));
-			st_filesystem_i->fs_name[sizeof(st_filesystem_i->fs_name) - 1] = '\0';
-			strncpy(st_filesystem_i->mountp, mountp, sizeof(st_filesystem_i->mountp));
-			st_filesystem_i->mountp[sizeof(st_filesystem_i->mountp) - 1] = '\0';
+		i = item->mnt;
+		if ((item->state == FS_ITEM_ABANDONED) || (item->state == FS_ITEM_PENDING)) {
+			/* Filesystem not read in time: Use last known statistics */
+			mnt[i].usage = item->ent->usage;
+			mnt[i].rc = item->ent->valid ? 0 : -1;
+			mnt[i].stale = TRUE;
+		}
+		else {
+			mnt[i].usage = item->usage;
+			mnt[i].rc = item->rc;
+			/* Save statistics in case filesystem blocks next time */
+			item->ent->usage = item->usage;
+			item->ent->valid = !item->rc;
+			item->ent->backoff = 0;
 		}
 	}
 
-	fclose(fp);
+	if (!use_thread) {
+		/*
+		 * Helper thread couldn't be created: Get remaining statistics directly.
+		 * Make sure no helper thread will process them.
+		 */
+		job->owner++;
+		for (j = job->next; j < job->nr; j++) {
+			i = job->item[j].mnt;
+			mnt[i].rc = get_fs_usage(mnt[i].mountp, &mnt[i].usage);
+		}
+	}
+
+	purge_fs_statvfs_cache(gen);
+	put_fs_statvfs_job(job);
+
+	pthread_mutex_unlock(&fs_statvfs_mutex);
+#else
+	for (i = 0; i < nr; i++) {
+		mnt[i].rc = get_fs_usage(mnt[i].mountp, &mnt[i].usage);
+	}
+#endif
+}
+
+/*
+ ***************************************************************************
+ * Read filesystems statistics.
+ * Filesystems whose statistics couldn't be read in time (see
+ * statvfs_mounts()) are not saved, so that their last known statistics
+ * are never reported as current ones.
+ *
+ * IN:
+ * @st_filesystem	Structure where stats will be saved.
+ * @nr_alloc		Total number of structures allocated. Value is >= 0.
+ * @fs_filter		Filesystems to collect (NULL or empty to collect all
+ *			of them).
+ *
+ * OUT:
+ * @st_filesystem	Structure with statistics.
+ *
+ * RETURNS:
+ * Number of filesystems read, or -1 if the buffer was too small and
+ * needs to be reallocated.
+ ***************************************************************************
+ */
+__nr_t read_filesystem(struct stats_filesystem *st_filesystem, __nr_t nr_alloc,
+		       struct glob_filter *fs_filter)
+{
+	static struct fs_mount *mnt = NULL;
+	static int nr = 0, retry = FALSE;
+	int fs, i;
+	__nr_t fs_read = 0;
+	struct stats_filesystem *st_filesystem_i;
+
+	/*
+	 * If we are called again because the buffer was too small,
+	 * don't call statvfs() a second time for each filesystem.
+	 */
+	if (!retry) {
+		nr = read_mount_list(&mnt, fs_filter);
+
+		/* Get filesystems sizes without blocking on unresponsive ones */
+		statvfs_mounts(mnt, nr);
+	}
+	retry = FALSE;
+
+	for (i = 0; i < nr; i++) {
+
+		if ((mnt[i].rc < 0) || mnt[i].stale || !mnt[i].usage.f_blocks)
+			continue;
+
+		/* Check if it's a duplicate entry */
+		fs = fs_read - 1;
+		while (fs >= 0) {
+			st_filesystem_i = st_filesystem + fs;
+			if (!strcmp(st_filesystem_i->fs_name, mnt[i].fs_name))
+				break;
+			fs--;
+		}
+		if (fs >= 0)
+			/* Duplicate entry found! Ignore current entry */
+			continue;
+
+		if (fs_read + 1 > nr_alloc) {
+			retry = TRUE;
+			return -1;
+		}
+
+		st_filesystem_i = st_filesystem + fs_read++;
+		st_filesystem_i->f_blocks = mnt[i].usage.f_blocks;
+		st_filesystem_i->f_bfree  = mnt[i].usage.f_bfree;
+		st_filesystem_i->f_bavail = mnt[i].usage.f_bavail;
+		st_filesystem_i->f_files  = mnt[i].usage.f_files;
+		st_filesystem_i->f_ffree  = mnt[i].usage.f_ffree;
+		strncpy(st_filesystem_i->fs_name, mnt[i].fs_name, sizeof(st_filesystem_i->fs_name));
+		st_filesystem_i->fs_name[sizeof(st_filesystem_i->fs_name) - 1] = '\0';
+		strncpy(st_filesystem_i->mountp, mnt[i].mountp, sizeof(st_filesystem_i->mountp));
+		st_filesystem_i->mountp[sizeof(st_filesystem_i->mountp) - 1] = '\0';
+	}
+
 	return fs_read;
 }
 
@@ -70,6 +70,7 @@
 #define NET_SNMP6		PRE "/proc/net/snmp6"
 #define CPUINFO			PRE "/proc/cpuinfo"
 #define MTAB			PRE "/etc/mtab"
+#define SELF_MOUNTS		PRE "/proc/self/mounts"
 #define IF_DUPLEX		PRE "/sys/class/net/%s/duplex"
 #define IF_SPEED		PRE "/sys/class/net/%s/speed"
 #define FC_RX_FRAMES		"%s/%s/statistics/rx_frames"
@@ -78,6 +79,9 @@
 #define FC_TX_WORDS		"%s/%s/statistics/tx_words"
 #define SYSFS_USBDEV		PRE "/sys/bus/usb/devices"
 #define SYSFS_TIME_IN_STATE	"cpufreq/stats/time_in_state"
+#define SYSFS_CUR_FREQ		"cpufreq/scaling_cur_freq"
+/* Max number of per-CPU sysfs files of a given type kept open */
+#define CPU_FD_MAX		256
 #define SYSFS_IDVENDOR		"idVendor"
 #define SYSFS_IDPRODUCT		"idProduct"
 #define SYSFS_BMAXPOWER		"bMaxPower"
@@ -128,6 +132,25 @@ struct stats_cpu {
 #define STATS_CPU_ULL	10
 #define STATS_CPU_UL	0
 #define STATS_CPU_U	0
+
+/*
+ * Position of CPU utilization percentages in a row computed by
+ * get_cpu_pct_table().
+ */
+#define CPU_PCT_USR	0	/* %usr (guest time excluded) */
+#define CPU_PCT_NICE	1	/* %nice (guest nice time excluded) */
+#define CPU_PCT_SYS	2
+#define CPU_PCT_IOWAIT	3
+#define CPU_PCT_IRQ	4
+#define CPU_PCT_SOFT	5
+#define CPU_PCT_STEAL	6
+#define CPU_PCT_GUEST	7
+#define CPU_PCT_GNICE	8
+#define CPU_PCT_IDLE	9
+#define CPU_PCT_USER	10	/* %user (guest time included) */
+#define CPU_PCT_NICE_G	11	/* %nice (guest nice time included) */
+#define CPU_PCT_SYSTEM	12	/* %system (irq and softirq time included) */
+#define CPU_PCT_NR	13
 #define STATS_CPU_XNR	10
 
 /*
@@ -338,8 +361,61 @@ struct stats_net_dev {
 #define STATS_NET_DEV_ULL	7
 #define STATS_NET_DEV_UL	0
 #define STATS_NET_DEV_U		1
+
 #define STATS_NET_DEV_XNR	8
 
+/* Number of buckets in the network interfaces speed and duplex cache */
+#define IF_INFO_CACHE_SIZE	256
+
+/* Speed and duplex of a network interface, as read from sysfs by sadc */
+struct if_info_ent {
+	struct if_info_ent *hnext;
+	unsigned int speed;
+	char interface[MAX_IFACE_LEN];
+	char duplex;
+};
+
+/*
+ * Lists of glob patterns used by sadc to select the items (interfaces,
+ * devices or filesystems) to collect.
+ */
+struct glob_filter {
+	char **include;
+	char **exclude;
+	int include_nr;
+	int exclude_nr;
+};
+
+#define FILTER_SET(f)	((f)->include_nr || (f)->exclude_nr)
+
+/* Network interface counters, as read from rtnetlink by sadc */
+struct if_link_stats {
+	unsigned long long rx_bytes;
+	unsigned long long rx_packets;
+	unsigned long long rx_errors;
+	unsigned long long rx_dropped;
+	unsigned long long rx_fifo_errors;
+	unsigned long long rx_frame_errors;
+	unsigned long long rx_compressed;
+	unsigned long long multicast;
+	unsigned long long tx_bytes;
+	unsigned long long tx_packets;
+	unsigned long long tx_errors;
+	unsigned long long tx_dropped;
+	unsigned long long tx_fifo_errors;
+	unsigned long long collisions;
+	unsigned long long tx_carrier_errors;
+	unsigned long long tx_compressed;
+	char interface[MAX_IFACE_LEN];
+};
+
+/* Size of the buffer used to receive rtnetlink replies */
+#define RTNL_BUF_SIZE	32768
+
+/* Activities using interface counters read from rtnetlink */
+#define RTNL_NET_DEV	0x01
+#define RTNL_NET_EDEV	0x02
+
 /* Structure for network interface errors statistics */
 struct stats_net_edev {
 	unsigned long long collisions;
@@ -737,6 +813,126 @@ struct stats_filesystem {
 #define STATS_FILESYSTEM_U		0
 #define STATS_FILESYSTEM_XNR		7
 
+/* Time budget (in milliseconds) given to statvfs() for all the filesystems of a sample */
+#define FS_STATVFS_TIMEOUT	1000
+/* Max number of samples during which a filesystem that timed out is not retried */
+#define FS_STATVFS_MAX_BACKOFF	64
+/* Number of buckets in the statvfs() filesystems hash table */
+#define FS_STATVFS_CACHE_SIZE	256
+
+/* Filesystem sizes (in bytes) and number of inodes, as given by statvfs() */
+struct fs_usage {
+	unsigned long long f_blocks;
+	unsigned long long f_bfree;
+	unsigned long long f_bavail;
+	unsigned long long f_files;
+	unsigned long long f_ffree;
+};
+
+/*
+ * listmount() and statmount() system calls (Linux 6.8 and later, mount
+ * source available since Linux 6.13). Same as in <linux/mount.h>, which
+ * may be too old to define them.
+ */
+#define LSMT_ROOT		0xffffffffffffffffULL
+#define MNT_ID_REQ_SIZE_VER0	24
+#define STATMOUNT_MNT_POINT	0x00000010U
+#define STATMOUNT_FS_TYPE	0x00000020U
+#define STATMOUNT_SB_SOURCE	0x00000200U
+/* Number of mount IDs requested from listmount() at once */
+#define LISTMOUNT_BATCH		512
+/* Size of the buffer receiving statmount() results */
+#define STATMOUNT_BUF_SIZE	8192
+
+struct sa_mnt_id_req {
+	unsigned int size;
+	unsigned int spare;
+	unsigned long long mnt_id;
+	unsigned long long param;
+};
+
+struct sa_statmount {
+	unsigned int size;
+	unsigned int mnt_opts;
+	unsigned long long mask;
+	unsigned int sb_dev_major;
+	unsigned int sb_dev_minor;
+	unsigned long long sb_magic;
+	unsigned int sb_flags;
+	unsigned int fs_type;		/* Offset of the strings in @str */
+	unsigned long long mnt_id;
+	unsigned long long mnt_parent_id;
+	unsigned int mnt_id_old;
+	unsigned int mnt_parent_id_old;
+	unsigned long long mnt_attr;
+	unsigned long long mnt_propagation;
+	unsigned long long mnt_peer_group;
+	unsigned long long mnt_master;
+	unsigned long long propagate_from;
+	unsigned int mnt_root;
+	unsigned int mnt_point;
+	unsigned long long mnt_ns_id;
+	unsigned int fs_subtype;
+	unsigned int sb_source;
+	unsigned long long __spare[48];
+	char str[];
+};
+
+/* Filesystem read from the mount table by sadc */
+struct fs_mount {
+	struct fs_usage usage;
+	char fs_name[MAX_FS_LEN];
+	char mountp[256];
+	/* 0 if @usage contains statistics, -1 otherwise */
+	int rc;
+	/*
+	 * TRUE if @usage contains last known statistics (statvfs() didn't
+	 * answer in time). Such statistics are not saved by read_filesystem().
+	 */
+	int stale;
+};
+
+/*
+ * State of a filesystem whose statistics are read by a statvfs() helper
+ * thread. Entries are kept from one sample to the next.
+ */
+struct fs_statvfs_ent {
+	struct fs_statvfs_ent *hnext;
+	struct fs_usage usage;		/* Last known statistics */
+	char mountp[256];
+	unsigned int gen;		/* Last sample where the filesystem was seen */
+	unsigned int backoff;		/* Number of samples skipped after last timeout */
+	unsigned int skip;		/* Remaining number of samples to skip */
+	int valid;			/* TRUE if @usage contains statistics */
+	int busy;			/* Number of statvfs() calls still running */
+};
+
+/* A statvfs() call made by a helper thread */
+struct fs_statvfs_item {
+	struct fs_statvfs_ent *ent;
+	struct fs_usage usage;
+	int mnt;			/* Index in list of filesystems */
+	int rc;
+	int state;			/* FS_ITEM_PENDING, FS_ITEM_RUNNING, etc. */
+};
+
+#define FS_ITEM_PENDING		0
+#define FS_ITEM_RUNNING		1
+#define FS_ITEM_DONE		2
+#define FS_ITEM_ABANDONED	3
+
+/* statvfs() calls made by helper threads for one sample */
+struct fs_statvfs_job {
+	struct fs_statvfs_item *item;
+	int nr;
+	/* Next item to process */
+	int next;
+	/* Identifier of the helper thread in charge of the job */
+	unsigned int owner;
+	/* Number of threads (including main one) using the job */
+	int refcnt;
+};
+
 /* Structure for Fibre Channel HBA statistics */
 struct stats_fchost {
 	unsigned long f_rxframes		__attribute__ ((aligned (8)));
@@ -840,6 +1036,9 @@ struct stats_pwr_bat {
 void compute_ext_disk_stats
 	(struct stats_disk *, struct stats_disk *, unsigned long long,
 	 struct ext_disk_stats *);
+void get_cpu_pct_table
+	(struct stats_cpu *, struct stats_cpu *, size_t, int, const unsigned char [],
+	 const unsigned char [], unsigned long long, unsigned long long [], double []);
 unsigned long long get_per_cpu_interval
 	(struct stats_cpu *, struct stats_cpu *);
 __nr_t read_stat_cpu
@@ -853,6 +1052,10 @@ void read_uptime
 #ifdef SOURCE_SADC
 void oct2chr
 	(char *);
+int read_mount_list
+	(struct fs_mount **, struct glob_filter *);
+void statvfs_mounts
+	(struct fs_mount *, int);
 __nr_t read_stat_pcsw
 	(struct stats_pcsw *);
 __nr_t read_loadavg
@@ -864,7 +1067,9 @@ __nr_t read_vmstat_paging
 __nr_t read_diskstats_io
 	(struct stats_io *);
 __nr_t read_diskstats_disk
-	(struct stats_disk *, __nr_t, int);
+	(struct stats_disk *, __nr_t, int, struct glob_filter *);
+int pass_glob_filter
+	(struct glob_filter *, const char *, const char *);
 __nr_t read_tty_driver_serial
 	(struct stats_serial *, __nr_t);
 __nr_t read_kernel_tables
@@ -873,8 +1078,24 @@ __nr_t read_net_dev
 	(struct stats_net_dev *, __nr_t);
 void read_if_info
 	(struct stats_net_dev *, int);
+void read_if_speed_duplex
+	(struct stats_net_dev *);
+unsigned int hash_if_name
+	(const char *);
+void drop_if_info
+	(const char *);
+int open_link_notifications
+	(void);
+void check_link_notifications
+	(int);
 __nr_t read_net_edev
 	(struct stats_net_edev *, __nr_t);
+__nr_t read_rtnl_link_stats
+	(unsigned int, char **, int);
+__nr_t read_net_dev_rtnl
+	(struct stats_net_dev *, __nr_t, char **, int);
+__nr_t read_net_edev_rtnl
+	(struct stats_net_edev *, __nr_t, char **, int);
 __nr_t read_net_nfs
 	(struct stats_net_nfs *);
 __nr_t read_net_nfsd
@@ -909,6 +1130,8 @@ __nr_t read_net_udp6
 	(struct stats_net_udp6 *);
 __nr_t read_cpuinfo
 	(struct stats_pwr_cpufreq *, __nr_t);
+__nr_t read_cpu_cur_freq
+	(struct stats_pwr_cpufreq *, __nr_t, int);
 __nr_t read_meminfo_huge
 	(struct stats_huge *);
 __nr_t read_cpu_wghfreq
@@ -916,7 +1139,7 @@ __nr_t read_cpu_wghfreq
 __nr_t read_bus_usb_dev
 	(struct stats_pwr_usb *, __nr_t);
 __nr_t read_filesystem
-	(struct stats_filesystem *, __nr_t);
+	(struct stats_filesystem *, __nr_t, struct glob_filter *);
 __nr_t read_fchost
 	(struct stats_fchost *, __nr_t);
 int read_softnet
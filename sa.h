@@ -120,6 +120,7 @@ enum {
 #define S_F_OPTION_P		0x20000000
 #define S_F_OPTION_I		0x40000000
 #define S_F_DEBUG_MODE		0x80000000
+#define S_F_TASK_FILE		0x100000000ULL	/* Only used by sadf */
 
 #define WANT_SINCE_BOOT(m)		(((m) & S_F_SINCE_BOOT)   == S_F_SINCE_BOOT)
 #define WANT_SA_ROTAT(m)		(((m) & S_F_SA_ROTAT)     == S_F_SA_ROTAT)
@@ -154,6 +155,7 @@ enum {
 #define USE_OPTION_P(m)			(((m) & S_F_OPTION_P)     == S_F_OPTION_P)
 #define USE_OPTION_I(m)			(((m) & S_F_OPTION_I)     == S_F_OPTION_I)
 #define DISPLAY_MINMAX(m)		(((m) & S_F_MINMAX)       == S_F_MINMAX)
+#define ACCEPT_TASK_FILE(m)		(((m) & S_F_TASK_FILE)    == S_F_TASK_FILE)
 
 #define AO_F_NULL		0x00000000
 
@@ -1604,8 +1606,6 @@ void free_bitmaps
 	(struct activity * []);
 void free_structures
 	(struct activity * []);
-char *get_devname
-	(unsigned int, unsigned int);
 char *get_sa_devname
 	(unsigned int, unsigned int, unsigned long long [], unsigned int, uint64_t);
 void get_file_timestamp_struct
@@ -1665,6 +1665,9 @@ int read_record_hdr
 	 int, size_t, uint64_t, struct report_format *);
 void reallocate_buffers
 	(struct activity *, __nr_t, uint64_t);
+int remap_struct
+	(const unsigned int [], const unsigned int [], void *, unsigned int,
+	 unsigned int, size_t);
 void reallocate_minmax_buf
 	(struct activity *, __nr_t, uint64_t);
 void replace_nonprintable_char
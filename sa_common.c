@@ -37,6 +37,7 @@
 
 #include "version.h"
 #include "sa.h"
+#include "sa_task.h"
 #include "ioconf.h"
 
 #ifdef USE_NLS
@@ -2112,7 +2113,7 @@ void check_file_actlst(int *ifd, char *dfile, struct activity *act[], uint64_t f
 		       struct file_activity **file_actlst, unsigned int id_seq[],
 		       int *endian_mismatch, int *arch_64)
 {
-	int i, j, k, p, skip;
+	int i, j, k, p, skip, task_file = FALSE;
 	struct file_activity *fal;
 	void *buffer = NULL;
 	size_t bh_size = FILE_HEADER_SIZE;
@@ -2244,6 +2245,11 @@ void check_file_actlst(int *ifd, char *dfile, struct activity *act[], uint64_t f
 			goto format_error;
 		}
 
+		if (fal->id == A_TASK) {
+			/* File created by pidstat -o */
+			task_file = TRUE;
+		}
+
 		if ((p = get_activity_position(act, fal->id, RESUME_IF_NOT_FOUND)) < 0)
 			/* Unknown activity */
 			continue;
@@ -2346,9 +2352,11 @@ void check_file_actlst(int *ifd, char *dfile, struct activity *act[], uint64_t f
 	/*
 	 * None of selected activities exist in file: Abort.
 	 * NB: Error is ignored if we only want to display
-	 * datafile header (sadf -H).
+	 * datafile header (sadf -H), or if this is a file with per-task
+	 * statistics that sadf can display.
 	 */
-	if (!get_activity_nr(act, AO_SELECTED, COUNT_ACTIVITIES) && !DISPLAY_HDR_ONLY(flags)) {
+	if (!get_activity_nr(act, AO_SELECTED, COUNT_ACTIVITIES) && !DISPLAY_HDR_ONLY(flags) &&
+	    !(task_file && ACCEPT_TASK_FILE(flags))) {
 		fprintf(stderr, _("Requested activities not available in file %s\n"),
 			dfile);
 		close(*ifd);
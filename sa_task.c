@@ -0,0 +1,245 @@
+/*
+ * sa_task.c: Save per-task statistics to a file (pidstat -o)
+ * (C) 2007-2024 by Sebastien GODARD (sysstat <at> orange.fr)
+ *
+ ***************************************************************************
+ * This program is free software; you can redistribute it and/or modify it *
+ * under the terms of the GNU General Public License as published  by  the *
+ * Free Software Foundation; either version 2 of the License, or (at  your *
+ * option) any later version.                                              *
+ *                                                                         *
+ * This program is distributed in the hope that it  will  be  useful,  but *
+ * WITHOUT ANY WARRANTY; without the implied warranty  of  MERCHANTABILITY *
+ * or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License *
+ * for more details.                                                       *
+ *                                                                         *
+ * You should have received a copy of the GNU General Public License along *
+ * with this program; if not, write to the Free Software Foundation, Inc., *
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1335 USA              *
+ ***************************************************************************
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <time.h>
+#include <errno.h>
+#include <sys/stat.h>
+#include <sys/utsname.h>
+
+#include "version.h"
+#include "sa.h"
+#include "sa_task.h"
+
+#ifdef USE_NLS
+#include <locale.h>
+#include <libintl.h>
+#define _(string) gettext(string)
+#else
+#define _(string) (string)
+#endif
+
+/*
+ ***************************************************************************
+ * Write data to file. Restart if interrupted by a signal.
+ *
+ * IN:
+ * @fd		Output file descriptor.
+ * @buf		Data to write.
+ * @nr_bytes	Number of bytes to write.
+ *
+ * RETURNS:
+ * 0 on success, -1 otherwise.
+ ***************************************************************************
+ */
+static int task_write_all(int fd, const void *buf, size_t nr_bytes)
+{
+	ssize_t block;
+	const char *buffer = (const char *) buf;
+
+	while (nr_bytes > 0) {
+
+		block = write(fd, buffer, nr_bytes);
+
+		if (block < 0) {
+			if (errno == EINTR)
+				continue;
+			return -1;
+		}
+		if (block == 0)
+			return -1;
+
+		buffer += block;
+		nr_bytes -= block;
+	}
+
+	return 0;
+}
+
+/*
+ ***************************************************************************
+ * Create a file to save per-task statistics and write its headers.
+ * The file has the same format as a system activity data file, with two
+ * activities: A_TASK_SYS (system-wide values) and A_TASK (one structure
+ * per task).
+ *
+ * IN:
+ * @ofile	Name of output file.
+ * @cpu_nr	Number of CPU in the machine.
+ *
+ * RETURNS:
+ * File descriptor of the output file.
+ ***************************************************************************
+ */
+int create_task_file(char *ofile, unsigned int cpu_nr)
+{
+	int fd;
+	char *v, version[16];
+	struct tm rectime;
+	struct utsname header;
+	struct file_magic file_magic;
+	struct file_header file_hdr;
+	struct file_activity file_act[2];
+
+	if ((fd = open(ofile, O_WRONLY | O_CREAT | O_TRUNC,
+		       S_IRUSR | S_IWUSR | S_IRGRP | S_IROTH)) < 0) {
+		fprintf(stderr, _("Cannot open %s: %s\n"), ofile, strerror(errno));
+		exit(2);
+	}
+
+	/* Fill file magic header */
+	memset(&file_magic, 0, FILE_MAGIC_SIZE);
+	file_magic.sysstat_magic = SYSSTAT_MAGIC;
+	file_magic.format_magic  = FORMAT_MAGIC;
+
+	strncpy(version, VERSION, sizeof(version));
+	version[sizeof(version) - 1] = '\0';
+	if ((v = strtok(version, ".")) != NULL) {
+		file_magic.sysstat_version = atoi(v) & 0xff;
+		if ((v = strtok(NULL, ".")) != NULL) {
+			file_magic.sysstat_patchlevel = atoi(v) & 0xff;
+			if ((v = strtok(NULL, ".")) != NULL) {
+				file_magic.sysstat_sublevel = atoi(v) & 0xff;
+			}
+		}
+	}
+
+	file_magic.header_size = FILE_HEADER_SIZE;
+	file_magic.hdr_types_nr[0] = FILE_HEADER_ULL_NR;
+	file_magic.hdr_types_nr[1] = FILE_HEADER_UL_NR;
+	file_magic.hdr_types_nr[2] = FILE_HEADER_U_NR;
+
+	/* Fill file header */
+	memset(&file_hdr, 0, FILE_HEADER_SIZE);
+	file_hdr.sa_ust_time    = (unsigned long long) get_time(&rectime, 0);
+	file_hdr.sa_act_nr      = 2;
+	file_hdr.sa_day         = rectime.tm_mday;
+	file_hdr.sa_month       = rectime.tm_mon;
+	file_hdr.sa_year        = rectime.tm_year;
+	file_hdr.sa_sizeof_long = sizeof(long);
+	file_hdr.sa_hz          = HZ;
+	file_hdr.sa_cpu_nr      = cpu_nr + 1;
+
+	file_hdr.act_types_nr[0] = FILE_ACTIVITY_ULL_NR;
+	file_hdr.act_types_nr[1] = FILE_ACTIVITY_UL_NR;
+	file_hdr.act_types_nr[2] = FILE_ACTIVITY_U_NR;
+	file_hdr.rec_types_nr[0] = RECORD_HEADER_ULL_NR;
+	file_hdr.rec_types_nr[1] = RECORD_HEADER_UL_NR;
+	file_hdr.rec_types_nr[2] = RECORD_HEADER_U_NR;
+	file_hdr.act_size = FILE_ACTIVITY_SIZE;
+	file_hdr.rec_size = RECORD_HEADER_SIZE;
+
+	__uname(&header);
+	strncpy(file_hdr.sa_sysname, header.sysname, sizeof(file_hdr.sa_sysname));
+	file_hdr.sa_sysname[sizeof(file_hdr.sa_sysname) - 1]  = '\0';
+	strncpy(file_hdr.sa_nodename, header.nodename, sizeof(file_hdr.sa_nodename));
+	file_hdr.sa_nodename[sizeof(file_hdr.sa_nodename) - 1] = '\0';
+	strncpy(file_hdr.sa_release, header.release, sizeof(file_hdr.sa_release));
+	file_hdr.sa_release[sizeof(file_hdr.sa_release) - 1]  = '\0';
+	strncpy(file_hdr.sa_machine, header.machine, sizeof(file_hdr.sa_machine));
+	file_hdr.sa_machine[sizeof(file_hdr.sa_machine) - 1]  = '\0';
+
+	tzset();
+	strncpy(file_hdr.sa_tzname, tzname[0], TZNAME_LEN);
+	file_hdr.sa_tzname[TZNAME_LEN - 1] = '\0';
+
+	/* Fill activity list */
+	memset(file_act, 0, sizeof(file_act));
+
+	file_act[0].id    = A_TASK_SYS;
+	file_act[0].magic = A_TASK_SYS_MAGIC;
+	file_act[0].nr    = 1;
+	file_act[0].nr2   = 1;
+	file_act[0].size  = TASK_SYS_STATS_SIZE;
+	file_act[0].types_nr[0] = TASK_SYS_STATS_ULL_NR;
+	file_act[0].types_nr[1] = TASK_SYS_STATS_UL_NR;
+	file_act[0].types_nr[2] = TASK_SYS_STATS_U_NR;
+
+	/* Number of tasks varies: It is saved before the statistics structures */
+	file_act[1].id     = A_TASK;
+	file_act[1].magic  = A_TASK_MAGIC;
+	file_act[1].nr     = 1;
+	file_act[1].nr2    = 1;
+	file_act[1].has_nr = TRUE;
+	file_act[1].size   = TASK_STATS_SIZE;
+	file_act[1].types_nr[0] = TASK_STATS_ULL_NR;
+	file_act[1].types_nr[1] = TASK_STATS_UL_NR;
+	file_act[1].types_nr[2] = TASK_STATS_U_NR;
+
+	if ((task_write_all(fd, &file_magic, FILE_MAGIC_SIZE) < 0) ||
+	    (task_write_all(fd, &file_hdr, FILE_HEADER_SIZE) < 0) ||
+	    (task_write_all(fd, file_act, sizeof(file_act)) < 0)) {
+		fprintf(stderr, _("Cannot write data to system activity file: %s\n"),
+			strerror(errno));
+		exit(2);
+	}
+
+	return fd;
+}
+
+/*
+ ***************************************************************************
+ * Save a sample of per-task statistics to file.
+ *
+ * IN:
+ * @fd		Output file descriptor.
+ * @uptime_cs	Machine uptime in 1/100th of a second.
+ * @tss		System-wide values for current sample.
+ * @ts		Array of structures with per-task statistics.
+ * @nr		Number of structures in array.
+ *
+ * RETURNS:
+ * 0 on success, -1 otherwise.
+ ***************************************************************************
+ */
+int write_task_record(int fd, unsigned long long uptime_cs, struct task_sys_stats *tss,
+		      struct task_stats *ts, int nr)
+{
+	struct tm rectime;
+	struct record_header record_hdr;
+	/* Record header, A_TASK_SYS structure and number of A_TASK structures */
+	char buf[RECORD_HEADER_SIZE + TASK_SYS_STATS_SIZE + sizeof(__nr_t)];
+	__nr_t nr_value = nr;
+
+	memset(&record_hdr, 0, RECORD_HEADER_SIZE);
+	record_hdr.record_type = R_STATS;
+	record_hdr.uptime_cs   = uptime_cs;
+	record_hdr.ust_time    = (unsigned long long) get_time(&rectime, 0);
+	record_hdr.hour        = rectime.tm_hour;
+	record_hdr.minute      = rectime.tm_min;
+	record_hdr.second      = rectime.tm_sec;
+
+	memcpy(buf, &record_hdr, RECORD_HEADER_SIZE);
+	memcpy(buf + RECORD_HEADER_SIZE, tss, TASK_SYS_STATS_SIZE);
+	memcpy(buf + RECORD_HEADER_SIZE + TASK_SYS_STATS_SIZE, &nr_value, sizeof(__nr_t));
+
+	if (task_write_all(fd, buf, sizeof(buf)) < 0)
+		return -1;
+
+	if (nr && (task_write_all(fd, ts, (size_t) nr * TASK_STATS_SIZE) < 0))
+		return -1;
+
+	return 0;
+}
@@ -0,0 +1,124 @@
+/*
+ * sa_task.h: Include file used to save and read per-task statistics
+ * (pidstat -o and sadf).
+ * (C) 2007-2024 by Sebastien GODARD (sysstat <at> orange.fr)
+ */
+
+#ifndef _SA_TASK_H
+#define _SA_TASK_H
+
+/*
+ ***************************************************************************
+ * Per-task statistics are saved by pidstat in a file using the same
+ * framing as system activity data files: A file_magic structure, then a
+ * file_header structure followed by the list of activities (file_activity
+ * structures), then a record_header structure for each sample followed by
+ * the statistics for each activity.
+ * The two activities below are not part of the act[] array used by sadc,
+ * sar and sadf. sar rejects such files since none of the activities it
+ * knows is found in them. They are only displayed by sadf.
+ ***************************************************************************
+ */
+
+/* Identification values of activities used to save per-task statistics */
+#define A_TASK_SYS	0x100
+#define A_TASK		0x101
+
+/* Activities magical numbers */
+#define A_TASK_SYS_MAGIC	0x8a
+#define A_TASK_MAGIC		0x8a
+
+/*
+ * Activities collected by pidstat. These values are saved in file
+ * (see structure task_sys_stats below).
+ */
+#define P_A_CPU		0x01
+#define P_A_MEM		0x02
+#define P_A_IO		0x04
+#define P_A_CTXSW	0x08
+#define P_A_STACK	0x10
+#define P_A_KTAB	0x20
+#define P_A_RT		0x40
+
+/*
+ * Structure for system-wide values saved with each sample.
+ * Saved once per sample (activity A_TASK_SYS).
+ */
+struct task_sys_stats {
+	/* Total memory in kB */
+	unsigned long long tlmkb	__attribute__ ((aligned (8)));
+	/* Activities collected by pidstat (P_A_* flags) */
+	unsigned int act		__attribute__ ((aligned (8)));
+	/* Number of CPU in the machine */
+	unsigned int cpu_nr;
+};
+
+#define TASK_SYS_STATS_SIZE	(sizeof(struct task_sys_stats))
+#define TASK_SYS_STATS_ULL_NR	1
+#define TASK_SYS_STATS_UL_NR	0
+#define TASK_SYS_STATS_U_NR	2
+
+/* Size of command name saved in file */
+#define TASK_COMM_SIZE	32
+
+/* Values for @flags field in task_stats structure */
+#define TASK_F_NO_IO	0x01	/* /proc/#/io file couldn't be read */
+#define TASK_F_NO_FD	0x02	/* /proc/#/fd directory couldn't be read */
+#define TASK_F_STK_RES	0x04	/* Resident stack memory read instead of referenced one */
+
+/*
+ * Structure for per-task statistics (activity A_TASK).
+ * Values are raw counters read from /proc. Rates are computed when
+ * the file is read.
+ * The number of structures saved (number of tasks) precedes them in file.
+ */
+struct task_stats {
+	unsigned long long utime		__attribute__ ((aligned (8)));
+	unsigned long long stime		__attribute__ ((packed));
+	unsigned long long gtime		__attribute__ ((packed));
+	unsigned long long wtime		__attribute__ ((packed));
+	unsigned long long minflt		__attribute__ ((packed));
+	unsigned long long majflt		__attribute__ ((packed));
+	unsigned long long vsz			__attribute__ ((packed));
+	unsigned long long rss			__attribute__ ((packed));
+	unsigned long long stack_size		__attribute__ ((packed));
+	unsigned long long stack_ref		__attribute__ ((packed));
+	unsigned long long stack_res		__attribute__ ((packed));
+	unsigned long long read_bytes		__attribute__ ((packed));
+	unsigned long long write_bytes		__attribute__ ((packed));
+	unsigned long long cancelled_write_bytes __attribute__ ((packed));
+	unsigned long long blkio_swapin_delays	__attribute__ ((packed));
+	unsigned long long nvcsw		__attribute__ ((packed));
+	unsigned long long nivcsw		__attribute__ ((packed));
+	/* Time the task started after boot (used to detect PID reuse) */
+	unsigned long long starttime		__attribute__ ((packed));
+	unsigned int       pid			__attribute__ ((packed));
+	/* TGID of the thread group leader, or 0 if this task is a process */
+	unsigned int       tgid			__attribute__ ((packed));
+	unsigned int       uid			__attribute__ ((packed));
+	unsigned int       processor		__attribute__ ((packed));
+	unsigned int       priority		__attribute__ ((packed));
+	unsigned int       policy		__attribute__ ((packed));
+	unsigned int       threads		__attribute__ ((packed));
+	unsigned int       fd_nr		__attribute__ ((packed));
+	unsigned int       flags		__attribute__ ((packed));
+	char               comm[TASK_COMM_SIZE];
+};
+
+#define TASK_STATS_SIZE		(sizeof(struct task_stats))
+#define TASK_STATS_ULL_NR	18
+#define TASK_STATS_UL_NR	0
+#define TASK_STATS_U_NR		9
+
+/*
+ ***************************************************************************
+ * Functions prototypes.
+ ***************************************************************************
+ */
+
+int create_task_file
+	(char *, unsigned int);
+int write_task_record
+	(int, unsigned long long, struct task_sys_stats *, struct task_stats *, int);
+
+#endif  /* _SA_TASK_H */
@@ -21,11 +21,18 @@
 
 #include <dirent.h>
 #include <string.h>
+#include <stddef.h>
+#include <net/if.h>
 
 #include "sa.h"
 #include "count.h"
 
 extern unsigned int flags;
+extern int cpufreq_subset;
+extern int use_rtnl;
+extern char **rtnl_iface_list;
+extern int rtnl_iface_nr;
+extern struct glob_filter iface_filter, dev_filter, fs_filter;
 extern struct record_header record_hdr;
 
 /*
@@ -53,6 +60,87 @@ void *reallocate_buffer(struct activity *a)
 	return a->_buf0;
 }
 
+/*
+ ***************************************************************************
+ * Remove from the buffer of an activity the items (network interfaces)
+ * which should not be collected, so that they are not saved.
+ *
+ * IN:
+ * @a		Activity structure.
+ * @nr		Number of items in buffer.
+ * @name_off	Offset of the name in the structure of an item.
+ * @gf		Include and exclude lists of glob patterns.
+ *
+ * RETURNS:
+ * Number of items remaining in buffer.
+ ***************************************************************************
+ */
+__nr_t filter_buffer(struct activity *a, __nr_t nr, size_t name_off,
+		     struct glob_filter *gf)
+{
+	char *p = (char *) a->_buf0, *q = (char *) a->_buf0;
+	__nr_t i, nr_kept = 0;
+
+	for (i = 0; i < nr; i++, p += a->msize) {
+		if (!pass_glob_filter(gf, p + name_off, NULL))
+			continue;
+
+		if (q != p) {
+			memcpy(q, p, a->msize);
+		}
+		q += a->msize;
+		nr_kept++;
+	}
+	/* Clear the entries which are no longer used */
+	memset(q, 0, (size_t) a->msize * (nr - nr_kept));
+
+	return nr_kept;
+}
+
+/*
+ ***************************************************************************
+ * Remove from the buffer of a network activity the interfaces which are not
+ * in the list entered with option --rtnetlink=<iface_list>. This is used
+ * when counters have been read from /proc/net/dev instead of rtnetlink.
+ *
+ * IN:
+ * @a		Activity structure.
+ * @nr		Number of interfaces in buffer.
+ * @name_off	Offset of the interface name in the structure of an item.
+ *
+ * RETURNS:
+ * Number of interfaces remaining in buffer.
+ ***************************************************************************
+ */
+__nr_t filter_rtnl_iface_list(struct activity *a, __nr_t nr, size_t name_off)
+{
+	char *p = (char *) a->_buf0, *q = (char *) a->_buf0;
+	__nr_t i, nr_kept = 0;
+	int j;
+
+	for (i = 0; i < nr; i++, p += a->msize) {
+		for (j = 0; j < rtnl_iface_nr; j++) {
+			/* Interfaces may be selected by their name or their index */
+			if (!strcmp(rtnl_iface_list[j], p + name_off) ||
+			    ((strspn(rtnl_iface_list[j], DIGITS) == strlen(rtnl_iface_list[j])) &&
+			     (if_nametoindex(p + name_off) == atoi(rtnl_iface_list[j]))))
+				break;
+		}
+		if (j == rtnl_iface_nr)
+			continue;
+
+		if (q != p) {
+			memcpy(q, p, a->msize);
+		}
+		q += a->msize;
+		nr_kept++;
+	}
+	/* Clear the entries which are no longer used */
+	memset(q, 0, (size_t) a->msize * (nr - nr_kept));
+
+	return nr_kept;
+}
+
 /*
  ***************************************************************************
  * Read CPU statistics.
@@ -271,7 +359,8 @@ __read_funct_t wrap_read_disk(struct activity *a)
 	/* Read stats from /proc/diskstats */
 	do {
 		nr_read = read_diskstats_disk(st_disk, a->nr_allocated,
-					      COLLECT_PARTITIONS(a->opt_flags));
+					      COLLECT_PARTITIONS(a->opt_flags),
+					      FILTER_SET(&dev_filter) ? &dev_filter : NULL);
 
 		if (nr_read < 0) {
 			/* Buffer needs to be reallocated */
@@ -356,10 +445,24 @@ __read_funct_t wrap_read_net_dev(struct activity *a)
 	struct stats_net_dev *st_net_dev
 		= (struct stats_net_dev *) a->_buf0;
 	__nr_t nr_read = 0;
+	int from_proc;
 
 	/* Read network interfaces stats */
 	do {
-		nr_read = read_net_dev(st_net_dev, a->nr_allocated);
+		from_proc = !use_rtnl;
+		if (use_rtnl) {
+			nr_read = read_net_dev_rtnl(st_net_dev, a->nr_allocated,
+						    rtnl_iface_list, rtnl_iface_nr);
+			if (nr_read == -3) {
+				/* rtnetlink unavailable: Use /proc/net/dev from now on */
+				use_rtnl = FALSE;
+			}
+			/* Also use /proc/net/dev if counters couldn't be read this time */
+			from_proc = (nr_read <= -2);
+		}
+		if (from_proc) {
+			nr_read = read_net_dev(st_net_dev, a->nr_allocated);
+		}
 
 		if (nr_read < 0) {
 			/* Buffer needs to be reallocated */
@@ -368,6 +471,16 @@ __read_funct_t wrap_read_net_dev(struct activity *a)
 	}
 	while (nr_read < 0);
 
+	if (from_proc && rtnl_iface_nr) {
+		/* Keep only interfaces entered with --rtnetlink=<iface_list> */
+		nr_read = filter_rtnl_iface_list(a, nr_read, offsetof(struct stats_net_dev, interface));
+	}
+	if (FILTER_SET(&iface_filter)) {
+		/* Keep only selected interfaces */
+		nr_read = filter_buffer(a, nr_read, offsetof(struct stats_net_dev, interface),
+					&iface_filter);
+	}
+
 	a->_nr0 = nr_read;
 
 	if (!nr_read)
@@ -396,10 +509,24 @@ __read_funct_t wrap_read_net_edev(struct activity *a)
 	struct stats_net_edev *st_net_edev
 		= (struct stats_net_edev *) a->_buf0;
 	__nr_t nr_read = 0;
+	int from_proc;
 
 	/* Read network interfaces errors stats */
 	do {
-		nr_read = read_net_edev(st_net_edev, a->nr_allocated);
+		from_proc = !use_rtnl;
+		if (use_rtnl) {
+			nr_read = read_net_edev_rtnl(st_net_edev, a->nr_allocated,
+						     rtnl_iface_list, rtnl_iface_nr);
+			if (nr_read == -3) {
+				/* rtnetlink unavailable: Use /proc/net/dev from now on */
+				use_rtnl = FALSE;
+			}
+			/* Also use /proc/net/dev if counters couldn't be read this time */
+			from_proc = (nr_read <= -2);
+		}
+		if (from_proc) {
+			nr_read = read_net_edev(st_net_edev, a->nr_allocated);
+		}
 
 		if (nr_read < 0) {
 			/* Buffer needs to be reallocated */
@@ -408,6 +535,16 @@ __read_funct_t wrap_read_net_edev(struct activity *a)
 	}
 	while (nr_read < 0);
 
+	if (from_proc && rtnl_iface_nr) {
+		/* Keep only interfaces entered with --rtnetlink=<iface_list> */
+		nr_read = filter_rtnl_iface_list(a, nr_read, offsetof(struct stats_net_edev, interface));
+	}
+	if (FILTER_SET(&iface_filter)) {
+		/* Keep only selected interfaces */
+		nr_read = filter_buffer(a, nr_read, offsetof(struct stats_net_edev, interface),
+					&iface_filter);
+	}
+
 	a->_nr0 = nr_read;
 
 	return;
@@ -768,6 +905,8 @@ __read_funct_t wrap_read_net_udp6(struct activity *a)
 /*
  ***************************************************************************
  * Read CPU frequency statistics.
+ * Frequencies are read from cpufreq files in sysfs if available, else from
+ * /proc/cpuinfo.
  *
  * IN:
  * @a	Activity structure.
@@ -778,13 +917,24 @@ __read_funct_t wrap_read_net_udp6(struct activity *a)
  */
 __read_funct_t wrap_read_cpuinfo(struct activity *a)
 {
+	static int use_cpuinfo = FALSE;
 	struct stats_pwr_cpufreq *st_pwr_cpufreq
 		= (struct stats_pwr_cpufreq *) a->_buf0;
 	__nr_t nr_read = 0;
 
 	/* Read CPU frequency stats */
 	do {
-		nr_read = read_cpuinfo(st_pwr_cpufreq, a->nr_allocated);
+		if (!use_cpuinfo) {
+			nr_read = read_cpu_cur_freq(st_pwr_cpufreq, a->nr_allocated,
+						    cpufreq_subset);
+			if (!nr_read) {
+				/* No cpufreq files: Use /proc/cpuinfo from now on */
+				use_cpuinfo = TRUE;
+			}
+		}
+		if (use_cpuinfo) {
+			nr_read = read_cpuinfo(st_pwr_cpufreq, a->nr_allocated);
+		}
 
 		if (nr_read < 0) {
 			/* Buffer needs to be reallocated */
@@ -1011,7 +1161,8 @@ __read_funct_t wrap_read_filesystem(struct activity *a)
 
 	/* Read filesystems from /etc/mtab */
 	do {
-		nr_read = read_filesystem(st_filesystem, a->nr_allocated);
+		nr_read = read_filesystem(st_filesystem, a->nr_allocated,
+					  FILTER_SET(&fs_filter) ? &fs_filter : NULL);
 
 		if (nr_read < 0) {
 			/* Buffer needs to be reallocated */
@@ -1516,7 +1667,7 @@ __nr_t wrap_get_filesystem_nr(struct activity *a)
 {
 	__nr_t n = 0;
 
-	if ((n = get_filesystem_nr()) > 0) {
+	if ((n = get_filesystem_nr(FILTER_SET(&fs_filter) ? &fs_filter : NULL)) > 0) {
 		if (n > MAX_NR_FS)
 			return MAX_NR_FS;
 		else
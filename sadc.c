@@ -66,6 +66,18 @@ long interval = -1;
 uint64_t flags = 0;
 
 int optz = 0;
+/* CPU frequencies are read on one CPU out of cpufreq_subset at each interval */
+int cpufreq_subset = 1;
+/*
+ * TRUE if interface counters are read from rtnetlink (option --rtnetlink).
+ * Interfaces to collect (names or indexes), rtnl_iface_nr being 0 for all
+ * the interfaces. The list also applies if /proc/net/dev is used instead.
+ */
+int use_rtnl = FALSE;
+char **rtnl_iface_list = NULL;
+int rtnl_iface_nr = 0;
+/* Interfaces, devices and filesystems to collect */
+struct glob_filter iface_filter, dev_filter, fs_filter;
 char timestamp[2][TIMESTAMP_LEN];
 
 struct file_header file_hdr;
@@ -100,10 +112,44 @@ void usage(char *progname)
 
 	fprintf(stderr, _("Options are:\n"
 			  "[ -C <comment> ] [ -D ] [ -F ] [ -f ] [ -L ] [ -V ]\n"
-			  "[ -S { INT | DISK | IPV6 | POWER | SNMP | XDISK | ALL | XALL } ]\n"));
+			  "[ -S { INT | DISK | IPV6 | POWER | SNMP | XDISK | ALL | XALL } ]\n"
+			  "[ --cpufreq-subset=<n> ] [ --rtnetlink[=<iface_list>] ]\n"
+			  "[ --iface-include=<pattern_list> ] [ --iface-exclude=<pattern_list> ]\n"
+			  "[ --dev-include=<pattern_list> ] [ --dev-exclude=<pattern_list> ]\n"
+			  "[ --fs-include=<pattern_list> ] [ --fs-exclude=<pattern_list> ]\n"));
 	exit(1);
 }
 
+/*
+ ***************************************************************************
+ * Parse a comma-separated list of items entered on the command line (e.g.
+ * with option --rtnetlink or --iface-include) and append them to an array.
+ *
+ * IN:
+ * @list	Comma-separated list of items.
+ * @array	Array of items.
+ * @nr		Number of items in array.
+ *
+ * OUT:
+ * @array	Array with new items appended.
+ * @nr		Number of items in array.
+ ***************************************************************************
+ */
+void parse_sadc_item_list(char *list, char ***array, int *nr)
+{
+	char *t, *l;
+
+	if ((l = strdup(list)) == NULL) {
+		perror("strdup");
+		exit(4);
+	}
+
+	for (t = strtok(l, ","); t; t = strtok(NULL, ",")) {
+		SREALLOC(*array, char *, sizeof(char *) * (*nr + 1));
+		(*array)[(*nr)++] = t;
+	}
+}
+
 /*
  ***************************************************************************
  * Collect all activities belonging to a group.
@@ -1289,6 +1335,57 @@ int main(int argc, char **argv)
 			}
 		}
 
+		else if (!strncmp(argv[opt], "--cpufreq-subset=", 17)) {
+			if (!argv[opt][17] ||
+			    (strspn(argv[opt] + 17, DIGITS) != strlen(argv[opt] + 17))) {
+				usage(argv[0]);
+			}
+			cpufreq_subset = atoi(argv[opt] + 17);
+			if (cpufreq_subset < 1) {
+				usage(argv[0]);
+			}
+		}
+
+		else if (!strcmp(argv[opt], "--rtnetlink")) {
+			use_rtnl = TRUE;
+		}
+
+		else if (!strncmp(argv[opt], "--rtnetlink=", 12)) {
+			/* An empty list means all the interfaces */
+			use_rtnl = TRUE;
+			parse_sadc_item_list(argv[opt] + 12, &rtnl_iface_list, &rtnl_iface_nr);
+		}
+
+		else if (!strncmp(argv[opt], "--iface-include=", 16)) {
+			parse_sadc_item_list(argv[opt] + 16, &iface_filter.include,
+					     &iface_filter.include_nr);
+		}
+
+		else if (!strncmp(argv[opt], "--iface-exclude=", 16)) {
+			parse_sadc_item_list(argv[opt] + 16, &iface_filter.exclude,
+					     &iface_filter.exclude_nr);
+		}
+
+		else if (!strncmp(argv[opt], "--dev-include=", 14)) {
+			parse_sadc_item_list(argv[opt] + 14, &dev_filter.include,
+					     &dev_filter.include_nr);
+		}
+
+		else if (!strncmp(argv[opt], "--dev-exclude=", 14)) {
+			parse_sadc_item_list(argv[opt] + 14, &dev_filter.exclude,
+					     &dev_filter.exclude_nr);
+		}
+
+		else if (!strncmp(argv[opt], "--fs-include=", 13)) {
+			parse_sadc_item_list(argv[opt] + 13, &fs_filter.include,
+					     &fs_filter.include_nr);
+		}
+
+		else if (!strncmp(argv[opt], "--fs-exclude=", 13)) {
+			parse_sadc_item_list(argv[opt] + 13, &fs_filter.exclude,
+					     &fs_filter.exclude_nr);
+		}
+
 #ifdef TEST
 		else if (!strncmp(argv[opt], "--getenv", 8)) {
 			__env = TRUE;
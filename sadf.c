@@ -30,6 +30,7 @@
 
 #include "version.h"
 #include "sadf.h"
+#include "sa_task.h"
 
 # include <locale.h>	/* For setlocale() */
 #ifdef USE_NLS
@@ -1607,6 +1608,532 @@ close_svg:
 	}
 }
 
+/*
+ ***************************************************************************
+ * Fields displayed for per-task statistics (file created by pidstat -o).
+ * Values are computed by function get_task_values() in the same order.
+ ***************************************************************************
+ */
+struct task_field {
+	unsigned int act;	/* Activity the field belongs to (P_A_* value) */
+	char *hdr;		/* Name of the field (db and ppc formats) */
+	char *json;		/* Name of the field (JSON format) */
+	int dec;		/* Number of decimal places */
+};
+
+struct task_field task_fields[] = {
+	{P_A_CPU,   "%usr",      "usr",      2},
+	{P_A_CPU,   "%system",   "system",   2},
+	{P_A_CPU,   "%guest",    "guest",    2},
+	{P_A_CPU,   "%wait",     "wait",     2},
+	{P_A_CPU,   "%CPU",      "cpu",      2},
+	{P_A_CPU,   "CPU",       "cpu-nr",   0},
+	{P_A_MEM,   "minflt/s",  "minflt",   2},
+	{P_A_MEM,   "majflt/s",  "majflt",   2},
+	{P_A_MEM,   "VSZ",       "vsz",      0},
+	{P_A_MEM,   "RSS",       "rss",      0},
+	{P_A_MEM,   "%MEM",      "mem",      2},
+	{P_A_STACK, "StkSize",   "stksize",  0},
+	{P_A_STACK, "StkRef",    "stkref",   0},
+	{P_A_STACK, "StkRes",    "stkres",   0},
+	{P_A_IO,    "kB_rd/s",   "kB_rd",    2},
+	{P_A_IO,    "kB_wr/s",   "kB_wr",    2},
+	{P_A_IO,    "kB_ccwr/s", "kB_ccwr",  2},
+	{P_A_IO,    "iodelay",   "iodelay",  0},
+	{P_A_CTXSW, "cswch/s",   "cswch",    2},
+	{P_A_CTXSW, "nvcswch/s", "nvcswch",  2},
+	{P_A_KTAB,  "threads",   "threads",  0},
+	{P_A_KTAB,  "fd-nr",     "fd-nr",    0},
+	{P_A_RT,    "prio",      "prio",     0},
+	{P_A_RT,    "policy",    "policy",   0}
+};
+
+#define TASK_FIELDS_NR	(sizeof(task_fields) / sizeof(struct task_field))
+
+/*
+ * Last values read for a task, with the uptime of the sample they belong to.
+ * @ts must be the first member (see cmp_task_pid()).
+ */
+struct task_last_stats {
+	struct task_stats ts;
+	unsigned long long uptime_cs;
+};
+
+/* Last values read for each task, sorted by PID */
+struct task_last_stats *task_last = NULL, *task_merge = NULL;
+int task_last_nr = 0, task_last_sz = 0, task_merge_sz = 0;
+
+/*
+ ***************************************************************************
+ * Compare two task_stats structures by PID. Used with qsort() and bsearch().
+ * Also used to search a task_last_stats structure, which starts with a
+ * task_stats one.
+ ***************************************************************************
+ */
+int cmp_task_pid(const void *a, const void *b)
+{
+	const struct task_stats *ta = (const struct task_stats *) a;
+	const struct task_stats *tb = (const struct task_stats *) b;
+
+	return (ta->pid > tb->pid) - (ta->pid < tb->pid);
+}
+
+/*
+ ***************************************************************************
+ * Read per-task statistics for current sample (file created by pidstat -o).
+ *
+ * IN:
+ * @ifd		File descriptor of input file.
+ * @file	Name of file being read.
+ * @file_magic	file_magic structure filled with file magic header data.
+ * @file_actlst	List of activities in file.
+ * @ts		Buffer where per-task statistics will be saved.
+ * @ts_sz	Number of structures that can be saved in buffer.
+ *
+ * OUT:
+ * @tss		System-wide values for current sample.
+ * @ts		Buffer (possibly reallocated) with per-task statistics.
+ * @ts_sz	Number of structures that can be saved in buffer.
+ *
+ * RETURNS:
+ * Number of tasks read, or -1 if an unexpected EOF has been reached.
+ ***************************************************************************
+ */
+int read_task_stats(int ifd, char *file, struct file_magic *file_magic,
+		    struct file_activity *file_actlst, struct task_sys_stats *tss,
+		    struct task_stats **ts, int *ts_sz)
+{
+	int i, j, nr = 0;
+	struct file_activity *fal = file_actlst;
+	unsigned int tss_types_nr[] = {TASK_SYS_STATS_ULL_NR, TASK_SYS_STATS_UL_NR, TASK_SYS_STATS_U_NR};
+	unsigned int ts_types_nr[] = {TASK_STATS_ULL_NR, TASK_STATS_UL_NR, TASK_STATS_U_NR};
+	char buffer[MAX_ITEM_STRUCT_SIZE];
+	__nr_t nr_value;
+	off_t offset;
+
+	memset(tss, 0, TASK_SYS_STATS_SIZE);
+
+	for (i = 0; i < file_hdr.sa_act_nr; i++, fal++) {
+
+		if (fal->has_nr) {
+			nr_value = read_nr_value(ifd, file, file_magic,
+						 endian_mismatch, arch_64, FALSE, NR_MAX);
+		}
+		else {
+			nr_value = fal->nr;
+		}
+
+		if ((fal->id == A_TASK_SYS) && (fal->magic == A_TASK_SYS_MAGIC) && (nr_value == 1)) {
+			if (sa_fread(ifd, buffer, (size_t) fal->size, HARD_SIZE, UEOF_CONT) > 0)
+				return -1;
+			if (endian_mismatch) {
+				swap_struct(fal->types_nr, buffer, arch_64);
+			}
+			if (remap_struct(tss_types_nr, fal->types_nr, buffer,
+					 fal->size, TASK_SYS_STATS_SIZE, sizeof(buffer)) < 0)
+				return -1;
+			memcpy(tss, buffer, TASK_SYS_STATS_SIZE);
+		}
+		else if ((fal->id == A_TASK) && (fal->magic == A_TASK_MAGIC)) {
+			if (nr_value > *ts_sz) {
+				*ts_sz = nr_value;
+				SREALLOC(*ts, struct task_stats, (size_t) *ts_sz * TASK_STATS_SIZE);
+			}
+			for (j = 0; j < nr_value; j++) {
+				if (sa_fread(ifd, buffer, (size_t) fal->size, HARD_SIZE, UEOF_CONT) > 0)
+					return -1;
+				if (endian_mismatch) {
+					swap_struct(fal->types_nr, buffer, arch_64);
+				}
+				if (remap_struct(ts_types_nr, fal->types_nr, buffer,
+						 fal->size, TASK_STATS_SIZE, sizeof(buffer)) < 0)
+					return -1;
+				memcpy(*ts + j, buffer, TASK_STATS_SIZE);
+				(*ts)[j].comm[TASK_COMM_SIZE - 1] = '\0';
+			}
+			nr = nr_value;
+		}
+		else if (nr_value) {
+			/* Unknown activity: Skip it */
+			offset = (off_t) fal->size * (off_t) nr_value * (off_t) fal->nr2;
+			if (lseek(ifd, offset, SEEK_CUR) < offset)
+				return -1;
+		}
+	}
+
+	return nr;
+}
+
+/*
+ ***************************************************************************
+ * Save the values read for current sample as the last values known for
+ * each task. Tasks not saved in current sample keep their previous values.
+ *
+ * IN:
+ * @ts		Per-task statistics for current sample, sorted by PID.
+ * @nr		Number of tasks in current sample.
+ * @uptime_cs	Uptime of current sample (in 1/100th of a second).
+ ***************************************************************************
+ */
+void merge_task_stats(struct task_stats *ts, int nr, unsigned long long uptime_cs)
+{
+	int i = 0, j = 0, k = 0;
+	struct task_last_stats *tmp;
+
+	if (task_last_nr + nr > task_merge_sz) {
+		task_merge_sz = task_last_nr + nr;
+		SREALLOC(task_merge, struct task_last_stats,
+			 (size_t) task_merge_sz * sizeof(struct task_last_stats));
+	}
+
+	while ((i < task_last_nr) || (j < nr)) {
+		if ((j >= nr) || ((i < task_last_nr) && (task_last[i].ts.pid < ts[j].pid))) {
+			task_merge[k++] = task_last[i++];
+		}
+		else {
+			if ((i < task_last_nr) && (task_last[i].ts.pid == ts[j].pid)) {
+				i++;
+			}
+			task_merge[k].ts = ts[j++];
+			task_merge[k++].uptime_cs = uptime_cs;
+		}
+	}
+
+	tmp = task_last;
+	task_last = task_merge;
+	task_merge = tmp;
+	i = task_last_sz;
+	task_last_sz = task_merge_sz;
+	task_merge_sz = i;
+	task_last_nr = k;
+}
+
+/*
+ ***************************************************************************
+ * Compute the values displayed for a task. Values are saved in the same
+ * order as fields in task_fields[] array.
+ *
+ * IN:
+ * @tc		Current statistics for the task.
+ * @tp		Previous statistics for the task.
+ * @tss		System-wide values for current sample.
+ * @itv		Interval of time in 1/100th of a second.
+ *
+ * OUT:
+ * @val		Values for the task.
+ ***************************************************************************
+ */
+void get_task_values(struct task_stats *tc, struct task_stats *tp,
+		     struct task_sys_stats *tss, unsigned long long itv, double val[])
+{
+	unsigned long long itvj = itv * file_hdr.sa_hz / 100;
+	int i = 0;
+
+	if (!itvj) {
+		itvj = 1;
+	}
+	if (!itv) {
+		itv = 1;
+	}
+
+	/* User time already includes guest time */
+	val[i++] = (tc->utime - tc->gtime) < (tp->utime - tp->gtime) ?
+		   0.0 :
+		   SP_VALUE(tp->utime - tp->gtime, tc->utime - tc->gtime, itvj);
+	val[i++] = SP_VALUE(tp->stime, tc->stime, itvj);
+	val[i++] = SP_VALUE(tp->gtime, tc->gtime, itvj);
+	val[i++] = SP_VALUE(tp->wtime, tc->wtime, itvj);
+	val[i++] = SP_VALUE(tp->utime + tp->stime, tc->utime + tc->stime, itvj);
+	val[i++] = tc->processor;
+
+	val[i++] = S_VALUE(tp->minflt, tc->minflt, itv);
+	val[i++] = S_VALUE(tp->majflt, tc->majflt, itv);
+	val[i++] = tc->vsz;
+	val[i++] = tc->rss;
+	val[i++] = tss->tlmkb ? SP_VALUE(0, tc->rss, tss->tlmkb) : 0.0;
+
+	val[i++] = tc->stack_size;
+	/* Only one of these values has been read (see pidstat option --stack-res) */
+	if (tc->flags & TASK_F_STK_RES) {
+		val[i++] = -1.0;
+		val[i++] = tc->stack_res;
+	}
+	else {
+		val[i++] = tc->stack_ref;
+		val[i++] = -1.0;
+	}
+
+	if (tc->flags & TASK_F_NO_IO) {
+		val[i++] = -1.0;
+		val[i++] = -1.0;
+		val[i++] = -1.0;
+	}
+	else {
+		val[i++] = S_VALUE(tp->read_bytes,  tc->read_bytes,  itv) / 1024;
+		val[i++] = S_VALUE(tp->write_bytes, tc->write_bytes, itv) / 1024;
+		val[i++] = S_VALUE(tp->cancelled_write_bytes,
+				   tc->cancelled_write_bytes, itv) / 1024;
+	}
+	val[i++] = tc->blkio_swapin_delays - tp->blkio_swapin_delays;
+
+	val[i++] = S_VALUE(tp->nvcsw,  tc->nvcsw,  itv);
+	val[i++] = S_VALUE(tp->nivcsw, tc->nivcsw, itv);
+
+	val[i++] = tc->threads;
+	val[i++] = (tc->flags & TASK_F_NO_FD) ? -1.0 : tc->fd_nr;
+
+	val[i++] = tc->priority;
+	val[i++] = tc->policy;
+}
+
+/*
+ ***************************************************************************
+ * Display statistics for one task in selected format (db, ppc or JSON).
+ *
+ * IN:
+ * @tc		Current statistics for the task.
+ * @tp		Previous statistics for the task.
+ * @tss		System-wide values for current sample.
+ * @itv		Interval of time in 1/100th of a second.
+ * @pre		Prefix string for output entries (db and ppc formats).
+ * @tab		Number of tabulations (JSON format).
+ ***************************************************************************
+ */
+void print_task_stats(struct task_stats *tc, struct task_stats *tp,
+		      struct task_sys_stats *tss, unsigned long long itv, char *pre, int tab)
+{
+	int i;
+	unsigned int tgid = tc->tgid ? tc->tgid : tc->pid;
+	double val[TASK_FIELDS_NR];
+	char comm[2 * TASK_COMM_SIZE], *c, *d;
+
+	get_task_values(tc, tp, tss, itv, val);
+
+	if (format == F_JSON_OUTPUT) {
+		/* Escape characters that cannot appear as is in a JSON string */
+		for (c = tc->comm, d = comm; *c; c++) {
+			if ((*c == '"') || (*c == '\\')) {
+				*d++ = '\\';
+			}
+			*d++ = (*c < ' ') ? '?' : *c;
+		}
+		*d = '\0';
+
+		xprintf0(tab, "{\"uid\": %u, \"pid\": %u, \"tgid\": %u, ", tc->uid, tc->pid, tgid);
+		for (i = 0; i < TASK_FIELDS_NR; i++) {
+			if (tss->act & task_fields[i].act) {
+				printf("\"%s\": %.*f, ", task_fields[i].json, task_fields[i].dec, val[i]);
+			}
+		}
+		printf("\"command\": \"%s\"}", comm);
+	}
+	else if (format == F_DB_OUTPUT) {
+		printf("%s;%u;%u;%u", pre, tc->uid, tc->pid, tgid);
+		for (i = 0; i < TASK_FIELDS_NR; i++) {
+			if (tss->act & task_fields[i].act) {
+				printf(";%.*f", task_fields[i].dec, val[i]);
+			}
+		}
+		printf(";%s\n", tc->comm);
+	}
+	else {
+		/* ppc format */
+		printf("%s\t%u\tUID\t%u\n", pre, tc->pid, tc->uid);
+		printf("%s\t%u\tTGID\t%u\n", pre, tc->pid, tgid);
+		for (i = 0; i < TASK_FIELDS_NR; i++) {
+			if (tss->act & task_fields[i].act) {
+				printf("%s\t%u\t%s\t%.*f\n", pre, tc->pid, task_fields[i].hdr,
+				       task_fields[i].dec, val[i]);
+			}
+		}
+		printf("%s\t%u\tCommand\t%s\n", pre, tc->pid, tc->comm);
+	}
+}
+
+/*
+ ***************************************************************************
+ * Display the field list for per-task statistics (used eg. in database
+ * format).
+ *
+ * IN:
+ * @act		Activities collected by pidstat (P_A_* flags).
+ ***************************************************************************
+ */
+void list_task_fields(unsigned int act)
+{
+	int i;
+
+	cprintf_s(IS_COMMENT, "%s", "# hostname;interval;timestamp;UID;PID;TGID");
+	for (i = 0; i < TASK_FIELDS_NR; i++) {
+		if (act & task_fields[i].act) {
+			cprintf_s(IS_COMMENT, ";%s", task_fields[i].hdr);
+		}
+	}
+	cprintf_s(IS_COMMENT, "%s", ";Command");
+	printf("\n");
+}
+
+/*
+ ***************************************************************************
+ * Display contents of a file created by pidstat -o. Such a file contains
+ * per-task statistics instead of system activities.
+ * The first sample saved in file contains all the tasks and is used as
+ * reference. Next samples contain only the tasks which were to be displayed
+ * by pidstat: Values for the other tasks haven't changed.
+ * Formats:	ppc, CSV, JSON
+ *
+ * IN:
+ * @ifd		File descriptor of input file.
+ * @file	Name of file being read.
+ * @file_actlst	List of activities in file.
+ * @file_magic	file_magic structure filled with file magic header data.
+ * @rectime	Structure where timestamp (expressed in local time or in UTC
+ *		depending on whether options -T/-t have been used or not) can
+ *		be saved for current record.
+ ***************************************************************************
+ */
+void task_display_loop(int ifd, char *file, struct file_activity *file_actlst,
+		       struct file_magic *file_magic, struct tstamp_ext *rectime)
+{
+	int i, nr, first = TRUE, hdr = FALSE, sep, tab = 0, curr = 0, ts_sz = 0;
+	long cnt = count;
+	unsigned long long itv, tsk_itv, dt;
+	char rec_hdr_tmp[MAX_RECORD_HEADER_SIZE];
+	char cur_date[TIMESTAMP_LEN], cur_time[TIMESTAMP_LEN], *pre = NULL;
+	struct task_sys_stats tss;
+	struct task_stats *ts = NULL, *tp, zero_ts;
+	struct task_last_stats *tl;
+
+	if ((format != F_DB_OUTPUT) && (format != F_PPC_OUTPUT) && (format != F_JSON_OUTPUT)) {
+		fprintf(stderr, _("Per-task statistics can only be displayed in ppc, CSV or JSON format\n"));
+		close(ifd);
+		exit(1);
+	}
+
+	memset(&zero_ts, 0, TASK_STATS_SIZE);
+
+	/* Print header */
+	if (*fmt[f_position]->f_header) {
+		(*fmt[f_position]->f_header)(&tab, F_BEGIN, file, my_tzname, file_magic,
+					     &file_hdr, act, id_seq, file_actlst);
+	}
+	if (*fmt[f_position]->f_statistics) {
+		(*fmt[f_position]->f_statistics)(&tab, F_BEGIN, act, id_seq);
+	}
+
+	while (cnt &&
+	       !read_record_hdr(ifd, rec_hdr_tmp, &record_hdr[curr], &file_hdr,
+				arch_64, endian_mismatch, UEOF_CONT, sizeof(rec_hdr_tmp),
+				flags, fmt[f_position])) {
+
+		/* pidstat saves only statistics records */
+		if (record_hdr[curr].record_type != R_STATS) {
+			handle_invalid_sa_file(ifd, file_magic, file, 0);
+		}
+
+		if (((nr = read_task_stats(ifd, file, file_magic, file_actlst,
+					   &tss, &ts, &ts_sz)) < 0) ||
+		    sa_get_record_timestamp_struct(flags, &record_hdr[curr], rectime))
+			break;
+
+		qsort(ts, nr, TASK_STATS_SIZE, cmp_task_pid);
+
+		if (first || (datecmp(rectime, &tm_start, FALSE) < 0)) {
+			/* First sample (used as reference) or sample not selected */
+			first = FALSE;
+			goto next;
+		}
+		if (datecmp(rectime, &tm_end, FALSE) > 0)
+			break;
+
+		if (!hdr && DISPLAY_FIELD_LIST(fmt[f_position]->options)) {
+			/* Print field list */
+			list_task_fields(tss.act);
+		}
+		hdr = TRUE;
+
+		/* Get interval values in 1/100th of a second */
+		get_itv_value(&record_hdr[curr], &record_hdr[!curr], &itv);
+		dt = itv / 100;
+		/* Correct rounding error for dt */
+		if ((itv % 100) >= 50) {
+			dt++;
+		}
+
+		set_record_timestamp_string(flags, cur_date, cur_time, TIMESTAMP_LEN, rectime);
+
+		if (*fmt[f_position]->f_statistics) {
+			(*fmt[f_position]->f_statistics)(&tab, F_MAIN, act, id_seq);
+		}
+		if (*fmt[f_position]->f_timestamp) {
+			pre = (char *) (*fmt[f_position]->f_timestamp)(&tab, F_BEGIN, cur_date, cur_time,
+								       my_tzname, dt, &record_hdr[curr],
+								       &file_hdr, flags);
+		}
+		if (format == F_JSON_OUTPUT) {
+			(*fmt[f_position]->f_timestamp)(&tab, F_MAIN, cur_date, cur_time, NULL, dt,
+							&record_hdr[curr], &file_hdr, flags);
+			xprintf(tab, "\"tasks\": [");
+		}
+
+		for (i = 0, sep = FALSE; i < nr; i++) {
+			tl = bsearch(ts + i, task_last, task_last_nr,
+				     sizeof(struct task_last_stats), cmp_task_pid);
+			if (!tl || (ts[i].starttime != tl->ts.starttime) ||
+			    (ts[i].utime + ts[i].stime < tl->ts.utime + tl->ts.stime)) {
+				/* New task (or PID reused) */
+				tp = &zero_ts;
+				tsk_itv = itv;
+			}
+			else {
+				/*
+				 * The task may not have been saved in the previous
+				 * sample (e.g. it was not in the top N with --top):
+				 * Compute its rates since the sample it was last saved in.
+				 */
+				tp = &tl->ts;
+				tsk_itv = get_interval(tl->uptime_cs, record_hdr[curr].uptime_cs);
+			}
+			if (sep) {
+				printf(",\n");
+			}
+			sep = (format == F_JSON_OUTPUT);
+
+			print_task_stats(ts + i, tp, &tss, tsk_itv, pre, tab + 1);
+		}
+
+		if (format == F_JSON_OUTPUT) {
+			if (sep) {
+				printf("\n");
+			}
+			xprintf0(tab, "]");
+		}
+		if (*fmt[f_position]->f_timestamp) {
+			(*fmt[f_position]->f_timestamp)(&tab, F_END, cur_date, cur_time, NULL, dt,
+							&record_hdr[curr], &file_hdr, flags);
+		}
+
+		if (cnt > 0) {
+			cnt--;
+		}
+next:
+		merge_task_stats(ts, nr, record_hdr[curr].uptime_cs);
+		curr ^= 1;
+	}
+
+	if (*fmt[f_position]->f_statistics) {
+		(*fmt[f_position]->f_statistics)(&tab, F_END, act, id_seq);
+	}
+	if (*fmt[f_position]->f_header) {
+		(*fmt[f_position]->f_header)(&tab, F_END, file, my_tzname, file_magic,
+					     &file_hdr, act, id_seq, file_actlst);
+	}
+
+	free(ts);
+	free(task_last);
+	free(task_merge);
+}
+
 /*
  ***************************************************************************
  * Check system activity datafile contents before displaying stats.
@@ -1623,7 +2150,7 @@ void read_stats_from_file(char dfile[], char pcparchive[])
 	struct file_magic file_magic;
 	struct file_activity *file_actlst = NULL;
 	struct tstamp_ext rectime;
-	int ifd, tab = 0;
+	int i, ifd, tab = 0;
 
 	/* Prepare file for reading and read its headers */
 	check_file_actlst(&ifd, dfile, act, flags, &file_magic, &file_hdr,
@@ -1642,6 +2169,16 @@ void read_stats_from_file(char dfile[], char pcparchive[])
 		exit(0);
 	}
 
+	for (i = 0; i < file_hdr.sa_act_nr; i++) {
+		if (file_actlst[i].id == A_TASK) {
+			/* File created by pidstat -o: Display per-task statistics */
+			task_display_loop(ifd, dfile, file_actlst, &file_magic, &rectime);
+			close(ifd);
+			free(file_actlst);
+			return;
+		}
+	}
+
 	/* Perform required allocations */
 	allocate_structures(act, flags);
 
@@ -1693,6 +2230,9 @@ int main(int argc, char **argv)
 	/* Init some structures */
 	init_structures();
 
+	/* sadf can also display files created by pidstat -o */
+	flags |= S_F_TASK_FILE;
+
 	/* Process options */
 	while (opt < argc) {
 
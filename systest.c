@@ -39,6 +39,7 @@
 
 time_t __unix_time = 1591016000;	/* Mon Jun  1 12:53:20 2020 UTC */
 int __env = 0;
+unsigned int __root_gen = 0;		/* Incremented each time the root directory is switched */
 
 extern long interval;
 extern int sigint_caught;
@@ -182,6 +183,7 @@ void next_time_step(void)
 		perror("link");
 		exit(1);
 	}
+	__root_gen++;
 }
 
 /*
@@ -0,0 +1,86 @@
+/*
+ * bench-irq.c: Measure the time taken by mpstat to read /proc/interrupts
+ * and /proc/softirqs files.
+ * (C) 2024 by Sebastien GODARD (sysstat <at> orange.fr)
+ *
+ ***************************************************************************
+ * This program is free software; you can redistribute it and/or modify it *
+ * under the terms of the GNU General Public License as published  by  the *
+ * Free Software Foundation; either version 2 of the License, or (at  your *
+ * option) any later version.                                              *
+ *                                                                         *
+ * This program is distributed in the hope that it  will  be  useful,  but *
+ * WITHOUT ANY WARRANTY; without the implied warranty  of  MERCHANTABILITY *
+ * or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License *
+ * for more details.                                                       *
+ *                                                                         *
+ * You should have received a copy of the GNU General Public License along *
+ * with this program; if not, write to the Free Software Foundation, Inc., *
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1335 USA              *
+ ***************************************************************************
+ *
+ * mpstat functions are used as they are: mpstat.c is included below with
+ * its main() function renamed.
+ * This program is compiled in test mode and started by tests/bench-irq.sh,
+ * which creates the files of a synthetic machine with many CPU.
+ */
+
+#define main mpstat_main
+#include "../mpstat.c"
+#undef main
+
+#include <time.h>
+
+/*
+ ***************************************************************************
+ * Get current time in seconds.
+ ***************************************************************************
+ */
+double bench_time(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+
+	return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+/*
+ ***************************************************************************
+ * Main entry to the program.
+ ***************************************************************************
+ */
+int main(int argc, char **argv)
+{
+	int i, runs = 20;
+	double t;
+
+	if (argc > 1) {
+		runs = atoi(argv[1]);
+	}
+	if (runs <= 0) {
+		fprintf(stderr, "Usage: %s [ <nr_runs> ]\n", argv[0]);
+		exit(1);
+	}
+
+	cpu_nr = get_cpu_nr(~0, TRUE);
+	irqcpu_nr = get_irqcpu_nr(INTERRUPTS, NR_IRQS, cpu_nr) + NR_IRQCPU_PREALLOC;
+	softirqcpu_nr = get_irqcpu_nr(SOFTIRQS, NR_IRQS, cpu_nr) + NR_IRQCPU_PREALLOC;
+	salloc_mp_struct(cpu_nr + 1, 0);
+
+	t = bench_time();
+	for (i = 0; i < runs; i++) {
+		read_interrupts_stat(INTERRUPTS, &irq_fb, st_irqcpu, irqcpu_nr, i & 1);
+	}
+	printf("%s: %d CPU, %d interrupts: %.3f ms per read\n",
+	       INTERRUPTS, cpu_nr, irqcpu_nr, (bench_time() - t) * 1000 / runs);
+
+	t = bench_time();
+	for (i = 0; i < runs; i++) {
+		read_interrupts_stat(SOFTIRQS, &softirq_fb, st_softirqcpu, softirqcpu_nr, i & 1);
+	}
+	printf("%s: %d CPU, %d interrupts: %.3f ms per read\n",
+	       SOFTIRQS, cpu_nr, softirqcpu_nr, (bench_time() - t) * 1000 / runs);
+
+	return 0;
+}
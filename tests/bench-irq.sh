@@ -0,0 +1,91 @@
+#!/bin/sh
+# Benchmark of /proc/interrupts and /proc/softirqs files parsing by mpstat,
+# using the files of a synthetic machine with many CPU (1024 by default).
+# (C) 2024 Sebastien GODARD (sysstat <at> orange.fr)
+#
+# Run from sysstat source directory with "make bench", or:
+# sh tests/bench-irq.sh [ <nr_cpu> [ <nr_runs> ] ]
+# once tests/bench-irq program has been compiled.
+
+CPU_NR=${1:-1024}
+RUNS=${2:-20}
+IRQ_NR=64
+BROOT=tests/bench-root
+
+if [ ! -x tests/bench-irq ]
+then
+	echo "tests/bench-irq not found: Run \"make bench\" from sysstat source directory"
+	exit 1
+fi
+
+cleanup() {
+	rm -f tests/root
+	ln -s root1 tests/root
+	rm -rf ${BROOT}
+}
+trap cleanup EXIT INT TERM
+
+rm -rf ${BROOT}
+mkdir -p ${BROOT}/proc ${BROOT}/sys/devices/system/cpu
+
+# CPU directories in sysfs (used to count CPU)
+i=0
+while [ $i -lt ${CPU_NR} ]
+do
+	mkdir ${BROOT}/sys/devices/system/cpu/cpu$i
+	i=$((i + 1))
+done
+
+echo "7192.55 29212.05" > ${BROOT}/proc/uptime
+
+awk -v cpu_nr=${CPU_NR} -v irq_nr=${IRQ_NR} -v broot=${BROOT} '
+BEGIN {
+	# /proc/stat
+	f = broot "/proc/stat"
+	printf("cpu  %u 2578701 53845 3617879 60648 27891 25853 0 0 0\n", 96005 * cpu_nr) > f
+	for (c = 0; c < cpu_nr; c++)
+		printf("cpu%u 10600 331675 5802 352894 4235 3243 9600 0 0 0\n", c) > f
+	printf("intr %u\n", 123456789) > f
+
+	# /proc/interrupts
+	f = broot "/proc/interrupts"
+	printf("     ") > f
+	for (c = 0; c < cpu_nr; c++)
+		printf("%-11s", "CPU" c) > f
+	printf("\n") > f
+	for (i = 0; i < irq_nr; i++) {
+		printf("%4u:", i) > f
+		for (c = 0; c < cpu_nr; c++)
+			printf(" %10u", (i * 7919 + c * 104729) % 100000000) > f
+		printf("  IR-PCI-MSI %u-edge      dev%u\n", i, i) > f
+	}
+	split("NMI LOC SPU PMI IWI RTR RES CAL TLB TRM THR DFR MCE MCP", names, " ")
+	for (i = 1; i <= 14; i++) {
+		printf("%4s:", names[i]) > f
+		for (c = 0; c < cpu_nr; c++)
+			printf(" %10u", (i * 31 + c * 17) % 1000000) > f
+		printf("   Interrupts of type %s\n", names[i]) > f
+	}
+	printf("ERR:          0\nMIS:          0\n") > f
+
+	# /proc/softirqs
+	f = broot "/proc/softirqs"
+	printf("                ") > f
+	for (c = 0; c < cpu_nr; c++)
+		printf("    %-7s", "CPU" c) > f
+	printf("\n") > f
+	split("HI TIMER NET_TX NET_RX BLOCK IRQ_POLL TASKLET SCHED HRTIMER RCU", names, " ")
+	for (i = 1; i <= 10; i++) {
+		printf("%12s:", names[i]) > f
+		for (c = 0; c < cpu_nr; c++)
+			printf(" %10u", (i * 65537 + c * 257) % 10000000) > f
+		printf("\n") > f
+	}
+}'
+
+rm -f tests/root
+ln -s bench-root tests/root
+
+echo "$(wc -c < ${BROOT}/proc/interrupts) bytes in interrupts file, $(wc -c < ${BROOT}/proc/softirqs) bytes in softirqs file"
+
+tests/bench-irq ${RUNS}
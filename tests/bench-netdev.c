@@ -0,0 +1,153 @@
+/*
+ * bench-netdev.c: Measure the time taken by sadc to read network interfaces
+ * statistics (activities A_NET_DEV and A_NET_EDEV) from /proc/net/dev and
+ * from rtnetlink.
+ * (C) 2024 by Sebastien GODARD (sysstat <at> orange.fr)
+ *
+ ***************************************************************************
+ * This program is free software; you can redistribute it and/or modify it *
+ * under the terms of the GNU General Public License as published  by  the *
+ * Free Software Foundation; either version 2 of the License, or (at  your *
+ * option) any later version.                                              *
+ *                                                                         *
+ * This program is distributed in the hope that it  will  be  useful,  but *
+ * WITHOUT ANY WARRANTY; without the implied warranty  of  MERCHANTABILITY *
+ * or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License *
+ * for more details.                                                       *
+ *                                                                         *
+ * You should have received a copy of the GNU General Public License along *
+ * with this program; if not, write to the Free Software Foundation, Inc., *
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1335 USA              *
+ ***************************************************************************
+ *
+ * sadc functions are used as they are: common.c and rd_stats.c are included
+ * below.
+ * Contrary to other benchmarks, this program is not compiled in test mode
+ * since rtnetlink always returns the interfaces of the running system.
+ * It is started by tests/bench-netdev.sh, which creates many interfaces
+ * in a dedicated network namespace.
+ */
+
+#undef TEST
+#define SOURCE_SADC
+#include "../common.c"
+#include "../rd_stats.c"
+
+#include <time.h>
+
+/*
+ ***************************************************************************
+ * Get current time in seconds.
+ ***************************************************************************
+ */
+double bench_time(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+
+	return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+/*
+ ***************************************************************************
+ * Check that the same interfaces and counters have been read from
+ * /proc/net/dev and from rtnetlink.
+ *
+ * IN:
+ * @dev_p	Statistics read from /proc/net/dev.
+ * @dev_r	Statistics read from rtnetlink.
+ * @edev_p	Errors statistics read from /proc/net/dev.
+ * @edev_r	Errors statistics read from rtnetlink.
+ * @nr		Number of interfaces.
+ *
+ * RETURNS:
+ * Number of interfaces for which statistics differ.
+ ***************************************************************************
+ */
+int check_counters(struct stats_net_dev *dev_p, struct stats_net_dev *dev_r,
+		   struct stats_net_edev *edev_p, struct stats_net_edev *edev_r, int nr)
+{
+	int i, j, diff = 0;
+
+	for (i = 0; i < nr; i++) {
+		/* Interfaces may not be listed in the same order */
+		for (j = 0; j < nr; j++) {
+			if (!strcmp(dev_p[i].interface, dev_r[j].interface))
+				break;
+		}
+		if ((j == nr) ||
+		    memcmp(dev_p + i, dev_r + j, STATS_NET_DEV_SIZE2CMP) ||
+		    memcmp(edev_p + i, edev_r + j, STATS_NET_EDEV_SIZE2CMP)) {
+			diff++;
+		}
+	}
+
+	return diff;
+}
+
+/*
+ ***************************************************************************
+ * Main entry to the program.
+ ***************************************************************************
+ */
+int main(int argc, char **argv)
+{
+	struct stats_net_dev *dev_p = NULL, *dev_r = NULL;
+	struct stats_net_edev *edev_p = NULL, *edev_r = NULL;
+	__nr_t nr_alloc = 16, nr_p, nr_r;
+	int i, runs = 20;
+	double t;
+
+	if (argc > 1) {
+		runs = atoi(argv[1]);
+	}
+	if (runs <= 0) {
+		fprintf(stderr, "Usage: %s [ <nr_runs> ]\n", argv[0]);
+		exit(1);
+	}
+
+	/* Allocate buffers large enough for all the interfaces */
+	do {
+		nr_alloc *= 2;
+		SREALLOC(dev_p, struct stats_net_dev, STATS_NET_DEV_SIZE * nr_alloc);
+		SREALLOC(dev_r, struct stats_net_dev, STATS_NET_DEV_SIZE * nr_alloc);
+		SREALLOC(edev_p, struct stats_net_edev, STATS_NET_EDEV_SIZE * nr_alloc);
+		SREALLOC(edev_r, struct stats_net_edev, STATS_NET_EDEV_SIZE * nr_alloc);
+	}
+	while (read_net_dev(dev_p, nr_alloc) < 0);
+
+	memset(dev_p, 0, STATS_NET_DEV_SIZE * nr_alloc);
+	memset(dev_r, 0, STATS_NET_DEV_SIZE * nr_alloc);
+	memset(edev_p, 0, STATS_NET_EDEV_SIZE * nr_alloc);
+	memset(edev_r, 0, STATS_NET_EDEV_SIZE * nr_alloc);
+
+	nr_p = read_net_dev(dev_p, nr_alloc);
+	read_net_edev(edev_p, nr_alloc);
+	nr_r = read_net_dev_rtnl(dev_r, nr_alloc, NULL, 0);
+	read_net_edev_rtnl(edev_r, nr_alloc, NULL, 0);
+
+	if (nr_r < 0) {
+		fprintf(stderr, "Cannot read interfaces statistics from rtnetlink\n");
+		exit(1);
+	}
+	printf("%d interfaces in %s, %d read from rtnetlink, %d with different counters\n",
+	       nr_p, NET_DEV, nr_r,
+	       (nr_p == nr_r) ? check_counters(dev_p, dev_r, edev_p, edev_r, nr_p) : nr_p);
+
+	t = bench_time();
+	for (i = 0; i < runs; i++) {
+		read_net_dev(dev_p, nr_alloc);
+		read_net_edev(edev_p, nr_alloc);
+	}
+	printf("%s: %.3f ms per sample\n", NET_DEV, (bench_time() - t) * 1000 / runs);
+
+	t = bench_time();
+	for (i = 0; i < runs; i++) {
+		read_net_dev_rtnl(dev_r, nr_alloc, NULL, 0);
+		read_net_edev_rtnl(edev_r, nr_alloc, NULL, 0);
+	}
+	printf("rtnetlink: %.3f ms per sample\n", (bench_time() - t) * 1000 / runs);
+
+	return 0;
+}
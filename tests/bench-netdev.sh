@@ -0,0 +1,41 @@
+#!/bin/sh
+# Benchmark of network interfaces statistics collection by sadc, from
+# /proc/net/dev and from rtnetlink, with many interfaces (5000 by default).
+# Interfaces (veth pairs) are created in a dedicated network namespace.
+# Must be run as root.
+# (C) 2024 Sebastien GODARD (sysstat <at> orange.fr)
+#
+# Run from sysstat source directory with "make bench", or:
+# sh tests/bench-netdev.sh [ <nr_iface> [ <nr_runs> ] ]
+# once tests/bench-netdev program has been compiled.
+
+IFACE_NR=${1:-5000}
+RUNS=${2:-20}
+NETNS=sysstat-bench
+
+if [ ! -x tests/bench-netdev ]
+then
+	echo "tests/bench-netdev not found: Run \"make bench\" from sysstat source directory"
+	exit 1
+fi
+
+if [ "$(id -u)" != "0" ] || ! ip netns add ${NETNS} 2>/dev/null
+then
+	echo "Cannot create network namespace: Network interfaces benchmark skipped"
+	exit 0
+fi
+
+cleanup() {
+	ip netns del ${NETNS} 2>/dev/null
+}
+trap cleanup EXIT INT TERM
+
+# Each veth pair creates two interfaces
+i=0
+while [ $i -lt $((IFACE_NR / 2)) ]
+do
+	echo "link add va$i type veth peer name vb$i"
+	i=$((i + 1))
+done | ip -n ${NETNS} -batch -
+
+ip netns exec ${NETNS} tests/bench-netdev ${RUNS}